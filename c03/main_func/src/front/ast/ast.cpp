@@ -3,13 +3,22 @@
 namespace tinyc
 {
 
-CompUnit::CompUnit(std::unique_ptr<Location> location, std::unique_ptr<FuncDef> func_def):
+CompUnit::CompUnit(std::unique_ptr<Location> location, Vector func_defs):
 	BaseAST { ast_comunit, std::move(location) },
-	m_func_def { std::move(func_def) }
+	m_func_defs { std::move(func_defs) }
 {}
 
-auto CompUnit::get_func_def() const -> const FuncDef&
-{ return *m_func_def; }
+auto CompUnit::begin() const -> Vector::const_iterator
+{ return m_func_defs.cbegin(); }
+
+auto CompUnit::end() const -> Vector::const_iterator
+{ return m_func_defs.cend(); }
+
+auto CompUnit::get_func_defs() const -> const Vector&
+{ return m_func_defs; }
+
+void CompUnit::add_func_def(std::unique_ptr<FuncDef> func_def)
+{ m_func_defs.push_back(std::move(func_def)); }
 
 
 }	//namespace tinyc;
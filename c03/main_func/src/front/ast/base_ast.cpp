@@ -86,6 +86,11 @@ void BaseAST::report(Location::DiagKind kind, std::string_view msg) const
 	m_location->report(kind, msg);
 }
 
+auto BaseAST::get_location() const -> const Location&
+{
+	return *m_location;
+}
+
 }	//namespace tinyc
 	
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <vector>
 #include <cassert>
 #include <easylog.hpp>
 #include "base_ast.hpp"
@@ -8,17 +9,27 @@
 namespace tinyc
 {
 
+/**
+ * CompUnit ::= FuncDef+;
+ */
 class CompUnit: public BaseAST
 {
 public:
 	TINYC_AST_FILL_CLASSOF(ast_comunit)
-	CompUnit(std::unique_ptr<Location> location, std::unique_ptr<FuncDef> func_def);
+	using Vector = std::vector<std::unique_ptr<FuncDef>>;
 
+	CompUnit(std::unique_ptr<Location> location, Vector func_defs = Vector{});
+
+	[[nodiscard]]
+	auto begin() const -> Vector::const_iterator;
+	[[nodiscard]]
+	auto end() const -> Vector::const_iterator;
 	[[nodiscard]]
-	auto get_func_def() const -> const FuncDef&;
+	auto get_func_defs() const -> const Vector&;
+	void add_func_def(std::unique_ptr<FuncDef> func_def);
 
 private:
-	std::unique_ptr<FuncDef> m_func_def;
+	Vector m_func_defs;
 };
 
 
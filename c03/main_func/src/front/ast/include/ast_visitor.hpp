@@ -0,0 +1,229 @@
+#pragma once
+#include <cassert>
+#include <type_traits>
+#include <utility>
+#include "ast.hpp"
+
+namespace tinyc
+{
+
+/**
+ * @brief 静态分派的访问者基类, 不经过虚函数
+ * @tparam Derived 派生类, 按需提供visit_xxx, 未提供的节点落到默认实现
+ * @tparam Ret 所有visit_xxx的返回类型, 编译期确定
+ * @note 派生类的visit_xxx可以为private, 此时需要将基类声明为friend
+ * @note 默认实现的转发关系: \
+ * visit_l3_expr...visit_lor_expr -> visit_binary_expr -> visit_default \
+ * visit_unary_op...visit_lor_op -> visit_operation -> visit_default \
+ * 其余 visit_xxx -> visit_default
+ */
+template<typename Derived, typename Ret = void>
+class ASTVisitorBase
+{
+public:
+	using result_type = Ret;
+
+	/// @brief 运行时按get_kind()分派, 用于只持有BaseAST的场景
+	auto dispatch(const BaseAST& node) -> Ret
+	{
+		switch(node.get_kind())
+		{
+		case BaseAST::ast_number:
+			return derived().visit_number(static_cast<const Number&>(node));
+		case BaseAST::ast_ident:
+			return derived().visit_ident(static_cast<const Ident&>(node));
+		case BaseAST::ast_expr:
+			return derived().visit_expr(static_cast<const Expr&>(node));
+		case BaseAST::ast_primary_expr:
+			return derived().visit_primary_expr(
+				static_cast<const PrimaryExpr&>(node));
+		case BaseAST::ast_unary_expr:
+			return derived().visit_unary_expr(static_cast<const UnaryExpr&>(node));
+		case BaseAST::ast_l3expr:
+			return derived().visit_l3_expr(static_cast<const L3Expr&>(node));
+		case BaseAST::ast_l4expr:
+			return derived().visit_l4_expr(static_cast<const L4Expr&>(node));
+		case BaseAST::ast_l6expr:
+			return derived().visit_l6_expr(static_cast<const L6Expr&>(node));
+		case BaseAST::ast_l7expr:
+			return derived().visit_l7_expr(static_cast<const L7Expr&>(node));
+		case BaseAST::ast_land_expr:
+			return derived().visit_land_expr(static_cast<const LAndExpr&>(node));
+		case BaseAST::ast_lor_expr:
+			return derived().visit_lor_expr(static_cast<const LOrExpr&>(node));
+		case BaseAST::ast_unary_op:
+			return derived().visit_unary_op(static_cast<const UnaryOp&>(node));
+		case BaseAST::ast_l3op:
+			return derived().visit_l3_op(static_cast<const L3Op&>(node));
+		case BaseAST::ast_l4op:
+			return derived().visit_l4_op(static_cast<const L4Op&>(node));
+		case BaseAST::ast_l6op:
+			return derived().visit_l6_op(static_cast<const L6Op&>(node));
+		case BaseAST::ast_l7op:
+			return derived().visit_l7_op(static_cast<const L7Op&>(node));
+		case BaseAST::ast_land_op:
+			return derived().visit_land_op(static_cast<const LAndOp&>(node));
+		case BaseAST::ast_lor_op:
+			return derived().visit_lor_op(static_cast<const LOrOp&>(node));
+		case BaseAST::ast_stmt:
+			return derived().visit_stmt(static_cast<const Stmt&>(node));
+		case BaseAST::ast_block:
+			return derived().visit_block(static_cast<const Block&>(node));
+		case BaseAST::ast_type:
+			return derived().visit_type(static_cast<const Type&>(node));
+		case BaseAST::ast_param:
+			return derived().visit_param(static_cast<const Param&>(node));
+		case BaseAST::ast_paramlist:
+			return derived().visit_param_list(static_cast<const ParamList&>(node));
+		case BaseAST::ast_funcdef:
+			return derived().visit_func_def(static_cast<const FuncDef&>(node));
+		case BaseAST::ast_comunit:
+			return derived().visit_comp_unit(static_cast<const CompUnit&>(node));
+		// 区间标记, 不会出现在语法树中
+		case BaseAST::ast_expr_end:
+		case BaseAST::ast_op:
+		case BaseAST::ast_op_end:
+			break;
+		}
+		assert(false && "dispatch on an AstKind that never appears in the ast");
+		std::unreachable();
+	}
+
+	/// @brief 静态类型已知时在编译期选择visit_xxx, 连switch也省去
+	template<typename Node>
+		requires std::is_base_of_v<BaseAST, Node>
+	auto visit_node(const Node& node) -> Ret
+	{
+		if constexpr (std::is_same_v<Node, Number>)
+			return derived().visit_number(node);
+		else if constexpr (std::is_same_v<Node, Ident>)
+			return derived().visit_ident(node);
+		else if constexpr (std::is_same_v<Node, Expr>)
+			return derived().visit_expr(node);
+		else if constexpr (std::is_same_v<Node, PrimaryExpr>)
+			return derived().visit_primary_expr(node);
+		else if constexpr (std::is_same_v<Node, UnaryExpr>)
+			return derived().visit_unary_expr(node);
+		else if constexpr (std::is_same_v<Node, L3Expr>)
+			return derived().visit_l3_expr(node);
+		else if constexpr (std::is_same_v<Node, L4Expr>)
+			return derived().visit_l4_expr(node);
+		else if constexpr (std::is_same_v<Node, L6Expr>)
+			return derived().visit_l6_expr(node);
+		else if constexpr (std::is_same_v<Node, L7Expr>)
+			return derived().visit_l7_expr(node);
+		else if constexpr (std::is_same_v<Node, LAndExpr>)
+			return derived().visit_land_expr(node);
+		else if constexpr (std::is_same_v<Node, LOrExpr>)
+			return derived().visit_lor_expr(node);
+		else if constexpr (std::is_same_v<Node, UnaryOp>)
+			return derived().visit_unary_op(node);
+		else if constexpr (std::is_same_v<Node, L3Op>)
+			return derived().visit_l3_op(node);
+		else if constexpr (std::is_same_v<Node, L4Op>)
+			return derived().visit_l4_op(node);
+		else if constexpr (std::is_same_v<Node, L6Op>)
+			return derived().visit_l6_op(node);
+		else if constexpr (std::is_same_v<Node, L7Op>)
+			return derived().visit_l7_op(node);
+		else if constexpr (std::is_same_v<Node, LAndOp>)
+			return derived().visit_land_op(node);
+		else if constexpr (std::is_same_v<Node, LOrOp>)
+			return derived().visit_lor_op(node);
+		else if constexpr (std::is_same_v<Node, Stmt>)
+			return derived().visit_stmt(node);
+		else if constexpr (std::is_same_v<Node, Block>)
+			return derived().visit_block(node);
+		else if constexpr (std::is_same_v<Node, Type>)
+			return derived().visit_type(node);
+		else if constexpr (std::is_same_v<Node, Param>)
+			return derived().visit_param(node);
+		else if constexpr (std::is_same_v<Node, ParamList>)
+			return derived().visit_param_list(node);
+		else if constexpr (std::is_same_v<Node, FuncDef>)
+			return derived().visit_func_def(node);
+		else if constexpr (std::is_same_v<Node, CompUnit>)
+			return derived().visit_comp_unit(node);
+		else
+			return dispatch(node);
+	}
+
+protected:
+	ASTVisitorBase() = default;
+	~ASTVisitorBase() = default;
+
+	auto visit_number(const Number& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_ident(const Ident& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_expr(const Expr& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_primary_expr(const PrimaryExpr& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_unary_expr(const UnaryExpr& node) -> Ret
+	{ return derived().visit_default(node); }
+
+	auto visit_l3_expr(const L3Expr& node) -> Ret
+	{ return derived().visit_binary_expr(node); }
+	auto visit_l4_expr(const L4Expr& node) -> Ret
+	{ return derived().visit_binary_expr(node); }
+	auto visit_l6_expr(const L6Expr& node) -> Ret
+	{ return derived().visit_binary_expr(node); }
+	auto visit_l7_expr(const L7Expr& node) -> Ret
+	{ return derived().visit_binary_expr(node); }
+	auto visit_land_expr(const LAndExpr& node) -> Ret
+	{ return derived().visit_binary_expr(node); }
+	auto visit_lor_expr(const LOrExpr& node) -> Ret
+	{ return derived().visit_binary_expr(node); }
+
+	template<typename BinaryExpr>
+	auto visit_binary_expr(const BinaryExpr& node) -> Ret
+	{ return derived().visit_default(node); }
+
+	auto visit_unary_op(const UnaryOp& node) -> Ret
+	{ return derived().visit_operation(node); }
+	auto visit_l3_op(const L3Op& node) -> Ret
+	{ return derived().visit_operation(node); }
+	auto visit_l4_op(const L4Op& node) -> Ret
+	{ return derived().visit_operation(node); }
+	auto visit_l6_op(const L6Op& node) -> Ret
+	{ return derived().visit_operation(node); }
+	auto visit_l7_op(const L7Op& node) -> Ret
+	{ return derived().visit_operation(node); }
+	auto visit_land_op(const LAndOp& node) -> Ret
+	{ return derived().visit_operation(node); }
+	auto visit_lor_op(const LOrOp& node) -> Ret
+	{ return derived().visit_operation(node); }
+
+	auto visit_operation(const Operation& node) -> Ret
+	{ return derived().visit_default(node); }
+
+	auto visit_stmt(const Stmt& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_block(const Block& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_type(const Type& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_param(const Param& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_param_list(const ParamList& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_func_def(const FuncDef& node) -> Ret
+	{ return derived().visit_default(node); }
+	auto visit_comp_unit(const CompUnit& node) -> Ret
+	{ return derived().visit_default(node); }
+
+	/// @brief 未被派生类处理的节点, 默认返回值初始化的Ret
+	auto visit_default(const BaseAST& node) -> Ret
+	{
+		(void)node;
+		if constexpr (!std::is_void_v<Ret>)
+			return Ret{};
+	}
+
+private:
+	auto derived() -> Derived&
+	{ return static_cast<Derived&>(*this); }
+};
+
+}	//namespace tinyc
@@ -1,5 +1,7 @@
 #pragma once
 #include <memory>
+#include <string_view>
+#include <utility>
 
 namespace tinyc
 {
@@ -35,6 +37,14 @@ public:
 	virtual
 	void report(Location::DiagKind kind, std::string_view msg) const = 0;
 
+	/**
+	 * @brief 起始位置的行列号, 均从1开始
+	 * @note 未知位置返回{0, 0}
+	 */
+	virtual
+	auto get_line_and_column() const -> std::pair<unsigned, unsigned>
+	{ return { 0, 0 }; }
+
 private:
 };
 
@@ -92,6 +102,10 @@ public:
 	
 	void report(Location::DiagKind kind, std::string_view msg) const;
 
+	/// @brief 节点对应的源码位置, 用于序列化等需要偏移量的场景
+	[[nodiscard]]
+	auto get_location() const -> const Location&;
+
 private:
 	AstKind m_kind;
 	std::unique_ptr<Location> m_location;
@@ -1,6 +1,7 @@
 #pragma once
 #include "base_components_ast.hpp"
 #include "operation_ast.hpp"
+#include "utility.hpp"
 
 namespace tinyc
 {
@@ -59,18 +60,16 @@ public:
 	[[nodiscard]]
 	auto has_ident() const -> bool;
 
-	// 暂时搁置对于visit的实现
-	// 需要详细了解std::invoke_result_t中对于lambda表达式和仿函数参数的区别
-	// 并且这里的Variant存储类型为unique_ptr, 这个信息需要对用户屏蔽，
-	// 让用户传入的回调函数直接处理对应类型
-	
-	//template <typename Func>
-	//auto visit(Func&& func) const -> util::nf_visit_result_t<Func, Variant>
-	//{
-	//	//return std::visit(util::uptr_deref_func<Func, Variant>::func(
-	//	//					  std::forward<Func>(func)),
-	//	//				  m_value);
-	//}
+	/**
+	 * @brief 单次分派访问当前存储的节点
+	 * @param func 分别接受const Expr&, const Number&, const Ident&
+	 * @note Variant存储的unique_ptr对调用者屏蔽, 回调直接处理对应类型
+	 */
+	template <typename Func>
+	auto visit(Func&& func) const -> util::nf_visit_result_t<Func, Variant>
+	{
+		return util::nf_visit(std::forward<Func>(func), m_value);
+	}
 	
 	[[nodiscard]]
 	auto get_expr() const -> const Expr&;
@@ -100,6 +99,16 @@ public:
 	UnaryExpr(std::unique_ptr<Location> location, std::unique_ptr<UnaryOp> unary_op,
 			std::unique_ptr<UnaryExpr> unary_expr);
 
+	/**
+	 * @brief 单次分派访问当前存储的节点
+	 * @param func 接受const PrimaryExpr&, 或(const UnaryOp&, const UnaryExpr&)
+	 */
+	template <typename Func>
+	auto visit(Func&& func) const -> util::nf_visit_result_t<Func, Variant>
+	{
+		return util::nf_visit(std::forward<Func>(func), m_value);
+	}
+
 	[[nodiscard]]
 	auto has_primary_expr() const -> bool;
 	[[nodiscard]]
@@ -144,6 +153,17 @@ public:
 			   OpPtr op_ptr, HigherExprPtr higher_ptr);
 	~BinaryExpr() = 0;
 
+	/**
+	 * @brief 单次分派访问当前存储的节点
+	 * @param func 接受const HigherExpr&, \
+	 * 或(const SelfExpr&, const Op&, const HigherExpr&)
+	 */
+	template <typename Func>
+	auto visit(Func&& func) const -> util::nf_visit_result_t<Func, Variant>
+	{
+		return util::nf_visit(std::forward<Func>(func), m_value);
+	}
+
 	[[nodiscard]]
 	auto has_higher_expr() const -> bool;
 	[[nodiscard]]
@@ -0,0 +1,200 @@
+#pragma once
+#include <variant>
+#include <type_traits>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace tinyc
+{
+namespace util
+{
+
+/**
+ * @brief 确保所有的RestType调用Func的返回值相同
+ */
+template<typename Func, typename Type,  typename... RestTypes>
+struct invoke_result_are_same
+{
+	using type = std::invoke_result_t<Func, Type>;
+
+	inline static constexpr bool value = invoke_result_are_same<Func, RestTypes...>::value &&
+		std::is_same_v<type, typename invoke_result_are_same<Func, RestTypes...>::type>;
+};
+
+
+template<typename Func, typename LeftType, typename RightType>
+struct invoke_result_are_same<Func, LeftType, RightType>
+{
+	using type = std::invoke_result_t<Func, LeftType>;
+
+	inline static constexpr bool value = std::is_same_v<
+		std::invoke_result_t<Func, LeftType>, std::invoke_result_t<Func, RightType>
+	>;
+
+	static_assert(value, "Return types of Func invoked with types are not consistent.");
+};
+
+
+
+template<typename Func, typename Type>
+struct invoke_result_are_same<Func, Type>
+{
+	using type = std::invoke_result_t<Func, Type>;
+	inline static constexpr bool value = true;
+};
+
+
+/**
+ * @brief std::unique_ptr<Ty> 关于Ty的类型萃取
+ */
+template<typename Ty>
+struct uptr_elem
+{
+	static_assert(!sizeof(Ty), "uptr_elem template type must be wrappered by std::unique_ptr");
+};
+
+
+template<typename Ty>
+struct uptr_elem<std::unique_ptr<Ty>>
+{
+	using type = Ty;
+};
+
+
+template<typename Uptr>
+using uptr_elem_t = typename uptr_elem<Uptr>::type;
+
+
+/**
+ * @brief 以解引用后的const引用调用Func的返回类型
+ * @note 存储类型为unique_ptr时传入一个参数, \
+ * 为unique_ptr组成的pair/tuple时依次展开为多个参数
+ */
+template<typename Func, typename Stored>
+struct deref_invoke_result
+{
+	using type = std::invoke_result_t<Func, const uptr_elem_t<Stored>&>;
+};
+
+
+template<typename Func, typename... Types>
+struct deref_invoke_result<Func, std::pair<std::unique_ptr<Types>...>>
+{
+	using type = std::invoke_result_t<Func, const Types&...>;
+};
+
+
+template<typename Func, typename... Types>
+struct deref_invoke_result<Func, std::tuple<std::unique_ptr<Types>...>>
+{
+	using type = std::invoke_result_t<Func, const Types&...>;
+};
+
+
+template<typename Func, typename Stored>
+using deref_invoke_result_t = typename deref_invoke_result<Func, Stored>::type;
+
+
+/**
+ * @brief 对于std::variant, 获取其visit的返回类型
+ */
+template<typename Variant>
+struct variant_types
+{
+	static_assert(!sizeof(Variant),
+				  "Invalid instantiation with expected type, not std::variant");
+};
+
+
+template<typename... Types>
+struct variant_types<std::variant<Types...>>
+{
+	template<typename Func>
+	using visit_result_type = typename invoke_result_are_same<Func, Types...>::type;
+
+ 	/// @brief 对于内部为unique_ptr的variant, 获取visit的回调函数参数为unique_ptr的元素的特殊处理
+	template<typename Func>
+	using nf_visit_result_type =
+		std::tuple_element_t<0, std::tuple<deref_invoke_result_t<Func, Types>...>>;
+
+	template<typename Func>
+	inline static constexpr bool nf_visit_result_same =
+		(std::is_same_v<nf_visit_result_type<Func>, deref_invoke_result_t<Func, Types>> && ...);
+};
+
+
+template <typename Func, typename Variant>
+using visit_result_t = typename variant_types<
+	std::decay_t<Variant>>::template visit_result_type<std::decay_t<Func>>;
+
+
+template <typename NormalFunc, typename RowVariant>
+using nf_visit_result_t = typename variant_types<
+	std::decay_t<RowVariant>>::template nf_visit_result_type<NormalFunc>;
+
+
+/**
+ * @brief 将variant中的unique_ptr解引用后转发给NormalFunc
+ * @note pair/tuple中的unique_ptr依次解引用, 作为多个参数传入
+ */
+template<typename NormalFunc, typename RowVariant>
+struct variant_uptr_deref_func
+{
+	static_assert(variant_types<std::decay_t<RowVariant>>::template
+					  nf_visit_result_same<NormalFunc>,
+				  "Return types of Func invoked with types are not consistent.");
+
+	NormalFunc& func;
+
+	template<typename Ty>
+	auto operator()(const std::unique_ptr<Ty>& arg) const
+		-> nf_visit_result_t<NormalFunc, RowVariant>
+	{
+		return std::invoke(func, std::as_const(*arg));
+	}
+
+	template<typename... Types>
+	auto operator()(const std::pair<std::unique_ptr<Types>...>& args) const
+		-> nf_visit_result_t<NormalFunc, RowVariant>
+	{
+		return std::apply([this](const auto&... ptrs) {
+			return std::invoke(func, std::as_const(*ptrs)...);
+		}, args);
+	}
+
+	template<typename... Types>
+	auto operator()(const std::tuple<std::unique_ptr<Types>...>& args) const
+		-> nf_visit_result_t<NormalFunc, RowVariant>
+	{
+		return std::apply([this](const auto&... ptrs) {
+			return std::invoke(func, std::as_const(*ptrs)...);
+		}, args);
+	}
+};
+
+
+/**
+ * @brief 以解引用后的元素调用func
+ * @return 所有分支的返回类型必须相同
+ */
+template<typename Func, typename Variant>
+auto nf_visit(Func&& func, const Variant& variant)
+	-> nf_visit_result_t<Func, Variant>
+{
+	return std::visit(variant_uptr_deref_func<std::remove_reference_t<Func>, Variant>{ func },
+					  variant);
+}
+
+
+/// @brief 组合多个lambda作为visit的回调
+template<typename... Funcs>
+struct overloaded: Funcs...
+{
+	using Funcs::operator()...;
+};
+
+}	//namespace tinyc::util
+}	//namespace tinyc
+
@@ -0,0 +1,165 @@
+#include "ast_hash.hpp"
+#include "ast_visitor.hpp"
+#include <llvm/Support/xxhash.h>
+#include <string>
+
+namespace tinyc
+{
+
+namespace
+{
+
+/**
+ * @brief 按先序将节点种类与内容编码进缓冲区, 最后统一计算哈希
+ * @note 变长字段带有长度前缀, 不同的树不会拼接出相同的字节序列
+ */
+class StructuralHasher: public ASTVisitorBase<StructuralHasher>
+{
+	friend class ASTVisitorBase<StructuralHasher>;
+public:
+	auto hash(const FuncDef& node) -> std::uint64_t
+	{
+		m_buffer.clear();
+		visit_node(node);
+		return llvm::xxHash64(m_buffer);
+	}
+
+private:
+	void visit_func_def(const FuncDef& node)
+	{
+		add_kind(node);
+		visit_node(node.get_type());
+		visit_node(node.get_ident());
+		visit_node(node.get_paramlist());
+		visit_node(node.get_block());
+	}
+
+	void visit_type(const Type& node)
+	{
+		add_kind(node);
+		add_integer(node.get_type());
+	}
+
+	void visit_ident(const Ident& node)
+	{
+		add_kind(node);
+		auto value = node.get_value();
+		add_integer(value.size());
+		m_buffer.append(value);
+	}
+
+	void visit_param_list(const ParamList& node)
+	{
+		add_kind(node);
+		add_integer(node.get_params().size());
+		for (const auto& param : node)
+			visit_node(*param);
+	}
+
+	void visit_param(const Param& node)
+	{
+		add_kind(node);
+		visit_node(node.get_type());
+		visit_node(node.get_ident());
+	}
+
+	void visit_block(const Block& node)
+	{
+		add_kind(node);
+		add_integer(node.get_exprs().size());
+		for (const auto& stmt : node)
+			visit_node(*stmt);
+	}
+
+	void visit_stmt(const Stmt& node)
+	{
+		add_kind(node);
+		visit_node(node.get_expr());
+	}
+
+	void visit_expr(const Expr& node)
+	{
+		add_kind(node);
+		visit_node(node.get_low_expr());
+	}
+
+	void visit_primary_expr(const PrimaryExpr& node)
+	{
+		add_kind(node);
+		node.visit([this](const auto& value) { visit_node(value); });
+	}
+
+	void visit_unary_expr(const UnaryExpr& node)
+	{
+		add_kind(node);
+		node.visit(util::overloaded {
+			[this](const PrimaryExpr& primary_expr) {
+				visit_node(primary_expr);
+			},
+			[this](const UnaryOp& op, const UnaryExpr& unary_expr) {
+				visit_node(op);
+				visit_node(unary_expr);
+			},
+		});
+	}
+
+	void visit_number(const Number& node)
+	{
+		add_kind(node);
+		add_integer(node.get_int_literal());
+	}
+
+	template<typename BinaryExpr>
+	void visit_binary_expr(const BinaryExpr& node)
+	{
+		using SelfExpr = typename BinaryExpr::SelfExprPtr::element_type;
+		using HigherExpr = typename BinaryExpr::HigherExprPtr::element_type;
+		using Op = typename BinaryExpr::OpPtr::element_type;
+
+		// 两种形式的第一个子节点kind不同, 无需额外标记
+		add_kind(node);
+		node.visit(util::overloaded {
+			[this](const HigherExpr& higher_expr) {
+				visit_node(higher_expr);
+			},
+			[this](const SelfExpr& self_expr, const Op& op,
+				   const HigherExpr& higher_expr) {
+				visit_node(self_expr);
+				visit_node(op);
+				visit_node(higher_expr);
+			},
+		});
+	}
+
+	void visit_operation(const Operation& node)
+	{
+		add_kind(node);
+		add_integer(node.get_type());
+	}
+
+	void add_kind(const BaseAST& node)
+	{
+		add_integer(node.get_kind());
+	}
+
+	/// @brief 固定按小端写入8字节, 结果与主机字节序无关
+	void add_integer(std::int64_t value)
+	{
+		auto bits = static_cast<std::uint64_t>(value);
+		for (int i = 0; i < 8; ++i)
+			m_buffer.push_back(static_cast<char>((bits >> (i * 8)) & 0xff));
+	}
+
+private:
+	std::string m_buffer;
+};
+
+}	//namespace
+
+auto structural_hash(const FuncDef& node) -> std::uint64_t
+{
+	StructuralHasher hasher;
+	return hasher.hash(node);
+}
+
+}	//namespace tinyc
@@ -0,0 +1,646 @@
+#include "ast_serializer.hpp"
+
+#include <cstring>
+#include <format>
+#include <limits>
+#include <llvm/Support/LEB128.h>
+
+namespace tinyc
+{
+
+namespace
+{
+
+/// @brief 二元表达式类型到AstKind的映射, 用于区分是否为组合表达式
+template<typename Node>
+constexpr auto kind_of() -> BaseAST::AstKind
+{
+	if constexpr (std::is_same_v<Node, L3Expr>)
+		return BaseAST::ast_l3expr;
+	else if constexpr (std::is_same_v<Node, L4Expr>)
+		return BaseAST::ast_l4expr;
+	else if constexpr (std::is_same_v<Node, L6Expr>)
+		return BaseAST::ast_l6expr;
+	else if constexpr (std::is_same_v<Node, L7Expr>)
+		return BaseAST::ast_l7expr;
+	else if constexpr (std::is_same_v<Node, LAndExpr>)
+		return BaseAST::ast_land_expr;
+	else if constexpr (std::is_same_v<Node, LOrExpr>)
+		return BaseAST::ast_lor_expr;
+	else if constexpr (std::is_same_v<Node, L3Op>)
+		return BaseAST::ast_l3op;
+	else if constexpr (std::is_same_v<Node, L4Op>)
+		return BaseAST::ast_l4op;
+	else if constexpr (std::is_same_v<Node, L6Op>)
+		return BaseAST::ast_l6op;
+	else if constexpr (std::is_same_v<Node, L7Op>)
+		return BaseAST::ast_l7op;
+	else if constexpr (std::is_same_v<Node, LAndOp>)
+		return BaseAST::ast_land_op;
+	else if constexpr (std::is_same_v<Node, LOrOp>)
+		return BaseAST::ast_lor_op;
+	else
+		static_assert(!sizeof(Node), "Node has no fixed AstKind");
+}
+
+/// @brief 与parser.yy中各个操作符的产生式保持一致, 避免构造函数中的fatal
+auto is_valid_op(BaseAST::AstKind kind, Operation::OperationType type) -> bool
+{
+	switch(kind)
+	{
+	case BaseAST::ast_unary_op:
+		return type >= Operation::op_add && type <= Operation::op_not;
+	case BaseAST::ast_l3op:
+		return type >= Operation::op_mul && type <= Operation::op_mod;
+	case BaseAST::ast_l4op:
+		return type == Operation::op_add || type == Operation::op_sub;
+	case BaseAST::ast_l6op:
+		return type >= Operation::op_lt && type <= Operation::op_ge;
+	case BaseAST::ast_l7op:
+		return type == Operation::op_eq || type == Operation::op_ne;
+	case BaseAST::ast_land_op:
+		return type == Operation::op_land;
+	case BaseAST::ast_lor_op:
+		return type == Operation::op_lor;
+	default:
+		return false;
+	}
+}
+
+}	//namespace
+
+
+/// ASTWriter
+ASTWriter::ASTWriter(llvm::raw_ostream& os):
+	m_os { os },
+	m_source_begin { nullptr }
+{}
+
+void ASTWriter::write(const CompUnit& ast, const llvm::MemoryBuffer& source)
+{
+	m_source_begin = source.getBufferStart();
+
+	m_os.write(ASTFormat::magic, sizeof(ASTFormat::magic));
+	write_uleb(ASTFormat::version);
+	write_string(source.getBufferIdentifier());
+	write_string(source.getBuffer());
+
+	write_node(ast);
+}
+
+void ASTWriter::write_node(const CompUnit& node)
+{
+	write_header(node);
+	write_uleb(node.get_func_defs().size());
+	for (const auto& func_def : node)
+		write_node(*func_def);
+}
+
+void ASTWriter::write_node(const FuncDef& node)
+{
+	write_header(node);
+	write_node(node.get_type());
+	write_node(node.get_ident());
+	write_node(node.get_paramlist());
+	write_node(node.get_block());
+}
+
+void ASTWriter::write_node(const Type& node)
+{
+	write_header(node);
+	write_uleb(node.get_type());
+}
+
+void ASTWriter::write_node(const Ident& node)
+{
+	write_header(node);
+	write_string(node.get_value());
+}
+
+void ASTWriter::write_node(const ParamList& node)
+{
+	write_header(node);
+	write_uleb(node.get_params().size());
+	for (const auto& param : node)
+		write_node(*param);
+}
+
+void ASTWriter::write_node(const Param& node)
+{
+	write_header(node);
+	write_node(node.get_type());
+	write_node(node.get_ident());
+}
+
+void ASTWriter::write_node(const Block& node)
+{
+	write_header(node);
+	write_uleb(node.get_exprs().size());
+	for (const auto& stmt : node)
+		write_node(*stmt);
+}
+
+void ASTWriter::write_node(const Stmt& node)
+{
+	write_header(node);
+	write_node(node.get_expr());
+}
+
+void ASTWriter::write_node(const Expr& node)
+{
+	write_header(node);
+	write_node(node.get_low_expr());
+}
+
+void ASTWriter::write_node(const PrimaryExpr& node)
+{
+	// 子节点的kind即可区分variant中的类型
+	write_header(node);
+	node.visit([this](const auto& value) { write_node(value); });
+}
+
+void ASTWriter::write_node(const UnaryExpr& node)
+{
+	write_header(node);
+	node.visit(util::overloaded {
+		[this](const PrimaryExpr& primary_expr) {
+			write_node(primary_expr);
+		},
+		[this](const UnaryOp& op, const UnaryExpr& unary_expr) {
+			write_op(op);
+			write_node(unary_expr);
+		},
+	});
+}
+
+void ASTWriter::write_node(const Number& node)
+{
+	write_header(node);
+	write_sleb(node.get_int_literal());
+}
+
+void ASTWriter::write_op(const Operation& node)
+{
+	write_header(node);
+	write_uleb(node.get_type());
+}
+
+template<typename BinaryExpr>
+void ASTWriter::write_node(const BinaryExpr& node)
+{
+	using SelfExpr = typename BinaryExpr::SelfExprPtr::element_type;
+	using HigherExpr = typename BinaryExpr::HigherExprPtr::element_type;
+	using Op = typename BinaryExpr::OpPtr::element_type;
+
+	// 组合表达式的第一个子节点与自身kind相同
+	write_header(node);
+	node.visit(util::overloaded {
+		[this](const HigherExpr& higher_expr) {
+			write_node(higher_expr);
+		},
+		[this](const SelfExpr& self_expr, const Op& op,
+			   const HigherExpr& higher_expr) {
+			write_node(self_expr);
+			write_op(op);
+			write_node(higher_expr);
+		},
+	});
+}
+
+void ASTWriter::write_header(const BaseAST& node)
+{
+	// parser只会构造LLVMLocation
+	const auto& location = static_cast<const LLVMLocation&>(node.get_location());
+	auto begin = location.begin.getPointer() - m_source_begin;
+	auto end = location.end.getPointer() - m_source_begin;
+	assert(begin >= 0 && end >= begin);
+
+	m_os << static_cast<char>(node.get_kind());
+	write_uleb(static_cast<std::uint64_t>(begin));
+	write_uleb(static_cast<std::uint64_t>(end - begin));
+}
+
+void ASTWriter::write_uleb(std::uint64_t value)
+{
+	llvm::encodeULEB128(value, m_os);
+}
+
+void ASTWriter::write_sleb(std::int64_t value)
+{
+	llvm::encodeSLEB128(value, m_os);
+}
+
+void ASTWriter::write_string(std::string_view str)
+{
+	write_uleb(str.size());
+	m_os.write(str.data(), str.size());
+}
+
+
+/// ASTLoader
+ASTLoader::ASTLoader(llvm::SourceMgr& src_mgr):
+	m_src_mgr { src_mgr },
+	m_file {},
+	m_cur { nullptr },
+	m_end { nullptr },
+	m_source_begin { nullptr },
+	m_source_size { 0 },
+	m_line_index {},
+	m_error {}
+{}
+
+auto ASTLoader::load(std::string_view file_name)
+	-> std::expected<std::unique_ptr<CompUnit>, std::string>
+{
+	// 不要求'\0'结尾时, MemoryBuffer对足够大的文件使用mmap
+	auto file_or_error = llvm::MemoryBuffer::getFile(
+		file_name, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+	if (!file_or_error)
+	{
+		return std::unexpected { std::format("Failed to open {}: {}",
+				file_name, file_or_error.getError().message()) };
+	}
+	m_file = std::move(*file_or_error);
+	m_cur = reinterpret_cast<const std::uint8_t*>(m_file->getBufferStart());
+	m_end = reinterpret_cast<const std::uint8_t*>(m_file->getBufferEnd());
+
+	constexpr auto magic_size = sizeof(ASTFormat::magic);
+	if (static_cast<std::size_t>(m_end - m_cur) < magic_size ||
+		std::memcmp(m_cur, ASTFormat::magic, magic_size) != 0)
+	{
+		return std::unexpected { std::format("{} is not a tinyc ast file",
+				file_name) };
+	}
+	m_cur += magic_size;
+
+	auto version = read_uleb();
+	if (!has_error() && version != ASTFormat::version)
+	{
+		set_error(std::format("unsupported ast version {}, expected {}",
+				version, ASTFormat::version));
+	}
+
+	auto source_name = read_string();
+	m_source_size = read_uleb();
+	if (!has_error() && m_source_size > static_cast<std::size_t>(m_end - m_cur))
+		set_error("source text out of bounds");
+	if (has_error())
+		return std::unexpected { m_error };
+
+	// 源码视图引用映射区域, 不复制
+	m_source_begin = reinterpret_cast<const char*>(m_cur);
+	m_src_mgr.AddNewSourceBuffer(
+		llvm::MemoryBuffer::getMemBuffer(
+			llvm::StringRef { m_source_begin, m_source_size }, source_name,
+			/*RequiresNullTerminator=*/false),
+		llvm::SMLoc());
+	m_line_index = LineIndex { llvm::StringRef { m_source_begin, m_source_size } };
+	m_cur += m_source_size;
+
+	auto ast = read_comp_unit();
+	if (!has_error() && m_cur != m_end)
+		set_error("trailing data after CompUnit");
+	if (has_error())
+		return std::unexpected { m_error };
+
+	return ast;
+}
+
+auto ASTLoader::read_comp_unit() -> std::unique_ptr<CompUnit>
+{
+	auto location = read_header(BaseAST::ast_comunit);
+	auto count = read_uleb();
+	if (has_error())
+		return nullptr;
+
+	auto comp_unit = std::make_unique<CompUnit>(std::move(location));
+	for (std::uint64_t i = 0; i < count && !has_error(); ++i)
+		comp_unit->add_func_def(read_func_def());
+	if (has_error())
+		return nullptr;
+
+	return comp_unit;
+}
+
+auto ASTLoader::read_func_def() -> std::unique_ptr<FuncDef>
+{
+	auto location = read_header(BaseAST::ast_funcdef);
+	auto type = read_type();
+	auto ident = read_ident();
+	auto param_list = read_param_list();
+	auto block = read_block();
+	if (has_error())
+		return nullptr;
+
+	return std::make_unique<FuncDef>(std::move(location), std::move(type),
+									 std::move(ident), std::move(param_list),
+									 std::move(block));
+}
+
+auto ASTLoader::read_type() -> std::unique_ptr<Type>
+{
+	auto location = read_header(BaseAST::ast_type);
+	auto type = read_uleb();
+	if (!has_error() && type > Type::ty_unsigned_int)
+		set_error(std::format("invalid TypeEnum {}", type));
+	if (has_error())
+		return nullptr;
+
+	return std::make_unique<Type>(std::move(location),
+								  static_cast<Type::TypeEnum>(type));
+}
+
+auto ASTLoader::read_ident() -> std::unique_ptr<Ident>
+{
+	auto location = read_header(BaseAST::ast_ident);
+	auto value = read_string();
+	if (has_error())
+		return nullptr;
+
+	return std::make_unique<Ident>(std::move(location), std::move(value));
+}
+
+auto ASTLoader::read_param_list() -> std::unique_ptr<ParamList>
+{
+	auto location = read_header(BaseAST::ast_paramlist);
+	auto count = read_uleb();
+	if (has_error())
+		return nullptr;
+
+	auto param_list = std::make_unique<ParamList>(std::move(location));
+	for (std::uint64_t i = 0; i < count && !has_error(); ++i)
+		param_list->add_param(read_param());
+	if (has_error())
+		return nullptr;
+
+	return param_list;
+}
+
+auto ASTLoader::read_param() -> std::unique_ptr<Param>
+{
+	auto location = read_header(BaseAST::ast_param);
+	auto type = read_type();
+	auto ident = read_ident();
+	if (has_error())
+		return nullptr;
+
+	return std::make_unique<Param>(std::move(location), std::move(type),
+								   std::move(ident));
+}
+
+auto ASTLoader::read_block() -> std::unique_ptr<Block>
+{
+	auto location = read_header(BaseAST::ast_block);
+	auto count = read_uleb();
+	if (has_error())
+		return nullptr;
+
+	auto block = std::make_unique<Block>(std::move(location));
+	for (std::uint64_t i = 0; i < count && !has_error(); ++i)
+		block->add_stmt(read_stmt());
+	if (has_error())
+		return nullptr;
+
+	return block;
+}
+
+auto ASTLoader::read_stmt() -> std::unique_ptr<Stmt>
+{
+	auto location = read_header(BaseAST::ast_stmt);
+	auto expr = read_expr();
+	if (has_error())
+		return nullptr;
+
+	return std::make_unique<Stmt>(std::move(location), std::move(expr));
+}
+
+auto ASTLoader::read_expr() -> std::unique_ptr<Expr>
+{
+	auto location = read_header(BaseAST::ast_expr);
+	auto low_expr = read_binary_expr<LowExpr>();
+	if (has_error())
+		return nullptr;
+
+	return std::make_unique<Expr>(std::move(location), std::move(low_expr));
+}
+
+auto ASTLoader::read_primary_expr() -> std::unique_ptr<PrimaryExpr>
+{
+	auto location = read_header(BaseAST::ast_primary_expr);
+	if (has_error())
+		return nullptr;
+
+	switch(peek_kind())
+	{
+	case BaseAST::ast_expr:
+		if (auto expr = read_expr())
+			return std::make_unique<PrimaryExpr>(std::move(location), std::move(expr));
+		return nullptr;
+	case BaseAST::ast_number:
+		if (auto number = read_number())
+			return std::make_unique<PrimaryExpr>(std::move(location), std::move(number));
+		return nullptr;
+	case BaseAST::ast_ident:
+		if (auto ident = read_ident())
+			return std::make_unique<PrimaryExpr>(std::move(location), std::move(ident));
+		return nullptr;
+	default:
+		set_error("PrimaryExpr expects Expr, Number or Ident");
+		return nullptr;
+	}
+}
+
+auto ASTLoader::read_unary_expr() -> std::unique_ptr<UnaryExpr>
+{
+	auto location = read_header(BaseAST::ast_unary_expr);
+	if (has_error())
+		return nullptr;
+
+	if (peek_kind() == BaseAST::ast_unary_op)
+	{
+		auto unary_op = read_op<UnaryOp>(BaseAST::ast_unary_op);
+		auto unary_expr = read_unary_expr();
+		if (has_error())
+			return nullptr;
+		return std::make_unique<UnaryExpr>(std::move(location),
+				std::move(unary_op), std::move(unary_expr));
+	}
+
+	auto primary_expr = read_primary_expr();
+	if (has_error())
+		return nullptr;
+	return std::make_unique<UnaryExpr>(std::move(location), std::move(primary_expr));
+}
+
+auto ASTLoader::read_number() -> std::unique_ptr<Number>
+{
+	auto location = read_header(BaseAST::ast_number);
+	auto value = read_sleb();
+	if (!has_error() && (value < std::numeric_limits<int>::min() ||
+						 value > std::numeric_limits<int>::max()))
+	{
+		set_error(std::format("INT_LITERAL {} out of range", value));
+	}
+	if (has_error())
+		return nullptr;
+
+	return std::make_unique<Number>(std::move(location), static_cast<int>(value));
+}
+
+template<typename Op>
+auto ASTLoader::read_op(BaseAST::AstKind kind) -> std::unique_ptr<Op>
+{
+	auto location = read_header(kind);
+	auto type = read_uleb();
+	if (has_error())
+		return nullptr;
+	if (type > Operation::op_lor ||
+		!is_valid_op(kind, static_cast<Operation::OperationType>(type)))
+	{
+		set_error(std::format("invalid operation {} for kind {}",
+				type, static_cast<int>(kind)));
+		return nullptr;
+	}
+
+	return std::make_unique<Op>(std::move(location),
+								static_cast<Operation::OperationType>(type));
+}
+
+template<typename BinaryExpr>
+auto ASTLoader::read_binary_expr() -> std::unique_ptr<BinaryExpr>
+{
+	using HigherExpr = typename BinaryExpr::HigherExprPtr::element_type;
+	using Op = typename BinaryExpr::OpPtr::element_type;
+
+	auto read_higher = [this]() -> std::unique_ptr<HigherExpr> {
+		if constexpr (std::is_same_v<HigherExpr, UnaryExpr>)
+			return read_unary_expr();
+		else
+			return read_binary_expr<HigherExpr>();
+	};
+
+	auto location = read_header(kind_of<BinaryExpr>());
+	if (has_error())
+		return nullptr;
+
+	if (peek_kind() == kind_of<BinaryExpr>())
+	{
+		auto self_expr = read_binary_expr<BinaryExpr>();
+		auto op = read_op<Op>(kind_of<Op>());
+		auto higher_expr = read_higher();
+		if (has_error())
+			return nullptr;
+		return std::make_unique<BinaryExpr>(std::move(location),
+				std::move(self_expr), std::move(op), std::move(higher_expr));
+	}
+
+	auto higher_expr = read_higher();
+	if (has_error())
+		return nullptr;
+	return std::make_unique<BinaryExpr>(std::move(location), std::move(higher_expr));
+}
+
+auto ASTLoader::read_header(BaseAST::AstKind expect) -> std::unique_ptr<Location>
+{
+	if (has_error())
+		return nullptr;
+	if (m_cur == m_end)
+	{
+		set_error("unexpected end of ast file");
+		return nullptr;
+	}
+
+	auto kind = static_cast<BaseAST::AstKind>(*m_cur++);
+	if (kind != expect)
+	{
+		set_error(std::format("expect node kind {}, got {}",
+				static_cast<int>(expect), static_cast<int>(kind)));
+		return nullptr;
+	}
+
+	auto begin = read_uleb();
+	auto length = read_uleb();
+	if (has_error())
+		return nullptr;
+	if (begin > m_source_size || length > m_source_size - begin)
+	{
+		set_error("node location out of source bounds");
+		return nullptr;
+	}
+
+	auto location = std::make_unique<LLVMLocation>();
+	location->set_begin(m_source_begin + begin);
+	location->set_end(m_source_begin + begin + length);
+	location->set_src_mgr(&m_src_mgr);
+	location->set_line_index(&m_line_index);
+
+	return location;
+}
+
+auto ASTLoader::peek_kind() -> BaseAST::AstKind
+{
+	if (has_error() || m_cur == m_end)
+		return BaseAST::ast_expr_end;
+	return static_cast<BaseAST::AstKind>(*m_cur);
+}
+
+auto ASTLoader::read_uleb() -> std::uint64_t
+{
+	if (has_error())
+		return 0;
+
+	unsigned length = 0;
+	const char* error = nullptr;
+	auto value = llvm::decodeULEB128(m_cur, &length, m_end, &error);
+	if (error != nullptr)
+	{
+		set_error(error);
+		return 0;
+	}
+	m_cur += length;
+
+	return value;
+}
+
+auto ASTLoader::read_sleb() -> std::int64_t
+{
+	if (has_error())
+		return 0;
+
+	unsigned length = 0;
+	const char* error = nullptr;
+	auto value = llvm::decodeSLEB128(m_cur, &length, m_end, &error);
+	if (error != nullptr)
+	{
+		set_error(error);
+		return 0;
+	}
+	m_cur += length;
+
+	return value;
+}
+
+auto ASTLoader::read_string() -> std::string
+{
+	auto size = read_uleb();
+	if (has_error())
+		return {};
+	if (size > static_cast<std::uint64_t>(m_end - m_cur))
+	{
+		set_error("string out of bounds");
+		return {};
+	}
+
+	std::string str { reinterpret_cast<const char*>(m_cur), size };
+	m_cur += size;
+
+	return str;
+}
+
+void ASTLoader::set_error(std::string msg)
+{
+	if (!has_error())
+		m_error = std::move(msg);
+}
+
+}	//namespace tinyc
@@ -0,0 +1,116 @@
+#include "diagnostic_engine.hpp"
+#include <algorithm>
+#include <format>
+#include <string>
+#include <utility>
+
+namespace tinyc
+{
+
+DiagnosticEngine::DiagnosticEngine(llvm::SourceMgr& src_mgr):
+	m_src_mgr { src_mgr },
+	m_error_limit { 0 },
+	m_counters {},
+	m_dropped { 0 },
+	m_mutex {},
+	m_entries {}
+{
+	m_src_mgr.setDiagHandler(handle_diagnostic, this);
+}
+
+DiagnosticEngine::~DiagnosticEngine()
+{
+	// 调用者没有取走的消息不能丢失
+	flush();
+	if (m_src_mgr.getDiagContext() == this)
+		m_src_mgr.setDiagHandler(nullptr, nullptr);
+}
+
+auto DiagnosticEngine::error_limit_reached() const -> bool
+{
+	return m_error_limit != 0 &&
+		get_count(llvm::SourceMgr::DK_Error) >= m_error_limit;
+}
+
+auto DiagnosticEngine::take_diagnostics() -> std::vector<llvm::SMDiagnostic>
+{
+	std::vector<Entry> entries;
+	{
+		std::lock_guard lock { m_mutex };
+		entries = std::exchange(m_entries, {});
+	}
+
+	// 报告顺序取决于线程调度, 排序后输出稳定; 同一位置保持报告顺序
+	std::ranges::stable_sort(entries, {}, [](const Entry& entry) {
+		return std::pair { entry.buffer_id, entry.offset };
+	});
+
+	std::vector<llvm::SMDiagnostic> diagnostics;
+	diagnostics.reserve(entries.size() + 1);
+	for (auto& entry : entries)
+		diagnostics.push_back(std::move(entry.diag));
+
+	if (auto dropped = m_dropped.exchange(0); dropped != 0)
+	{
+		diagnostics.emplace_back("", llvm::SourceMgr::DK_Error, std::format(
+			"too many errors emitted, stopping now ({} suppressed) [-ferror-limit={}]",
+			dropped, m_error_limit));
+	}
+
+	return diagnostics;
+}
+
+void DiagnosticEngine::flush(llvm::raw_ostream& os)
+{
+	auto diagnostics = take_diagnostics();
+	if (diagnostics.empty())
+		return;
+
+	// 先渲染到内存, 多条消息只有一次写入, 不会与其他线程的输出交错
+	std::string text;
+	llvm::raw_string_ostream text_os { text };
+	text_os.enable_colors(os.has_colors());
+	for (const auto& diag : diagnostics)
+		diag.print(nullptr, text_os);
+
+	os << text_os.str();
+	os.flush();
+}
+
+void DiagnosticEngine::handle_diagnostic(const llvm::SMDiagnostic& diag,
+										 void* context)
+{
+	static_cast<DiagnosticEngine*>(context)->add(diag);
+}
+
+void DiagnosticEngine::add(const llvm::SMDiagnostic& diag)
+{
+	auto kind = diag.getKind();
+	auto count = m_counters[kind].fetch_add(1, std::memory_order_relaxed) + 1;
+
+	// 达到限制的那条错误仍然输出, 之后的消息只计数
+	bool over_limit = kind == llvm::SourceMgr::DK_Error
+		? m_error_limit != 0 && count > m_error_limit
+		: error_limit_reached();
+	if (over_limit)
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Entry entry { 0, 0, diag };
+	if (auto loc = diag.getLoc(); loc.isValid())
+	{
+		if (auto buffer_id = m_src_mgr.FindBufferContainingLoc(loc); buffer_id != 0)
+		{
+			entry.buffer_id = buffer_id;
+			entry.offset = static_cast<std::size_t>(loc.getPointer() -
+				m_src_mgr.getMemoryBuffer(buffer_id)->getBufferStart());
+		}
+	}
+
+	std::lock_guard lock { m_mutex };
+	m_entries.push_back(std::move(entry));
+}
+
+}	//namespace tinyc
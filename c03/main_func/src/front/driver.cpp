@@ -1,4 +1,5 @@
 #include "driver.hpp"
+#include "rd_parser.hpp"
 
 #include <format>
 #include <llvm/Support/WithColor.h>
@@ -12,11 +13,23 @@ Driver::Driver(llvm::SourceMgr& src_mgr):
 	m_bufferid {},
 	m_debug_trace { false },
 	m_parser {},
-	m_location {}
+	m_line_index {},
+	m_location {},
+	m_func_def_sink {},
+	m_diag_engine { nullptr },
+	m_syntax_error_count { 0 },
+	m_parser_kind { ParserKind::bison },
+	m_scanner { nullptr }
 {
 
 }
 
+Driver::~Driver()
+{
+	// construct之后没有parse时仍需销毁扫描器
+	release_flex();
+}
+
 auto Driver::construct(std::string_view file_name)
 	-> std::expected<void, std::string>
 {
@@ -25,7 +38,14 @@ auto Driver::construct(std::string_view file_name)
 	{
 		return std::unexpected{std::format("Failed to open {} \n", file_name)};
 	}
-	m_bufferid = m_src_mgr.AddNewSourceBuffer(std::move(*buffer_or_error), llvm::SMLoc());
+	return construct(std::move(*buffer_or_error));
+}
+
+auto Driver::construct(std::unique_ptr<llvm::MemoryBuffer> buffer)
+	-> std::expected<void, std::string>
+{
+	m_bufferid = m_src_mgr.AddNewSourceBuffer(std::move(buffer), llvm::SMLoc());
+	m_line_index = LineIndex { m_src_mgr.getMemoryBuffer(m_bufferid)->getBuffer() };
 
 	set_flex(get_buffer(),
 			 static_cast<int>(
@@ -35,8 +55,9 @@ auto Driver::construct(std::string_view file_name)
 	m_location.set_begin(buf_str);
 	m_location.set_end(buf_str);
 	m_location.set_src_mgr(&m_src_mgr);
+	m_location.set_line_index(&m_line_index);
 
-	m_parser = std::make_unique<yy::parser>(*this);
+	m_parser = std::make_unique<yy::parser>(*this, m_scanner);
 
 	return {};
 }
@@ -48,12 +69,32 @@ auto Driver::get_buffer() const -> const char*
 
 auto Driver::parse() -> bool
 {
-	m_parser->set_debug_level(this->get_trace());
-	int parse_ret = (*m_parser)();
+	bool parsed = false;
+	if (m_parser_kind == ParserKind::recursive_descent)
+	{
+		RecursiveDescentParser parser { *this };
+		parsed = parser.parse();
+	}
+	else
+	{
+		m_parser->set_debug_level(this->get_trace());
+		parsed = (*m_parser)() == 0;
+	}
+	release_flex();
 
-	return parse_ret == 0;
+	// 错误恢复后parser仍可能正常结束
+	// 达到错误限制时输入被截断, 即使文法上完整也视为失败
+	return parsed && m_syntax_error_count == 0 && !should_stop();
 }
 
+void Driver::collect_func_def(CompUnit::Vector& func_defs,
+							  std::unique_ptr<FuncDef> func_def)
+{
+	if (m_func_def_sink)
+		m_func_def_sink(std::move(func_def));
+	else
+		func_defs.push_back(std::move(func_def));
+}
 
 // 可以设置一个默认location, 每次调用时复制默认
 auto Driver::get_location() -> LLVMLocation&
@@ -74,5 +115,17 @@ auto DriverFactory::produce_driver(std::string_view file_name)
 	return driver;
 }
 
+auto DriverFactory::produce_driver(std::unique_ptr<llvm::MemoryBuffer> buffer)
+		-> std::expected<std::unique_ptr<Driver>, std::string>
+{
+	std::unique_ptr<Driver> driver { new Driver { m_src_mgr } };
+
+	auto void_or_error = driver->construct(std::move(buffer));
+	if (!void_or_error)
+		return std::unexpected(void_or_error.error());
+
+	return driver;
+}
+
 }	//namespace tinyc
 
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include "ast.hpp"
+
+namespace tinyc
+{
+
+/**
+ * @brief 语法树的结构哈希, 只依赖节点种类与内容, 与位置无关
+ * @note 同一棵子树在不同运行, 不同机器上得到相同结果, 可以作为磁盘缓存的键
+ * @note 只移动函数位置, 或修改注释与空白时哈希不变
+ */
+[[nodiscard]]
+auto structural_hash(const FuncDef& node) -> std::uint64_t;
+
+}	//namespace tinyc
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "ast.hpp"
+#include "llvm_location.hpp"
+
+namespace tinyc
+{
+
+/**
+ * @brief 语法树二进制格式的公共定义
+ * @note 布局: magic | version | 源文件名 | 源码 | 先序节点流
+ * @note 节点: kind(1字节) | begin偏移 | 长度 | 载荷, 整数均为ULEB128/SLEB128
+ * @note 源码随文件保存, 载入后诊断信息依旧能定位到原始文本
+ */
+struct ASTFormat
+{
+	static constexpr char magic[4] { 'T', 'C', 'A', 'S' };
+	/// @note AstKind, OperationType, TypeEnum 的数值变化时需要递增
+	static constexpr std::uint64_t version = 2;
+};
+
+
+/**
+ * @brief 将CompUnit写出为二进制格式
+ * @note 要求语法树中的位置均为LLVMLocation, 且指向source
+ */
+class ASTWriter
+{
+public:
+	ASTWriter(llvm::raw_ostream& os);
+
+	/**
+	 * @param ast 语法树根节点
+	 * @param source 语法树位置所在的源码缓冲区
+	 */
+	void write(const CompUnit& ast, const llvm::MemoryBuffer& source);
+
+private:
+	void write_node(const CompUnit& node);
+	void write_node(const FuncDef& node);
+	void write_node(const Type& node);
+	void write_node(const Ident& node);
+	void write_node(const ParamList& node);
+	void write_node(const Param& node);
+	void write_node(const Block& node);
+	void write_node(const Stmt& node);
+	void write_node(const Expr& node);
+	void write_node(const PrimaryExpr& node);
+	void write_node(const UnaryExpr& node);
+	void write_node(const Number& node);
+	/// @note 不能与模板重载同名, 否则派生的操作符会优先匹配模板
+	void write_op(const Operation& node);
+
+	template<typename BinaryExpr>
+	void write_node(const BinaryExpr& node);
+
+	/// @brief 写出所有节点共有的kind与位置
+	void write_header(const BaseAST& node);
+	void write_uleb(std::uint64_t value);
+	void write_sleb(std::int64_t value);
+	void write_string(std::string_view str);
+
+private:
+	llvm::raw_ostream& m_os;
+	const char* m_source_begin;
+};
+
+
+/**
+ * @brief 通过内存映射载入ASTWriter写出的文件，不经过flex和bison
+ * @note 源码视图直接引用映射区域，ASTLoader需要比src_mgr和语法树活得更久
+ */
+class ASTLoader
+{
+public:
+	ASTLoader(llvm::SourceMgr& src_mgr);
+
+	/**
+	 * @return 出错时返回std::unexpected, 描述错误内容
+	 * @note 只能调用一次
+	 */
+	auto load(std::string_view file_name)
+		-> std::expected<std::unique_ptr<CompUnit>, std::string>;
+
+	/**
+	 * @brief 解除文件映射
+	 * @warning 之后src_mgr中的源码视图与语法树位置全部失效
+	 */
+	void release_file()
+	{ m_file.reset(); }
+
+private:
+	auto read_comp_unit() -> std::unique_ptr<CompUnit>;
+	auto read_func_def() -> std::unique_ptr<FuncDef>;
+	auto read_type() -> std::unique_ptr<Type>;
+	auto read_ident() -> std::unique_ptr<Ident>;
+	auto read_param_list() -> std::unique_ptr<ParamList>;
+	auto read_param() -> std::unique_ptr<Param>;
+	auto read_block() -> std::unique_ptr<Block>;
+	auto read_stmt() -> std::unique_ptr<Stmt>;
+	auto read_expr() -> std::unique_ptr<Expr>;
+	auto read_primary_expr() -> std::unique_ptr<PrimaryExpr>;
+	auto read_unary_expr() -> std::unique_ptr<UnaryExpr>;
+	auto read_number() -> std::unique_ptr<Number>;
+
+	template<typename Op>
+	auto read_op(BaseAST::AstKind kind) -> std::unique_ptr<Op>;
+
+	/// @note 第一个子节点kind与自身相同时为组合表达式
+	template<typename BinaryExpr>
+	auto read_binary_expr() -> std::unique_ptr<BinaryExpr>;
+
+	/// @brief 读取节点头部，kind不符时记录错误并返回nullptr
+	auto read_header(BaseAST::AstKind expect) -> std::unique_ptr<Location>;
+	/// @brief 不移动读取位置，查看下一个节点的kind
+	auto peek_kind() -> BaseAST::AstKind;
+	auto read_uleb() -> std::uint64_t;
+	auto read_sleb() -> std::int64_t;
+	auto read_string() -> std::string;
+
+	/// @brief 记录第一个错误，之后的读取全部失败
+	void set_error(std::string msg);
+	auto has_error() const -> bool
+	{ return !m_error.empty(); }
+
+private:
+	llvm::SourceMgr& m_src_mgr;
+	std::unique_ptr<llvm::MemoryBuffer> m_file;
+	const std::uint8_t* m_cur;
+	const std::uint8_t* m_end;
+	const char* m_source_begin;
+	std::size_t m_source_size;
+	LineIndex m_line_index;
+	std::string m_error;
+};
+
+}	//namespace tinyc
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace tinyc
+{
+
+/**
+ * @brief 容量有限的多生产者多消费者队列
+ * @note 队列满时push阻塞, 生产者不会无限领先于消费者
+ * @note close之后push失败, pop取完剩余元素后返回std::nullopt
+ */
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(std::size_t capacity):
+		m_capacity { capacity == 0 ? 1 : capacity },
+		m_closed { false }
+	{}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	auto operator=(const BoundedQueue&) -> BoundedQueue& = delete;
+
+	/// @return false 队列已关闭, value未被放入
+	auto push(T value) -> bool
+	{
+		std::unique_lock lock { m_mutex };
+		m_not_full.wait(lock, [this] {
+			return m_closed || m_items.size() < m_capacity;
+		});
+		if (m_closed)
+			return false;
+
+		m_items.push_back(std::move(value));
+		lock.unlock();
+		m_not_empty.notify_one();
+		return true;
+	}
+
+	/// @return 队列关闭且为空时返回std::nullopt
+	auto pop() -> std::optional<T>
+	{
+		std::unique_lock lock { m_mutex };
+		m_not_empty.wait(lock, [this] {
+			return m_closed || !m_items.empty();
+		});
+		if (m_items.empty())
+			return std::nullopt;
+
+		T value = std::move(m_items.front());
+		m_items.pop_front();
+		lock.unlock();
+		m_not_full.notify_one();
+		return value;
+	}
+
+	/// @brief 唤醒所有等待者, 之后不再接受新元素
+	void close()
+	{
+		{
+			std::lock_guard lock { m_mutex };
+			m_closed = true;
+		}
+		m_not_full.notify_all();
+		m_not_empty.notify_all();
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_not_full;
+	std::condition_variable m_not_empty;
+	std::deque<T> m_items;
+	std::size_t m_capacity;
+	bool m_closed;
+};
+
+}	//namespace tinyc
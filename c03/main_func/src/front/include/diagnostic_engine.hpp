@@ -0,0 +1,79 @@
+#pragma once
+
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace tinyc
+{
+
+/**
+ * @brief 一次编译的诊断引擎, 收集经SourceMgr报告的消息, 结束时按位置排序统一输出
+ * @note 构造时将自身安装为src_mgr的诊断回调, LLVMLocation::report无需改动
+ * @note 计数使用原子变量, 缓冲区由互斥量保护, 回调本身可以在多个线程上同时调用
+ * @note 经设置了LineIndex的LLVMLocation::report报告时可以在解析线程与代码生成线程上同时报告; \
+ * SourceMgr::PrintMessage(SMLoc, ...)会建立SourceMgr中没有加锁的行号缓存, 不能并发调用
+ * @warning 需要早于src_mgr析构
+ */
+class DiagnosticEngine
+{
+public:
+	explicit DiagnosticEngine(llvm::SourceMgr& src_mgr);
+	~DiagnosticEngine();
+
+	DiagnosticEngine(const DiagnosticEngine&) = delete;
+	auto operator=(const DiagnosticEngine&) -> DiagnosticEngine& = delete;
+
+	/**
+	 * @brief 错误数达到limit后丢弃之后的所有消息, 0表示不限制
+	 * @note 需要在报告任何消息之前设置
+	 */
+	void set_error_limit(std::size_t limit)
+	{ m_error_limit = limit; }
+
+	/// @brief 已报告的某一级别消息数, 包括因超过限制而丢弃的消息
+	auto get_count(llvm::SourceMgr::DiagKind kind) const -> std::size_t
+	{ return m_counters[kind].load(std::memory_order_relaxed); }
+
+	/// @brief 错误数已达到限制, 解析器据此提前结束
+	auto error_limit_reached() const -> bool;
+
+	/**
+	 * @brief 取出缓冲区中的消息, 按所在缓冲区与偏移排序
+	 * @note 超过错误限制时末尾附加一条说明
+	 */
+	[[nodiscard]]
+	auto take_diagnostics() -> std::vector<llvm::SMDiagnostic>;
+
+	/// @brief 取出全部消息, 渲染后一次写入os
+	void flush(llvm::raw_ostream& os = llvm::errs());
+
+private:
+	/// @brief 注册给SourceMgr的回调, context为DiagnosticEngine
+	static
+	void handle_diagnostic(const llvm::SMDiagnostic& diag, void* context);
+
+	void add(const llvm::SMDiagnostic& diag);
+
+	struct Entry
+	{
+		/// @brief 与源码无关的消息为0, 排在最前
+		unsigned buffer_id;
+		std::size_t offset;
+		llvm::SMDiagnostic diag;
+	};
+
+	llvm::SourceMgr& m_src_mgr;
+	std::size_t m_error_limit;
+	/// @brief 以llvm::SourceMgr::DiagKind为下标
+	std::array<std::atomic<std::size_t>, 4> m_counters;
+	std::atomic<std::size_t> m_dropped;
+	std::mutex m_mutex;
+	std::vector<Entry> m_entries;
+};
+
+}	//namespace tinyc
@@ -6,12 +6,16 @@
 #include <string_view>
 #include <expected>
 #include <memory>
+#include <functional>
 #include "ast.hpp"
 #include "bison_parser.hpp"
+#include "diagnostic_engine.hpp"
+#include "line_index.hpp"
 #include "llvm_location.hpp"
 
+/// @brief yyscanner为flex的yyscan_t, 与%option reentrant生成的代码中的名字一致
 #define YY_DECL \
-	auto yylex(tinyc::Driver& driver) -> yy::parser::symbol_type
+	auto yylex(tinyc::Driver& driver, void* yyscanner) -> yy::parser::symbol_type
 
 YY_DECL;
 
@@ -26,10 +30,26 @@ namespace tinyc
 class Driver
 {
 	friend class DriverFactory;
+public:
+	using FuncDefSink = std::function<void(std::unique_ptr<FuncDef>)>;
+
+	/// @brief parse使用的语法分析器, 两者构造相同的语法树
+	enum class ParserKind
+	{
+		bison,
+		/// @brief 见RecursiveDescentParser
+		recursive_descent,
+	};
+
 private:
 	Driver(llvm::SourceMgr& src_mgr);
 
 public:
+	~Driver();
+
+	Driver(const Driver&) = delete;
+	auto operator=(const Driver&) -> Driver& = delete;
+
 	/*
 	 * @note 延迟构造，用于在非异常环境下处理构造函数错误
 	 * @return 出错时返回std::unexpected, 描述错误内容
@@ -37,12 +57,28 @@ public:
 	auto construct(std::string_view file_name)
 		-> std::expected<void, std::string>;
 
+	/**
+	 * @brief 直接解析内存中的源码, 不访问文件系统
+	 * @param buffer 加入src_mgr, 其标识符作为诊断信息中的文件名
+	 */
+	auto construct(std::unique_ptr<llvm::MemoryBuffer> buffer)
+		-> std::expected<void, std::string>;
+
 	/**
 	 * @note 解析函数，只能调用一次
 	 * @return true 成功, false 失败
 	 * @note 失败自动通过parser.error输出消息
+	 * @note 语法错误后在语句, 块与参数处恢复, 一次报告所有错误; 有任何错误即为失败
+	 * @note 结束后立即释放flex持有的缓冲区副本
 	 */
 	auto parse() -> bool;
+
+	/**
+	 * @brief 释放parser及其符号栈, 之后不能再调用parse
+	 * @note 语法树不受影响
+	 */
+	void release_parser()
+	{ m_parser.reset(); }
 	
 	/// @param ast 语法树根节点
 	void set_ast(std::unique_ptr<CompUnit> ast)
@@ -51,27 +87,87 @@ public:
 	{ return *m_ast; }
 	auto get_ast_ptr() -> CompUnit*
 	{ return m_ast.get(); }
+	/// @brief 转移语法树的所有权, 使其可以早于driver释放
+	auto take_ast() -> std::unique_ptr<CompUnit>
+	{ return std::move(m_ast); }
+
+	/**
+	 * @brief 每归约出一个FuncDef就交给sink, 不再保留在CompUnit中
+	 * @note 用于流水线模式, 解析下一个函数时即可开始生成上一个函数
+	 * @note sink在parse所在的线程上调用, 需要在parse之前设置
+	 */
+	void set_func_def_sink(FuncDefSink sink)
+	{ m_func_def_sink = std::move(sink); }
+
+	/// @brief 在parser中调用, 设置了sink时转交给sink, 否则追加到func_defs
+	void collect_func_def(CompUnit::Vector& func_defs,
+						  std::unique_ptr<FuncDef> func_def);
+
+	/// @brief 在parser::error中调用, 错误恢复后parse仍需返回失败
+	void count_syntax_error()
+	{ ++m_syntax_error_count; }
+	auto get_syntax_error_count() const -> std::size_t
+	{ return m_syntax_error_count; }
 
-	/// @brief 获取parser实例，用于在flex中调用parser的方法
+	/**
+	 * @brief 获取parser实例，用于在flex中调用parser的方法
+	 * @note 使用递归下降parser时仍通过其error报告错误
+	 */
 	auto get_parser() -> yy::parser&
 	{ return *m_parser; }
 
 	/**
-	 * @brief 设置flex的读取buffer, 和debug_trace模式
+	 * @brief 创建本driver的flex扫描器, 设置读取buffer和debug_trace模式
 	 * @note 在lexer.ll中定义
 	 */
 	void set_flex(const char* buffer, int buffer_size);
 
+	/**
+	 * @brief 销毁扫描器, 释放yy_scan_bytes复制的缓冲区, 可以重复调用
+	 * @note 在lexer.ll中定义
+	 */
+	void release_flex();
+
+	/// @brief flex的yyscan_t, 在yylex中使用
+	auto get_scanner() const -> void*
+	{ return m_scanner; }
+
+	/// @note 需要在parse之前设置, 默认使用bison
+	void set_parser_kind(ParserKind kind)
+	{ m_parser_kind = kind; }
+
 	/// @brief 设置是否输出debug调用栈
 	void set_trace(bool debug_trace)
 	{ m_debug_trace = debug_trace; }
 	auto get_trace() -> bool
 	{ return m_debug_trace; }
 
+	/**
+	 * @brief 设置后错误数达到diag_engine的限制时, 词法分析器直接返回文件结束
+	 * @note 需要在parse之前设置, diag_engine需要与src_mgr相同
+	 */
+	void set_diag_engine(const DiagnosticEngine* diag_engine)
+	{ m_diag_engine = diag_engine; }
+
+	/// @brief 在yylex中调用, 判断是否放弃解析剩余的输入
+	auto should_stop() const -> bool
+	{ return m_diag_engine != nullptr && m_diag_engine->error_limit_reached(); }
+
 	/// @brief 提供给location用于定位
 	auto get_src_mgr() const -> const llvm::SourceMgr&
 	{ return m_src_mgr; }
 
+	/// @brief 正在解析的源码缓冲区, 需要在construct之后调用
+	auto get_source_buffer() const -> const llvm::MemoryBuffer&
+	{ return *m_src_mgr.getMemoryBuffer(m_bufferid); }
+
+	/**
+	 * @brief 源码缓冲区的行首偏移表, 在construct时建立
+	 * @note 语法树中的位置引用该表, driver需要比语法树活得更久
+	 */
+	auto get_line_index() const -> const LineIndex&
+	{ return m_line_index; }
+
 	/// @brief 解析时获取位置记录，在yylex中调用
 	auto get_location() -> LLVMLocation&;
 
@@ -85,7 +181,14 @@ private:
 	unsigned m_bufferid;
 	bool m_debug_trace;
 	std::unique_ptr<yy::parser> m_parser;
+	LineIndex m_line_index;
 	LLVMLocation m_location;
+	FuncDefSink m_func_def_sink;
+	const DiagnosticEngine* m_diag_engine;
+	std::size_t m_syntax_error_count;
+	ParserKind m_parser_kind;
+	/// @brief flex的yyscan_t, 每个driver独立, 不同driver可以在多个线程上同时解析
+	void* m_scanner;
 };
 
 
@@ -103,6 +206,8 @@ public:
 
 	auto produce_driver(std::string_view file_name)
 		-> std::expected<std::unique_ptr<Driver>, std::string>;
+	auto produce_driver(std::unique_ptr<llvm::MemoryBuffer> buffer)
+		-> std::expected<std::unique_ptr<Driver>, std::string>;
 
 private:
 	llvm::SourceMgr& m_src_mgr;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace tinyc
+{
+
+/**
+ * @brief 源码缓冲区的行首偏移表, 构造时一次扫描整个缓冲区
+ * @note 查询为二分查找, 构造后只读, 可以在多个线程上同时查询
+ * @note SourceMgr在第一次查询时才建立类似的表, 且没有加锁
+ */
+class LineIndex
+{
+public:
+	LineIndex();
+	explicit LineIndex(llvm::StringRef buffer);
+
+	/**
+	 * @param ptr 指向构造时的缓冲区, 可以等于缓冲区末尾
+	 * @return 行列号均从1开始, 与SourceMgr::getLineAndColumn一致; ptr不在缓冲区中时为{0, 0}
+	 */
+	auto get_line_and_column(const char* ptr) const -> std::pair<unsigned, unsigned>;
+
+	auto get_line_count() const -> std::size_t
+	{ return m_line_starts.size(); }
+
+	/**
+	 * @param line 从0开始的行号
+	 * @return 该行起始的偏移, 超出最后一行时为缓冲区大小
+	 */
+	auto get_line_start(std::size_t line) const -> std::size_t
+	{ return line < m_line_starts.size() ? m_line_starts[line] : m_buffer.size(); }
+
+	/**
+	 * @param line 从0开始的行号
+	 * @return 该行的内容, 不含换行符; 超出最后一行时为空
+	 */
+	auto get_line_text(std::size_t line) const -> llvm::StringRef;
+
+	auto contains(const char* ptr) const -> bool
+	{ return ptr >= m_buffer.begin() && ptr <= m_buffer.end(); }
+
+private:
+	/// @brief 收集所有'\n'之后的偏移
+	void scan_newlines();
+
+	llvm::StringRef m_buffer;
+	/// @brief 第i行(从0开始)的起始偏移, 第一项总是0
+	std::vector<std::size_t> m_line_starts;
+};
+
+}	//namespace tinyc
@@ -2,20 +2,24 @@
 
 #include <llvm/Support/SMLoc.h>
 #include <llvm/Support/SourceMgr.h>
+#include <array>
+#include <atomic>
 #include <ostream>
 #include "base_ast.hpp"
+#include "line_index.hpp"
 
 #define YYLLOC_DEFAULT(Cur, Rhs, N)                                            \
 	do                                                                         \
 	{                                                                          \
 		if (N)                                                                 \
 		{                                                                      \
-			Cur.begin = YYRHSLOC(Rhs, 1).begin;                                \
+			Cur = YYRHSLOC(Rhs, 1);                                            \
 			Cur.end = YYRHSLOC(Rhs, N).end;                                    \
 		}                                                                      \
 		else                                                                   \
 		{                                                                      \
-			Cur.begin = Cur.end = YYRHSLOC(Rhs, 0).end;                        \
+			Cur = YYRHSLOC(Rhs, 0);                                            \
+			Cur.begin = Cur.end;                                               \
 		}                                                                      \
 	} while (0)
 
@@ -52,6 +56,9 @@ public:
 	/**
 	 * @param src_mgr begin和end对应的SourceMgr
 	 * @param dk 错误级别
+	 * @note src_mgr上安装了DiagnosticEngine时, 消息先进入其缓冲区
+	 * @note 设置了line_index时消息由其构造, 不经过SourceMgr惰性建立的行号缓存, \
+	 * 可以在多个线程上同时调用
 	 */
 	void report(Location::DiagKind kind, std::string_view msg) const override ;
 
@@ -64,22 +71,41 @@ public:
 	/// @note 需要在report前调用
 	void set_src_mgr(const llvm::SourceMgr* src_mgr) const;
 
-	/// @brief 查询某个级别输出信息的次数
+	/**
+	 * @brief 设置后行列号由line_index计算, 不再经过SourceMgr
+	 * @note line_index需要比所有复制出的位置活得更久
+	 */
+	void set_line_index(const LineIndex* line_index) const
+	{ m_line_index = line_index; }
+
+	auto get_line_and_column() const -> std::pair<unsigned, unsigned> override;
+
+	/**
+	 * @brief 查询某个级别输出信息的次数
+	 * @note 进程内所有编译的总数, 单次编译的计数见DiagnosticEngine
+	 */
 	static
 	auto search_counter(Location::DiagKind kind) -> std::size_t;
 
 private:
+	/// @brief 以DiagKind为下标, 多个线程同时report时无需加锁
 	static inline
-	std::unordered_map<Location::DiagKind, std::size_t> trace_counter;
+	std::array<std::atomic<std::size_t>, Location::dk_note + 1> trace_counter {};
 	
 	static
 	void count(Location::DiagKind kind);
 
+	/// @brief 由m_line_index构造消息, 包括行列号, 所在行与该行中的范围
+	auto make_diagnostic(llvm::SourceMgr::DiagKind kind, std::string_view msg) const
+		-> llvm::SMDiagnostic;
+
 	static constexpr
 	auto cvt_kind_to_llvm(Location::DiagKind kind) -> llvm::SourceMgr::DiagKind;
 
 	mutable
-	const llvm::SourceMgr* m_src_mgr;
+	const llvm::SourceMgr* m_src_mgr = nullptr;
+	mutable
+	const LineIndex* m_line_index = nullptr;
 
 };
 
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include "ast.hpp"
+#include "bison_parser.hpp"
+#include "llvm_location.hpp"
+
+namespace tinyc
+{
+
+class Driver;
+
+/**
+ * @brief 手写的递归下降parser, 与parser.yy构造完全相同的语法树, 包括节点位置
+ * @note 词法分析仍使用flex生成的yylex, 语义值直接移入节点, 不经过bison的符号栈
+ * @note 表达式每个优先级一层循环, 操作符由表驱动; 语法树为每个优先级保留一个节点, \
+ * 因此不能像一般的precedence climbing那样跳过中间层
+ * @note 与bison文法相同, 在语句, 块与参数处恢复错误
+ */
+class RecursiveDescentParser
+{
+public:
+	explicit RecursiveDescentParser(Driver& driver);
+
+	/**
+	 * @brief 解析完整的CompUnit, 结果通过Driver::set_ast交给driver
+	 * @return 没有语法错误时为true
+	 * @note 错误通过yy::parser::error报告, 与bison parser的计数方式一致
+	 */
+	auto parse() -> bool;
+
+private:
+	using symbol_type = yy::parser::symbol_type;
+	using token_kind = yy::parser::symbol_kind::symbol_kind_type;
+
+	auto parse_func_def() -> std::unique_ptr<FuncDef>;
+	auto parse_type() -> std::unique_ptr<Type>;
+	auto parse_ident() -> std::unique_ptr<Ident>;
+	/// @param lparen "("的位置, 空参数列表的位置为其末尾
+	auto parse_param_list(const LLVMLocation& lparen) -> std::unique_ptr<ParamList>;
+	auto parse_param() -> std::unique_ptr<Param>;
+	auto parse_block() -> std::unique_ptr<Block>;
+	auto parse_stmt() -> std::unique_ptr<Stmt>;
+	auto parse_expr() -> std::unique_ptr<Expr>;
+	auto parse_primary_expr() -> std::unique_ptr<PrimaryExpr>;
+	auto parse_unary_expr() -> std::unique_ptr<UnaryExpr>;
+
+	/// @brief SelfExpr ::= Higher (Op Higher)*, 左结合
+	template<typename SelfExpr>
+	auto parse_binary_expr() -> std::unique_ptr<SelfExpr>;
+
+	/// @brief 当前记号属于Op的操作符表时构造操作符节点并前进, 否则返回nullptr
+	template<typename Op>
+	auto parse_op() -> std::unique_ptr<Op>;
+
+	/// @brief 读入下一个记号
+	void advance();
+	auto peek() const -> token_kind
+	{ return m_token->kind(); }
+	auto location() const -> const LLVMLocation&
+	{ return m_token->location; }
+
+	/**
+	 * @brief 当前记号为kind时前进并返回其位置, 否则报告错误
+	 */
+	auto expect(token_kind kind) -> std::optional<LLVMLocation>;
+
+	/// @brief 以当前记号为位置报告错误, 错误恢复完成前不重复报告
+	void error_unexpected(std::string_view expecting);
+
+	/**
+	 * @brief 丢弃记号直到遇到sync_a或sync_b, 不消耗同步记号
+	 * @return 遇到文件结束时为false
+	 */
+	auto synchronize(token_kind sync_a, token_kind sync_b) -> bool;
+
+	/// @brief 起始于first, 结束于last的位置, 与YYLLOC_DEFAULT相同
+	static
+	auto span(const BaseAST& first, const BaseAST& last) -> std::unique_ptr<LLVMLocation>;
+	static
+	auto span(const LLVMLocation& first, const LLVMLocation& last)
+		-> std::unique_ptr<LLVMLocation>;
+	static
+	auto location_of(const BaseAST& node) -> const LLVMLocation&;
+
+private:
+	Driver& m_driver;
+	std::optional<symbol_type> m_token;
+	/// @brief 报告错误后到下一个同步记号之前为true
+	bool m_recovering;
+};
+
+}	//namespace tinyc
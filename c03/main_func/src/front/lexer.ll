@@ -21,7 +21,7 @@
 
 %}
 
-%option noyywrap nounput noinput batch debug
+%option reentrant noyywrap nounput noinput batch debug
 
 blank	 		[ \t\r\n]+
 LineComment		\/\/[^\n]*\n
@@ -37,6 +37,9 @@ UnsignedInt		(unsigned\s+int)|(unsigned)
 	//如果之前已经步进过，则此时不会改变
 	auto& loc = driver.get_location();
 	loc.step();
+	//错误过多时不再读取剩余输入
+	if (driver.should_stop())
+		return yy::parser::make_YYEOF(loc);
 %}
 
 {blank}			LOC_UPDATE_NORMAL(loc);
@@ -84,8 +87,17 @@ namespace tinyc
 
 void Driver::set_flex(const char* buffer, int buffer_size)
 {
-	yy_flex_debug = this->get_trace();
-	yy_scan_bytes(buffer, buffer_size);
+	yylex_init(&m_scanner);
+	yyset_debug(this->get_trace(), m_scanner);
+	yy_scan_bytes(buffer, buffer_size, m_scanner);
+}
+
+void Driver::release_flex()
+{
+	if (m_scanner == nullptr)
+		return;
+	yylex_destroy(m_scanner);
+	m_scanner = nullptr;
 }
 
 }	//namespace tinyc
@@ -0,0 +1,87 @@
+#include "line_index.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace tinyc
+{
+
+LineIndex::LineIndex():
+	m_buffer {},
+	m_line_starts { 0 }
+{}
+
+LineIndex::LineIndex(llvm::StringRef buffer):
+	m_buffer { buffer },
+	m_line_starts {}
+{
+	scan_newlines();
+}
+
+auto LineIndex::get_line_and_column(const char* ptr) const
+	-> std::pair<unsigned, unsigned>
+{
+	if (!contains(ptr))
+		return { 0, 0 };
+
+	auto offset = static_cast<std::size_t>(ptr - m_buffer.begin());
+	// 第一个大于offset的行首之前即为所在行
+	auto next_line = std::ranges::upper_bound(m_line_starts, offset);
+	auto line = static_cast<std::size_t>(next_line - m_line_starts.begin());
+	auto column = offset - *(next_line - 1) + 1;
+	return { static_cast<unsigned>(line), static_cast<unsigned>(column) };
+}
+
+auto LineIndex::get_line_text(std::size_t line) const -> llvm::StringRef
+{
+	auto start = get_line_start(line);
+	// 与SourceMgr相同, 行尾在'\n'或'\r'处截断
+	auto end = std::min(m_buffer.find_first_of("\n\r", start), m_buffer.size());
+	return m_buffer.slice(start, end);
+}
+
+void LineIndex::scan_newlines()
+{
+	const char* begin = m_buffer.begin();
+	const char* end = m_buffer.end();
+	const char* cur = begin;
+
+	m_line_starts.clear();
+	// 按平均每行约32字节预留, 避免扫描中反复扩容
+	m_line_starts.reserve(m_buffer.size() / 32 + 1);
+	m_line_starts.push_back(0);
+
+#ifdef __SSE2__
+	// 每次比较16字节, 掩码中的每一位对应一个'\n'
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; end - cur >= 16; cur += 16)
+	{
+		auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+		auto mask = static_cast<unsigned>(
+			_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+		while (mask != 0)
+		{
+			auto bit = static_cast<std::size_t>(std::countr_zero(mask));
+			m_line_starts.push_back(static_cast<std::size_t>(cur - begin) + bit + 1);
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	// 剩余不足16字节的部分, 或没有SSE2时的整个缓冲区
+	while (cur != end)
+	{
+		auto found = static_cast<const char*>(
+			std::memchr(cur, '\n', static_cast<std::size_t>(end - cur)));
+		if (found == nullptr)
+			break;
+		m_line_starts.push_back(static_cast<std::size_t>(found - begin) + 1);
+		cur = found + 1;
+	}
+}
+
+}	//namespace tinyc
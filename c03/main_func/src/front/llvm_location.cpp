@@ -1,5 +1,6 @@
 #include "llvm_location.hpp"
 #include <llvm/Support/raw_ostream.h>
+#include <algorithm>
 #include <cassert>
 #include <easylog.hpp>
 
@@ -22,9 +23,45 @@ void LLVMLocation::report(Location::DiagKind kind, std::string_view msg) const
 	assert(m_src_mgr != nullptr && "m_src_mgr uninitialized");
 	assert(m_src_mgr->getNumBuffers() > 0);
 
-	auto range = get_range();
 	count(kind);
-	m_src_mgr->PrintMessage(begin, cvt_kind_to_llvm(kind), msg, range);
+	if (m_line_index == nullptr || !m_line_index->contains(begin.getPointer()))
+	{
+		m_src_mgr->PrintMessage(begin, cvt_kind_to_llvm(kind), msg, get_range());
+		return;
+	}
+	m_src_mgr->PrintMessage(llvm::errs(), make_diagnostic(cvt_kind_to_llvm(kind), msg));
+}
+
+auto LLVMLocation::make_diagnostic(llvm::SourceMgr::DiagKind kind,
+								   std::string_view msg) const -> llvm::SMDiagnostic
+{
+	assert(m_line_index != nullptr && m_line_index->contains(begin.getPointer()));
+
+	// FindBufferContainingLoc只读, 不会建立行号缓存
+	auto buffer_id = m_src_mgr->FindBufferContainingLoc(begin);
+	assert(buffer_id != 0);
+	auto file_name = m_src_mgr->getMemoryBuffer(buffer_id)->getBufferIdentifier();
+
+	auto [line, column] = m_line_index->get_line_and_column(begin.getPointer());
+	auto line_text = m_line_index->get_line_text(line - 1);
+	const char* line_begin = line_text.begin();
+	const char* line_end = line_text.end();
+
+	// 与SourceMgr::GetMessage相同, 只保留范围在当前行中的部分
+	llvm::SmallVector<std::pair<unsigned, unsigned>, 1> column_ranges;
+	auto range = get_range();
+	if (range.isValid() && range.Start.getPointer() <= line_end
+		&& range.End.getPointer() >= line_begin)
+	{
+		auto range_begin = std::max(range.Start.getPointer(), line_begin);
+		auto range_end = std::min(range.End.getPointer(), line_end);
+		column_ranges.emplace_back(static_cast<unsigned>(range_begin - line_begin),
+								   static_cast<unsigned>(range_end - line_begin));
+	}
+
+	return llvm::SMDiagnostic { *m_src_mgr, begin, file_name, static_cast<int>(line),
+								static_cast<int>(column - 1), kind, msg, line_text,
+								column_ranges };
 }
 
 void LLVMLocation::set_src_mgr(const llvm::SourceMgr* src_mgr) const
@@ -32,6 +69,15 @@ void LLVMLocation::set_src_mgr(const llvm::SourceMgr* src_mgr) const
 	m_src_mgr = src_mgr;
 }
 
+auto LLVMLocation::get_line_and_column() const -> std::pair<unsigned, unsigned>
+{
+	if (m_line_index != nullptr && m_line_index->contains(begin.getPointer()))
+		return m_line_index->get_line_and_column(begin.getPointer());
+	if (m_src_mgr == nullptr || !begin.isValid())
+		return { 0, 0 };
+	return m_src_mgr->getLineAndColumn(begin);
+}
+
 auto LLVMLocation::get_range() const -> llvm::SMRange
 {
 	return llvm::SMRange { begin, end };
@@ -49,12 +95,12 @@ void LLVMLocation::update(std::size_t len)
 
 auto LLVMLocation::search_counter(Location::DiagKind kind) -> std::size_t
 {
-	return trace_counter[kind];
+	return trace_counter[kind].load(std::memory_order_relaxed);
 }
 
 void LLVMLocation::count(Location::DiagKind kind)
 {
-	++trace_counter[kind];
+	trace_counter[kind].fetch_add(1, std::memory_order_relaxed);
 }
 
 constexpr
@@ -80,8 +126,12 @@ auto operator<< (std::ostream& os, const LLVMLocation& loc) -> std::ostream&
 {
 	std::string output_buffer;
 	llvm::raw_string_ostream stros { output_buffer };
-	loc.m_src_mgr->PrintMessage(stros, loc.begin,
-			llvm::SourceMgr::DK_Note, "", loc.get_range());
+	if (loc.m_line_index != nullptr && loc.m_line_index->contains(loc.begin.getPointer()))
+		loc.make_diagnostic(llvm::SourceMgr::DK_Note, "").print(nullptr, stros);
+	else
+		loc.m_src_mgr->PrintMessage(stros, loc.begin,
+				llvm::SourceMgr::DK_Note, "", loc.get_range());
+	stros.flush();
 
 	os << output_buffer << std::endl;
 
@@ -16,7 +16,8 @@
 namespace tinyc { class Driver; }
 }
 
-%param { tinyc::Driver& driver }
+// yyscanner为flex的yyscan_t, 由driver持有
+%param { tinyc::Driver& driver } { void* yyscanner }
 
 %locations	//生成location定位
 %define api.location.type { tinyc::LLVMLocation }	//使用自定义location类型
@@ -72,11 +73,13 @@ namespace tinyc { class Driver; }
 %nterm <std::unique_ptr<tinyc::Expr>>			Expr
 %nterm <std::unique_ptr<tinyc::Stmt>>			Stmt
 %nterm <std::unique_ptr<tinyc::Block>>			Block
+%nterm <tinyc::Block::Vector>					StmtList
 %nterm <std::unique_ptr<tinyc::Type>>			Type
 %nterm <std::unique_ptr<tinyc::Param>>			Param
 %nterm <std::unique_ptr<tinyc::ParamList>>		ParamList
 %nterm <std::unique_ptr<tinyc::FuncDef>>		FuncDef
 %nterm <std::unique_ptr<tinyc::CompUnit>>		CompUnit
+%nterm <tinyc::CompUnit::Vector>				FuncDefList
 %nterm <std::unique_ptr<tinyc::UnaryExpr>>		UnaryExpr
 %nterm <std::unique_ptr<tinyc::UnaryOp>>		UnaryOp
 %nterm <std::unique_ptr<tinyc::PrimaryExpr>>	PrimaryExpr
@@ -99,10 +102,8 @@ namespace tinyc { class Driver; }
 %start CompUnit;
 
 CompUnit:
-	FuncDef 
+	FuncDefList
 	{
-		//llvm::isa足够智能，能够区分裸指针和智能指针的情况
-		assert_same_ptr(tinyc::FuncDef, $1);
 		std::unique_ptr<tinyc::Location> location =
 			CONSTRUCT_LOCATION(@$);
 		auto comp_unit_ptr =
@@ -110,6 +111,22 @@ CompUnit:
 		driver.set_ast(std::move(comp_unit_ptr));
 	};
 
+FuncDefList:
+	FuncDef
+	{
+		assert_same_ptr(tinyc::FuncDef, $1);
+		tinyc::CompUnit::Vector func_defs;
+		driver.collect_func_def(func_defs, std::move($1));
+		$$ = std::move(func_defs);
+	}
+	| FuncDefList FuncDef
+	{
+		assert_same_ptr(tinyc::FuncDef, $2);
+		auto func_defs = std::move($1);
+		driver.collect_func_def(func_defs, std::move($2));
+		$$ = std::move(func_defs);
+	};
+
 FuncDef :
 //   1	   2 	3      4   	  5   6
 	Type Ident "(" ParamList ")" Block
@@ -136,7 +153,8 @@ ParamList :
 	{
 		assert_same_ptr(tinyc::Param, $1);
 		auto param_list_ptr = std::make_unique<tinyc::ParamList>(CONSTRUCT_LOCATION(@$));
-		param_list_ptr->add_param(std::move($1));
+		if ($1 != nullptr)
+			param_list_ptr->add_param(std::move($1));
 		$$ = std::move(param_list_ptr);
 	}
 	| ParamList "," Param
@@ -145,7 +163,8 @@ ParamList :
 		assert_same_ptr(tinyc::Param, $3);
 
 		auto param_list_ptr = std::move($1);
-		param_list_ptr->add_param(std::move($3));
+		if ($3 != nullptr)
+			param_list_ptr->add_param(std::move($3));
 		$$ = std::move(param_list_ptr);
 	}
 
@@ -157,6 +176,11 @@ Param :
 		auto param_ptr = std::make_unique<tinyc::Param>(CONSTRUCT_LOCATION(@$), std::move($1), std::move($2));
 		$$ = std::move(param_ptr);
 	}
+	//错误恢复: 丢弃到下一个","或")", 不加入ParamList
+	| error
+	{
+		$$ = nullptr;
+	}
 
 Type        
 	: KW_SINT {
@@ -170,12 +194,27 @@ Type
 	};
 
 Block
-	: "{" Stmt "}"{
-		assert_same_ptr(tinyc::Stmt, $2);
-		//这里暂时只匹配单个表达式
-		auto block_ptr = std::make_unique<tinyc::Block>(CONSTRUCT_LOCATION(@$));
-		block_ptr->add_stmt(std::move($2));
-		$$ = std::move(block_ptr);
+	: "{" StmtList "}" {
+		$$ = std::make_unique<tinyc::Block>(CONSTRUCT_LOCATION(@$), std::move($2));
+	}
+	//错误恢复: 块内无法同步到";"时丢弃整个块
+	| "{" error "}" {
+		yyerrok;
+		$$ = std::make_unique<tinyc::Block>(CONSTRUCT_LOCATION(@$));
+	};
+
+StmtList
+	: Stmt {
+		tinyc::Block::Vector stmts;
+		if ($1 != nullptr)
+			stmts.push_back(std::move($1));
+		$$ = std::move(stmts);
+	}
+	| StmtList Stmt {
+		auto stmts = std::move($1);
+		if ($2 != nullptr)
+			stmts.push_back(std::move($2));
+		$$ = std::move(stmts);
 	};
 
 Stmt
@@ -183,6 +222,11 @@ Stmt
 		assert_same_ptr(tinyc::Expr, $2);
 		auto stmt_ptr = std::make_unique<tinyc::Stmt>(CONSTRUCT_LOCATION(@$), std::move($2));
 		$$ = std::move(stmt_ptr);
+	}
+	//错误恢复: 丢弃到下一个";", 之后的语句继续解析
+	| error ";" {
+		yyerrok;
+		$$ = nullptr;
 	};
 
 Expr
@@ -380,6 +424,7 @@ namespace yy
 void parser::error(const location_type& loc, const std::string& m)
 {
 	loc.report(tinyc::Location::dk_error, m);
+	driver.count_syntax_error();
 }
 
 }	//namespace yy
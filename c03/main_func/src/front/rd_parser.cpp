@@ -0,0 +1,443 @@
+#include "rd_parser.hpp"
+#include "driver.hpp"
+#include <format>
+#include <span>
+#include <type_traits>
+
+namespace tinyc
+{
+
+namespace
+{
+
+using symbol_kind = yy::parser::symbol_kind;
+
+struct OpEntry
+{
+	symbol_kind::symbol_kind_type token;
+	Operation::OperationType type;
+};
+
+// 各优先级的操作符, 与parser.yy中的*Op产生式一一对应
+constexpr OpEntry unary_ops[] {
+	{ symbol_kind::S_OP_ADD, Operation::op_add },
+	{ symbol_kind::S_OP_SUB, Operation::op_sub },
+	{ symbol_kind::S_OP_NOT, Operation::op_not },
+};
+constexpr OpEntry l3_ops[] {
+	{ symbol_kind::S_OP_MUL, Operation::op_mul },
+	{ symbol_kind::S_OP_DIV, Operation::op_div },
+	{ symbol_kind::S_OP_MOD, Operation::op_mod },
+};
+constexpr OpEntry l4_ops[] {
+	{ symbol_kind::S_OP_ADD, Operation::op_add },
+	{ symbol_kind::S_OP_SUB, Operation::op_sub },
+};
+constexpr OpEntry l6_ops[] {
+	{ symbol_kind::S_OP_LT, Operation::op_lt },
+	{ symbol_kind::S_OP_GT, Operation::op_gt },
+	{ symbol_kind::S_OP_LE, Operation::op_le },
+	{ symbol_kind::S_OP_GE, Operation::op_ge },
+};
+constexpr OpEntry l7_ops[] {
+	{ symbol_kind::S_OP_EQ, Operation::op_eq },
+	{ symbol_kind::S_OP_NE, Operation::op_ne },
+};
+constexpr OpEntry land_ops[] {
+	{ symbol_kind::S_OP_LAND, Operation::op_land },
+};
+constexpr OpEntry lor_ops[] {
+	{ symbol_kind::S_OP_LOR, Operation::op_lor },
+};
+
+template<typename Op>
+constexpr auto op_table() -> std::span<const OpEntry>
+{
+	if constexpr (std::is_same_v<Op, UnaryOp>)
+		return unary_ops;
+	else if constexpr (std::is_same_v<Op, L3Op>)
+		return l3_ops;
+	else if constexpr (std::is_same_v<Op, L4Op>)
+		return l4_ops;
+	else if constexpr (std::is_same_v<Op, L6Op>)
+		return l6_ops;
+	else if constexpr (std::is_same_v<Op, L7Op>)
+		return l7_ops;
+	else if constexpr (std::is_same_v<Op, LAndOp>)
+		return land_ops;
+	else if constexpr (std::is_same_v<Op, LOrOp>)
+		return lor_ops;
+	else
+		static_assert(!sizeof(Op), "no operator table for Op");
+}
+
+}	//namespace
+
+RecursiveDescentParser::RecursiveDescentParser(Driver& driver):
+	m_driver { driver },
+	m_token {},
+	m_recovering { false }
+{
+}
+
+auto RecursiveDescentParser::parse() -> bool
+{
+	advance();
+
+	CompUnit::Vector func_defs;
+	std::optional<LLVMLocation> first;
+	std::optional<LLVMLocation> last;
+	do
+	{
+		// 与parser.yy相同, 函数层面没有恢复规则
+		auto func_def = parse_func_def();
+		if (func_def == nullptr)
+			return false;
+
+		if (!first)
+			first = location_of(*func_def);
+		last = location_of(*func_def);
+		m_driver.collect_func_def(func_defs, std::move(func_def));
+	} while (peek() != symbol_kind::S_YYEOF);
+
+	m_driver.set_ast(std::make_unique<CompUnit>(span(*first, *last),
+												std::move(func_defs)));
+	return true;
+}
+
+auto RecursiveDescentParser::parse_func_def() -> std::unique_ptr<FuncDef>
+{
+	auto type = parse_type();
+	if (type == nullptr)
+		return nullptr;
+	auto ident = parse_ident();
+	if (ident == nullptr)
+		return nullptr;
+	auto lparen = expect(symbol_kind::S_DELIM_LPAREN);
+	if (!lparen)
+		return nullptr;
+	auto param_list = parse_param_list(*lparen);
+	if (!expect(symbol_kind::S_DELIM_RPAREN))
+		return nullptr;
+	auto block = parse_block();
+	if (block == nullptr)
+		return nullptr;
+
+	auto location = span(*type, *block);
+	return std::make_unique<FuncDef>(std::move(location), std::move(type),
+									 std::move(ident), std::move(param_list),
+									 std::move(block));
+}
+
+auto RecursiveDescentParser::parse_type() -> std::unique_ptr<Type>
+{
+	Type::TypeEnum type;
+	switch (peek())
+	{
+	case symbol_kind::S_KW_SINT:
+		type = Type::ty_signed_int;
+		break;
+	case symbol_kind::S_KW_UINT:
+		type = Type::ty_unsigned_int;
+		break;
+	case symbol_kind::S_KW_VOID:
+		type = Type::ty_void;
+		break;
+	default:
+		error_unexpected("type");
+		return nullptr;
+	}
+
+	auto node = std::make_unique<Type>(std::make_unique<LLVMLocation>(location()), type);
+	advance();
+	return node;
+}
+
+auto RecursiveDescentParser::parse_ident() -> std::unique_ptr<Ident>
+{
+	if (peek() != symbol_kind::S_IDENT)
+	{
+		error_unexpected(yy::parser::symbol_name(symbol_kind::S_IDENT));
+		return nullptr;
+	}
+
+	auto node = std::make_unique<Ident>(std::make_unique<LLVMLocation>(location()),
+										std::move(m_token->value.as<std::string>()));
+	advance();
+	return node;
+}
+
+auto RecursiveDescentParser::parse_param_list(const LLVMLocation& lparen)
+	-> std::unique_ptr<ParamList>
+{
+	// 空产生式的位置为前一个记号的末尾
+	if (peek() == symbol_kind::S_DELIM_RPAREN)
+	{
+		auto location = std::make_unique<LLVMLocation>(lparen);
+		location->begin = location->end;
+		return std::make_unique<ParamList>(std::move(location));
+	}
+
+	// parser.yy在归约第一个参数时创建ParamList, 之后不再更新其位置
+	auto start = location();
+	auto first = parse_param();
+	auto param_list = std::make_unique<ParamList>(std::make_unique<LLVMLocation>(
+		first != nullptr ? location_of(*first) : start));
+	if (first != nullptr)
+		param_list->add_param(std::move(first));
+
+	while (peek() == symbol_kind::S_DELIM_COMMA)
+	{
+		advance();
+		if (auto param = parse_param(); param != nullptr)
+			param_list->add_param(std::move(param));
+	}
+
+	return param_list;
+}
+
+auto RecursiveDescentParser::parse_param() -> std::unique_ptr<Param>
+{
+	auto type = parse_type();
+	auto ident = type != nullptr ? parse_ident() : nullptr;
+	if (ident == nullptr)
+	{
+		// 错误恢复: 丢弃到下一个","或")"
+		synchronize(symbol_kind::S_DELIM_COMMA, symbol_kind::S_DELIM_RPAREN);
+		return nullptr;
+	}
+
+	auto location = span(*type, *ident);
+	return std::make_unique<Param>(std::move(location), std::move(type), std::move(ident));
+}
+
+auto RecursiveDescentParser::parse_block() -> std::unique_ptr<Block>
+{
+	auto lbrace = expect(symbol_kind::S_DELIM_LBRACE);
+	if (!lbrace)
+		return nullptr;
+
+	// 文法要求块中至少有一条语句
+	if (peek() == symbol_kind::S_DELIM_RBRACE)
+		error_unexpected(yy::parser::symbol_name(symbol_kind::S_KW_RETURN));
+
+	Block::Vector stmts;
+	while (peek() != symbol_kind::S_DELIM_RBRACE && peek() != symbol_kind::S_YYEOF)
+	{
+		if (auto stmt = parse_stmt(); stmt != nullptr)
+			stmts.push_back(std::move(stmt));
+	}
+
+	auto rbrace = expect(symbol_kind::S_DELIM_RBRACE);
+	if (!rbrace)
+		return nullptr;
+	m_recovering = false;
+
+	return std::make_unique<Block>(span(*lbrace, *rbrace), std::move(stmts));
+}
+
+auto RecursiveDescentParser::parse_stmt() -> std::unique_ptr<Stmt>
+{
+	if (auto kw_return = expect(symbol_kind::S_KW_RETURN))
+	{
+		if (auto expr = parse_expr(); expr != nullptr)
+		{
+			if (auto semicolon = expect(symbol_kind::S_DELIM_SEMICOLON))
+			{
+				return std::make_unique<Stmt>(span(*kw_return, *semicolon),
+											  std::move(expr));
+			}
+		}
+	}
+
+	// 错误恢复: 丢弃到下一个";", 遇到"}"时交给块结束
+	if (synchronize(symbol_kind::S_DELIM_SEMICOLON, symbol_kind::S_DELIM_RBRACE) &&
+		peek() == symbol_kind::S_DELIM_SEMICOLON)
+	{
+		advance();
+	}
+	return nullptr;
+}
+
+auto RecursiveDescentParser::parse_expr() -> std::unique_ptr<Expr>
+{
+	auto low_expr = parse_binary_expr<LowExpr>();
+	if (low_expr == nullptr)
+		return nullptr;
+
+	auto location = std::make_unique<LLVMLocation>(location_of(*low_expr));
+	return std::make_unique<Expr>(std::move(location), std::move(low_expr));
+}
+
+auto RecursiveDescentParser::parse_primary_expr() -> std::unique_ptr<PrimaryExpr>
+{
+	switch (peek())
+	{
+	case symbol_kind::S_DELIM_LPAREN:
+	{
+		auto lparen = location();
+		advance();
+		auto expr = parse_expr();
+		if (expr == nullptr)
+			return nullptr;
+		auto rparen = expect(symbol_kind::S_DELIM_RPAREN);
+		if (!rparen)
+			return nullptr;
+		return std::make_unique<PrimaryExpr>(span(lparen, *rparen), std::move(expr));
+	}
+	case symbol_kind::S_INT_LITERAL:
+	{
+		auto number_location = location();
+		auto number = std::make_unique<Number>(
+			std::make_unique<LLVMLocation>(number_location), m_token->value.as<int>());
+		advance();
+		return std::make_unique<PrimaryExpr>(
+			std::make_unique<LLVMLocation>(number_location), std::move(number));
+	}
+	case symbol_kind::S_IDENT:
+	{
+		auto ident = parse_ident();
+		auto ident_location = std::make_unique<LLVMLocation>(location_of(*ident));
+		return std::make_unique<PrimaryExpr>(std::move(ident_location), std::move(ident));
+	}
+	default:
+		error_unexpected("expression");
+		return nullptr;
+	}
+}
+
+auto RecursiveDescentParser::parse_unary_expr() -> std::unique_ptr<UnaryExpr>
+{
+	if (auto unary_op = parse_op<UnaryOp>(); unary_op != nullptr)
+	{
+		auto unary_expr = parse_unary_expr();
+		if (unary_expr == nullptr)
+			return nullptr;
+		auto location = span(*unary_op, *unary_expr);
+		return std::make_unique<UnaryExpr>(std::move(location), std::move(unary_op),
+										   std::move(unary_expr));
+	}
+
+	auto primary_expr = parse_primary_expr();
+	if (primary_expr == nullptr)
+		return nullptr;
+	auto location = std::make_unique<LLVMLocation>(location_of(*primary_expr));
+	return std::make_unique<UnaryExpr>(std::move(location), std::move(primary_expr));
+}
+
+template<typename SelfExpr>
+auto RecursiveDescentParser::parse_binary_expr() -> std::unique_ptr<SelfExpr>
+{
+	using HigherExpr = typename SelfExpr::HigherExprPtr::element_type;
+	using Op = typename SelfExpr::OpPtr::element_type;
+
+	auto parse_higher = [this] {
+		if constexpr (std::is_same_v<HigherExpr, UnaryExpr>)
+			return parse_unary_expr();
+		else
+			return parse_binary_expr<HigherExpr>();
+	};
+
+	auto higher = parse_higher();
+	if (higher == nullptr)
+		return nullptr;
+	auto expr = std::make_unique<SelfExpr>(
+		std::make_unique<LLVMLocation>(location_of(*higher)), std::move(higher));
+
+	// 左结合: 每读到一个同级操作符, 已有的表达式成为左操作数
+	while (auto op = parse_op<Op>())
+	{
+		auto rhs = parse_higher();
+		if (rhs == nullptr)
+			return nullptr;
+		auto location = span(*expr, *rhs);
+		expr = std::make_unique<SelfExpr>(std::move(location), std::move(expr),
+										  std::move(op), std::move(rhs));
+	}
+
+	return expr;
+}
+
+template<typename Op>
+auto RecursiveDescentParser::parse_op() -> std::unique_ptr<Op>
+{
+	for (const auto& entry : op_table<Op>())
+	{
+		if (entry.token != peek())
+			continue;
+
+		auto op = std::make_unique<Op>(std::make_unique<LLVMLocation>(location()),
+									   entry.type);
+		advance();
+		return op;
+	}
+	return nullptr;
+}
+
+void RecursiveDescentParser::advance()
+{
+	m_token.emplace(yylex(m_driver, m_driver.get_scanner()));
+}
+
+auto RecursiveDescentParser::expect(token_kind kind)
+	-> std::optional<LLVMLocation>
+{
+	if (peek() != kind)
+	{
+		error_unexpected(yy::parser::symbol_name(kind));
+		return std::nullopt;
+	}
+
+	auto token_location = location();
+	advance();
+	return token_location;
+}
+
+void RecursiveDescentParser::error_unexpected(std::string_view expecting)
+{
+	if (m_recovering)
+		return;
+	m_recovering = true;
+
+	// 非法字符已经由yylex报告
+	if (peek() == symbol_kind::S_YYerror)
+		return;
+
+	m_driver.get_parser().error(location(), std::format(
+		"syntax error, unexpected {}, expecting {}",
+		yy::parser::symbol_name(peek()), expecting));
+}
+
+auto RecursiveDescentParser::synchronize(token_kind sync_a, token_kind sync_b) -> bool
+{
+	while (peek() != sync_a && peek() != sync_b)
+	{
+		if (peek() == symbol_kind::S_YYEOF)
+			return false;
+		advance();
+	}
+	m_recovering = false;
+	return true;
+}
+
+auto RecursiveDescentParser::span(const BaseAST& first, const BaseAST& last)
+	-> std::unique_ptr<LLVMLocation>
+{
+	return span(location_of(first), location_of(last));
+}
+
+auto RecursiveDescentParser::span(const LLVMLocation& first, const LLVMLocation& last)
+	-> std::unique_ptr<LLVMLocation>
+{
+	auto location = std::make_unique<LLVMLocation>(first);
+	location->end = last.end;
+	return location;
+}
+
+auto RecursiveDescentParser::location_of(const BaseAST& node) -> const LLVMLocation&
+{
+	// 语法树中的位置均由LLVMLocation构造
+	return static_cast<const LLVMLocation&>(node.get_location());
+}
+
+}	//namespace tinyc
@@ -0,0 +1,187 @@
+#include <easylog.hpp>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/CodeGen/CommandFlags.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/Support/Caching.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/Triple.h>
+
+#include <format>
+#include <memory>
+#include <vector>
+
+/**
+ * tinyc-lto: 读取tinyc -flto=thin输出的位码, 完成ThinLTO
+ * 根据各模块的摘要并行地跨模块导入, 内联, 优化, 每个模块输出一个目标文件
+ */
+
+//帮助lto::Config生成target_options
+static llvm::codegen::RegisterCodeGenFlags CGF;
+
+static llvm::cl::list<std::string> input_files {
+	llvm::cl::Positional,
+	llvm::cl::desc("<input bitcode files>"),
+	llvm::cl::OneOrMore
+};
+
+static llvm::cl::opt<std::string> output_file {
+	"o",
+	llvm::cl::desc("Output prefix, objects are written to <prefix>.<task>.o"),
+	llvm::cl::value_desc("prefix"),
+	llvm::cl::init("output")
+};
+
+/// 0 表示使用全部物理核心
+static llvm::cl::opt<unsigned> jobs {
+	"j",
+	llvm::cl::desc("Number of ThinLTO backend threads"),
+	llvm::cl::value_desc("N"),
+	llvm::cl::init(0)
+};
+
+static llvm::cl::opt<unsigned> opt_level {
+	"O",
+	llvm::cl::desc("Optimization level for the ThinLTO backends"),
+	llvm::cl::Prefix,
+	llvm::cl::init(2)
+};
+
+/// 未指定时所有符号都保持对外可见, 指定后其余符号可以被内部化
+static llvm::cl::list<std::string> exported_symbols {
+	"export",
+	llvm::cl::desc("Symbols that must stay visible outside the LTO unit"),
+	llvm::cl::CommaSeparated,
+	llvm::cl::value_desc("symbol")
+};
+
+/**
+ * @brief 模拟链接器的符号决议
+ * @note 第一个定义为prevailing, 之后的强定义视为重复定义
+ * @return 出错时返回false, 已输出错误信息
+ */
+auto resolve_symbols(const llvm::lto::InputFile& input, llvm::StringSet<>& defined,
+					 std::vector<llvm::lto::SymbolResolution>& resolutions) -> bool
+{
+	llvm::StringSet<> exported;
+	for (const auto& symbol : exported_symbols)
+		exported.insert(symbol);
+
+	for (const auto& symbol : input.symbols())
+	{
+		llvm::lto::SymbolResolution resolution;
+		if (!symbol.isUndefined())
+		{
+			resolution.Prevailing = defined.insert(symbol.getName()).second;
+			if (!resolution.Prevailing && !symbol.isWeak())
+			{
+				yq::error("duplicate symbol {} in {}", symbol.getName().str(),
+						  input.getName().str());
+				return false;
+			}
+			resolution.FinalDefinitionInLinkageUnit = true;
+		}
+		resolution.VisibleToRegularObj =
+			exported.empty() || exported.contains(symbol.getName());
+		resolutions.push_back(resolution);
+	}
+	return true;
+}
+
+auto create_config() -> llvm::lto::Config
+{
+	llvm::lto::Config config;
+	auto triple = llvm::Triple { llvm::sys::getDefaultTargetTriple() };
+
+	config.Options = llvm::codegen::InitTargetOptionsFromCodeGenFlags(triple);
+	config.CPU = llvm::codegen::getCPUStr();
+	config.MAttrs = llvm::codegen::getMAttrs();
+	config.RelocModel = llvm::codegen::getExplicitRelocModel();
+	config.CodeModel = llvm::codegen::getExplicitCodeModel();
+	config.DefaultTriple = triple.getTriple();
+	config.OptLevel = opt_level;
+	config.CGOptLevel = opt_level == 0 ? llvm::CodeGenOptLevel::None
+										: llvm::CodeGenOptLevel::Default;
+	return config;
+}
+
+auto run_lto() -> int
+{
+	auto parallelism = jobs == 0 ? llvm::heavyweight_hardware_concurrency()
+								 : llvm::heavyweight_hardware_concurrency(jobs);
+	llvm::lto::LTO lto { create_config(),
+						 llvm::lto::createInProcessThinBackend(parallelism) };
+
+	// InputFile引用缓冲区中的内容, 需要保持到run结束
+	std::vector<std::unique_ptr<llvm::MemoryBuffer>> buffers;
+	llvm::StringSet<> defined;
+
+	for (const auto& file_name : input_files)
+	{
+		auto buffer_or_error = llvm::MemoryBuffer::getFile(file_name);
+		if (!buffer_or_error)
+		{
+			yq::error("Failed to open {}: {}", file_name,
+					  buffer_or_error.getError().message());
+			return 1;
+		}
+		buffers.push_back(std::move(*buffer_or_error));
+
+		auto input_or_error = llvm::lto::InputFile::create(*buffers.back());
+		if (!input_or_error)
+		{
+			yq::error("{}: {}", file_name, llvm::toString(input_or_error.takeError()));
+			return 1;
+		}
+
+		std::vector<llvm::lto::SymbolResolution> resolutions;
+		if (!resolve_symbols(**input_or_error, defined, resolutions))
+			return 1;
+
+		if (auto err = lto.add(std::move(*input_or_error), resolutions))
+		{
+			yq::error("{}: {}", file_name, llvm::toString(std::move(err)));
+			return 1;
+		}
+	}
+
+	// 每个后端任务写出一个目标文件, 任务之间并行
+	auto add_stream = [](unsigned task, const llvm::Twine&)
+		-> llvm::Expected<std::unique_ptr<llvm::CachedFileStream>> {
+		auto file_name = std::format("{}.{}.o", output_file.getValue(), task);
+		std::error_code ec;
+		auto os = std::make_unique<llvm::raw_fd_ostream>(
+			file_name, ec, llvm::sys::fs::OF_None);
+		if (ec)
+			return llvm::createStringError(ec, "Could not open file %s",
+										   file_name.c_str());
+		return std::make_unique<llvm::CachedFileStream>(std::move(os), file_name);
+	};
+
+	if (auto err = lto.run(add_stream))
+	{
+		yq::error("{}", llvm::toString(std::move(err)));
+		return 1;
+	}
+
+	return 0;
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+	llvm::InitLLVM X(argc, argv);
+	llvm::InitializeAllTargets();
+	llvm::InitializeAllTargetMCs();
+	llvm::InitializeAllAsmPrinters();
+	llvm::InitializeAllAsmParsers();
+
+	llvm::cl::ParseCommandLineOptions(argc, argv,
+									  "tinyc ThinLTO backend\n");
+
+	return run_lto();
+}
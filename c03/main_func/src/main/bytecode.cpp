@@ -0,0 +1,319 @@
+#include "bytecode.hpp"
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/LEB128.h>
+#include <algorithm>
+#include <array>
+#include <format>
+#include <limits>
+
+namespace tinyc
+{
+
+namespace
+{
+
+constexpr std::array<const char*, static_cast<std::size_t>(last_opcode) + 1> opcode_names {
+	"push", "neg", "logical_not", "to_bool", "add", "sub", "mul", "div", "mod",
+	"lt", "le", "gt", "ge", "eq", "ne",
+	"jump_if_zero_or_pop", "jump_if_nonzero_or_pop", "ret",
+};
+
+/// @brief 按ULEB128顺序读取, 记录第一个错误
+class Reader
+{
+public:
+	explicit Reader(llvm::StringRef buffer):
+		m_cur { reinterpret_cast<const std::uint8_t*>(buffer.begin()) },
+		m_end { reinterpret_cast<const std::uint8_t*>(buffer.end()) }
+	{}
+
+	auto read_uleb() -> std::uint64_t
+	{
+		if (has_error())
+			return 0;
+		unsigned size = 0;
+		const char* error = nullptr;
+		auto value = llvm::decodeULEB128(m_cur, &size, m_end, &error);
+		if (error != nullptr)
+		{
+			set_error(error);
+			return 0;
+		}
+		m_cur += size;
+		return value;
+	}
+
+	/// @brief 读取不超过max的整数
+	auto read_uleb(std::uint64_t max, std::string_view what) -> std::uint64_t
+	{
+		auto value = read_uleb();
+		if (!has_error() && value > max)
+			set_error(std::format("{} {} out of range", what, value));
+		return value;
+	}
+
+	auto read_bytes() -> llvm::StringRef
+	{
+		auto size = read_uleb();
+		if (has_error())
+			return {};
+		if (size > static_cast<std::uint64_t>(m_end - m_cur))
+		{
+			set_error("unexpected end of file");
+			return {};
+		}
+		llvm::StringRef bytes { reinterpret_cast<const char*>(m_cur),
+								static_cast<std::size_t>(size) };
+		m_cur += size;
+		return bytes;
+	}
+
+	auto at_end() const -> bool
+	{ return m_cur == m_end; }
+
+	void set_error(std::string msg)
+	{
+		if (m_error.empty())
+			m_error = std::move(msg);
+	}
+	auto has_error() const -> bool
+	{ return !m_error.empty(); }
+	auto get_error() const -> const std::string&
+	{ return m_error; }
+
+private:
+	const std::uint8_t* m_cur;
+	const std::uint8_t* m_end;
+	std::string m_error;
+};
+
+void write_uleb(llvm::raw_ostream& os, std::uint64_t value)
+{
+	llvm::encodeULEB128(value, os);
+}
+
+void write_bytes(llvm::raw_ostream& os, llvm::StringRef bytes)
+{
+	write_uleb(os, bytes.size());
+	os << bytes;
+}
+
+}	//namespace
+
+auto BytecodeFunction::find_position(std::uint32_t pc) const -> const Position*
+{
+	auto it = std::ranges::lower_bound(positions, pc, {}, &Position::pc);
+	if (it == positions.end() || it->pc != pc)
+		return nullptr;
+	return &*it;
+}
+
+auto BytecodeModule::find_function(std::string_view name) const -> const BytecodeFunction*
+{
+	auto it = std::ranges::find(m_functions, name, &BytecodeFunction::name);
+	return it == m_functions.end() ? nullptr : &*it;
+}
+
+void BytecodeModule::write(llvm::raw_ostream& os) const
+{
+	os.write(BytecodeFormat::magic, sizeof(BytecodeFormat::magic));
+	write_uleb(os, BytecodeFormat::version);
+	write_bytes(os, m_source_name);
+	write_uleb(os, m_functions.size());
+
+	for (const auto& function : m_functions)
+	{
+		write_bytes(os, function.name);
+		write_uleb(os, function.max_stack);
+		write_bytes(os, llvm::StringRef {
+			reinterpret_cast<const char*>(function.code.data()), function.code.size() });
+		write_uleb(os, function.positions.size());
+		for (const auto& position : function.positions)
+		{
+			write_uleb(os, position.pc);
+			write_uleb(os, position.line);
+			write_uleb(os, position.column);
+		}
+	}
+}
+
+auto BytecodeModule::read(llvm::StringRef buffer)
+	-> std::expected<BytecodeModule, std::string>
+{
+	constexpr auto magic_size = sizeof(BytecodeFormat::magic);
+	if (buffer.take_front(magic_size) != llvm::StringRef { BytecodeFormat::magic, magic_size })
+		return std::unexpected { std::string { "not a tinyc bytecode file" } };
+
+	Reader reader { buffer.drop_front(magic_size) };
+	auto version = reader.read_uleb();
+	if (!reader.has_error() && version != BytecodeFormat::version)
+	{
+		return std::unexpected { std::format("unsupported bytecode version {}, expected {}",
+				version, BytecodeFormat::version) };
+	}
+
+	constexpr std::uint64_t u32_max = std::numeric_limits<std::uint32_t>::max();
+	BytecodeModule module { reader.read_bytes().str() };
+	auto function_count = reader.read_uleb();
+	for (std::uint64_t i = 0; i < function_count && !reader.has_error(); ++i)
+	{
+		BytecodeFunction function;
+		function.name = reader.read_bytes().str();
+		function.max_stack = static_cast<std::uint32_t>(reader.read_uleb(u32_max, "stack depth"));
+		auto code = reader.read_bytes();
+		function.code.assign(code.bytes_begin(), code.bytes_end());
+
+		auto position_count = reader.read_uleb(code.size(), "position count");
+		function.positions.reserve(static_cast<std::size_t>(position_count));
+		for (std::uint64_t j = 0; j < position_count && !reader.has_error(); ++j)
+		{
+			BytecodeFunction::Position position;
+			position.pc = static_cast<std::uint32_t>(reader.read_uleb(u32_max, "pc"));
+			position.line = static_cast<std::uint32_t>(reader.read_uleb(u32_max, "line"));
+			position.column = static_cast<std::uint32_t>(reader.read_uleb(u32_max, "column"));
+			function.positions.push_back(position);
+		}
+		if (reader.has_error())
+			break;
+
+		if (!std::ranges::is_sorted(function.positions, {}, &BytecodeFunction::Position::pc))
+			return std::unexpected { std::format("{}: unsorted position table", function.name) };
+		if (auto verified = verify(function); !verified)
+			return std::unexpected { std::format("{}: {}", function.name, verified.error()) };
+		module.add_function(std::move(function));
+	}
+
+	if (!reader.has_error() && !reader.at_end())
+		reader.set_error("trailing data after the last function");
+	if (reader.has_error())
+		return std::unexpected { reader.get_error() };
+	return module;
+}
+
+auto BytecodeModule::verify(const BytecodeFunction& function)
+	-> std::expected<void, std::string>
+{
+	const auto& code = function.code;
+	auto size = static_cast<std::uint32_t>(code.size());
+	if (code.size() > std::numeric_limits<std::uint32_t>::max())
+		return std::unexpected { std::string { "function too large" } };
+
+	// 跳转目标处的栈深度, -1表示尚无跳转到达
+	std::vector<std::int64_t> target_depth(code.size() + 1, -1);
+	// 当前指令从上一条顺序到达时的栈深度, -1表示不可达
+	std::int64_t depth = 0;
+	// 虚拟机按max_stack分配求值栈, 必须与实际的最大深度一致
+	std::int64_t max_depth = 0;
+	// 跳转目标必须是指令的起始位置, 不能落在立即数中间
+	std::vector<bool> instruction_start(code.size() + 1, false);
+
+	for (std::uint32_t pc = 0; pc < size;)
+	{
+		if (target_depth[pc] >= 0)
+		{
+			if (depth >= 0 && depth != target_depth[pc])
+				return std::unexpected { std::format("inconsistent stack depth at {}", pc) };
+			depth = target_depth[pc];
+		}
+		if (depth < 0)
+			return std::unexpected { std::format("unreachable code at {}", pc) };
+
+		instruction_start[pc] = true;
+		if (code[pc] > static_cast<std::uint8_t>(last_opcode))
+			return std::unexpected { std::format("invalid opcode {} at {}", code[pc], pc) };
+		auto opcode = static_cast<Opcode>(code[pc]);
+		std::uint32_t next = pc + 1;
+		std::uint32_t immediate = 0;
+		if (has_immediate(opcode))
+		{
+			if (size - pc < 5)
+				return std::unexpected { std::format("truncated instruction at {}", pc) };
+			immediate = llvm::support::endian::read32le(&code[pc + 1]);
+			next = pc + 5;
+		}
+
+		switch (opcode)
+		{
+		case Opcode::push:
+			++depth;
+			break;
+		case Opcode::neg:
+		case Opcode::logical_not:
+		case Opcode::to_bool:
+			if (depth < 1)
+				return std::unexpected { std::format("stack underflow at {}", pc) };
+			break;
+		case Opcode::jump_if_zero_or_pop:
+		case Opcode::jump_if_nonzero_or_pop:
+			if (depth < 1)
+				return std::unexpected { std::format("stack underflow at {}", pc) };
+			if (immediate <= pc || immediate > size)
+				return std::unexpected { std::format("invalid jump target {} at {}", immediate, pc) };
+			if (target_depth[immediate] >= 0 && target_depth[immediate] != depth)
+				return std::unexpected { std::format("inconsistent stack depth at {}", immediate) };
+			target_depth[immediate] = depth;
+			--depth;
+			break;
+		case Opcode::ret:
+			if (depth < 1)
+				return std::unexpected { std::format("stack underflow at {}", pc) };
+			depth = -1;
+			break;
+		default:
+			// 二元运算
+			if (depth < 2)
+				return std::unexpected { std::format("stack underflow at {}", pc) };
+			--depth;
+			break;
+		}
+
+		if (depth > static_cast<std::int64_t>(function.max_stack))
+			return std::unexpected { std::format("stack depth exceeds {} at {}",
+												 function.max_stack, pc) };
+		max_depth = std::max(max_depth, depth);
+		pc = next;
+	}
+
+	// 落在立即数中的跳转目标不会被扫描到
+	for (std::uint32_t target = 0; target < size; ++target)
+	{
+		if (target_depth[target] >= 0 && !instruction_start[target])
+			return std::unexpected { std::format("jump target {} is not an instruction", target) };
+	}
+
+	// 虚拟机不检查代码末尾, 最后必须是ret
+	if (depth >= 0 || target_depth[size] >= 0)
+		return std::unexpected { std::string { "function does not end with ret" } };
+	if (max_depth != static_cast<std::int64_t>(function.max_stack))
+		return std::unexpected { std::format("max_stack {} does not match the actual depth {}",
+											 function.max_stack, max_depth) };
+	return {};
+}
+
+void BytecodeModule::print(llvm::raw_ostream& os) const
+{
+	for (const auto& function : m_functions)
+	{
+		os << function.name << ": max_stack " << function.max_stack << "\n";
+		for (std::size_t pc = 0; pc < function.code.size();)
+		{
+			auto opcode = static_cast<Opcode>(function.code[pc]);
+			os << std::format("  {:4} {}", pc, opcode_names[function.code[pc]]);
+			if (has_immediate(opcode))
+			{
+				auto immediate = llvm::support::endian::read32le(&function.code[pc + 1]);
+				os << " " << (opcode == Opcode::push
+					? static_cast<std::int64_t>(static_cast<std::int32_t>(immediate))
+					: static_cast<std::int64_t>(immediate));
+				pc += 5;
+			}
+			else
+			{
+				++pc;
+			}
+			os << "\n";
+		}
+	}
+}
+
+}	//namespace tinyc
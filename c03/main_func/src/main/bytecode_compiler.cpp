@@ -0,0 +1,210 @@
+#include "bytecode_compiler.hpp"
+#include <easylog.hpp>
+#include <llvm/Support/Endian.h>
+#include <algorithm>
+#include <format>
+
+namespace tinyc
+{
+
+auto BytecodeCompiler::compile(const CompUnit& comp_unit, std::string source_name)
+	-> std::expected<BytecodeModule, std::string>
+{
+	BytecodeModule module { std::move(source_name) };
+	for (const auto& func_def : comp_unit)
+	{
+		assert(func_def != nullptr);
+		m_function = BytecodeFunction {};
+		m_function.name = func_def->get_ident().get_value();
+		m_depth = 0;
+		if (!visit_node(*func_def))
+			return std::unexpected { std::format("failed to compile {}", m_function.name) };
+		module.add_function(std::move(m_function));
+	}
+	return module;
+}
+
+auto BytecodeCompiler::visit_func_def(const FuncDef& node) -> bool
+{
+	if (node.get_block().get_exprs().empty())
+	{
+		node.report(Location::dk_error, std::format("function {} does not return a value",
+													 node.get_ident().get_value()));
+		return false;
+	}
+	return visit_node(node.get_block());
+}
+
+auto BytecodeCompiler::visit_block(const Block& node) -> bool
+{
+	// 第一条return之后的语句不可达, 不生成代码
+	assert(!node.get_exprs().empty());
+	return visit_node(*node.get_exprs().front());
+}
+
+auto BytecodeCompiler::visit_stmt(const Stmt& node) -> bool
+{
+	if (!visit_node(node.get_expr()))
+		return false;
+	emit(Opcode::ret, -1);
+	return true;
+}
+
+auto BytecodeCompiler::visit_expr(const Expr& node) -> bool
+{
+	return visit_node(node.get_low_expr());
+}
+
+auto BytecodeCompiler::visit_primary_expr(const PrimaryExpr& node) -> bool
+{
+	return node.visit([this](const auto& value) {
+		return visit_node(value);
+	});
+}
+
+auto BytecodeCompiler::visit_unary_expr(const UnaryExpr& node) -> bool
+{
+	return node.visit(util::overloaded {
+		[this](const PrimaryExpr& primary_expr) {
+			return visit_node(primary_expr);
+		},
+		[this](const UnaryOp& op, const UnaryExpr& unary_expr) {
+			if (!visit_node(unary_expr))
+				return false;
+
+			switch (op.get_type())
+			{
+			case Operation::op_add:
+				break;
+			case Operation::op_sub:
+				emit(Opcode::neg, 0);
+				break;
+			case Operation::op_not:
+				emit(Opcode::logical_not, 0);
+				m_is_bool = true;
+				break;
+			default:
+				yq::fatal(yq::loc(), "Unprocessed unary operate");
+				return false;
+			}
+			return true;
+		},
+	});
+}
+
+auto BytecodeCompiler::visit_number(const Number& node) -> bool
+{
+	emit(Opcode::push, static_cast<std::uint32_t>(node.get_int_literal()), 1);
+	return true;
+}
+
+auto BytecodeCompiler::visit_ident(const Ident& node) -> bool
+{
+	node.report(Location::dk_error,
+				std::format("identifier {} cannot be evaluated", node.get_value()));
+	return false;
+}
+
+template<typename BinaryExpr>
+auto BytecodeCompiler::visit_binary_expr(const BinaryExpr& node) -> bool
+{
+	using SelfExpr = typename BinaryExpr::SelfExprPtr::element_type;
+	using HigherExpr = typename BinaryExpr::HigherExprPtr::element_type;
+	using Op = typename BinaryExpr::OpPtr::element_type;
+
+	return node.visit(util::overloaded {
+		[this](const HigherExpr& higher_expr) {
+			return visit_node(higher_expr);
+		},
+		[this](const SelfExpr& self_expr, const Op& op, const HigherExpr& higher_expr) {
+			auto type = op.get_type();
+			if (type == Operation::op_land || type == Operation::op_lor)
+			{
+				// 左侧决定结果时保留栈顶并跳到末尾, 否则弹出后求值右侧
+				if (!visit_node(self_expr))
+					return false;
+				if (!m_is_bool)
+					emit(Opcode::to_bool, 0);
+				auto jump = m_function.code.size();
+				emit(type == Operation::op_land
+					? Opcode::jump_if_zero_or_pop : Opcode::jump_if_nonzero_or_pop, 0, -1);
+				if (!visit_node(higher_expr))
+					return false;
+				if (!m_is_bool)
+					emit(Opcode::to_bool, 0);
+				patch_jump(jump);
+				m_is_bool = true;
+				return true;
+			}
+
+			if (!visit_node(self_expr) || !visit_node(higher_expr))
+				return false;
+
+			Opcode opcode;
+			switch (type)
+			{
+			case Operation::op_add: opcode = Opcode::add; break;
+			case Operation::op_sub: opcode = Opcode::sub; break;
+			case Operation::op_mul: opcode = Opcode::mul; break;
+			case Operation::op_div: opcode = Opcode::div; break;
+			case Operation::op_mod: opcode = Opcode::mod; break;
+			case Operation::op_lt: opcode = Opcode::lt; break;
+			case Operation::op_le: opcode = Opcode::le; break;
+			case Operation::op_gt: opcode = Opcode::gt; break;
+			case Operation::op_ge: opcode = Opcode::ge; break;
+			case Operation::op_eq: opcode = Opcode::eq; break;
+			case Operation::op_ne: opcode = Opcode::ne; break;
+			default:
+				yq::fatal(yq::loc(), "Unprocessed binary operate");
+				return false;
+			}
+			if (opcode == Opcode::div || opcode == Opcode::mod)
+				mark_position(op);
+			emit(opcode, -1);
+			m_is_bool = opcode >= Opcode::lt && opcode <= Opcode::ne;
+			return true;
+		},
+	});
+}
+
+auto BytecodeCompiler::visit_default(const BaseAST& node) -> bool
+{
+	yq::fatal(yq::loc(), "{} can not be compiled to bytecode", node.get_kind_str());
+	return false;
+}
+
+void BytecodeCompiler::emit(Opcode opcode, int stack_effect)
+{
+	assert(!has_immediate(opcode));
+	m_function.code.push_back(static_cast<std::uint8_t>(opcode));
+	m_depth = static_cast<std::uint32_t>(static_cast<int>(m_depth) + stack_effect);
+	m_function.max_stack = std::max(m_function.max_stack, m_depth);
+	m_is_bool = false;
+}
+
+void BytecodeCompiler::emit(Opcode opcode, std::uint32_t immediate, int stack_effect)
+{
+	assert(has_immediate(opcode));
+	auto pc = m_function.code.size();
+	m_function.code.resize(pc + 5);
+	m_function.code[pc] = static_cast<std::uint8_t>(opcode);
+	llvm::support::endian::write32le(&m_function.code[pc + 1], immediate);
+	m_depth = static_cast<std::uint32_t>(static_cast<int>(m_depth) + stack_effect);
+	m_function.max_stack = std::max(m_function.max_stack, m_depth);
+	m_is_bool = false;
+}
+
+void BytecodeCompiler::mark_position(const BaseAST& node)
+{
+	auto [line, column] = node.get_location().get_line_and_column();
+	m_function.positions.push_back({
+		static_cast<std::uint32_t>(m_function.code.size()), line, column });
+}
+
+void BytecodeCompiler::patch_jump(std::size_t at)
+{
+	llvm::support::endian::write32le(&m_function.code[at + 1],
+									 static_cast<std::uint32_t>(m_function.code.size()));
+}
+
+}	//namespace tinyc
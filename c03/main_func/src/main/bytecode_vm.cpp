@@ -0,0 +1,169 @@
+#include "bytecode_vm.hpp"
+#include <llvm/Support/Endian.h>
+#include <format>
+#include <limits>
+
+#if defined(__GNUC__)
+#define TINYC_VM_THREADED 1
+#else
+#define TINYC_VM_THREADED 0
+#endif
+
+namespace tinyc
+{
+
+namespace
+{
+
+auto wrap(std::uint32_t value) -> std::int32_t
+{
+	return static_cast<std::int32_t>(value);
+}
+
+auto read_immediate(const std::uint8_t* pc) -> std::uint32_t
+{
+	return llvm::support::endian::read32le(pc + 1);
+}
+
+}	//namespace
+
+auto BytecodeVM::run(const BytecodeModule& module, std::string_view entry)
+	-> std::expected<int, std::string>
+{
+	const auto* function = module.find_function(entry);
+	if (function == nullptr)
+		return std::unexpected { std::format("entry function {} not found", entry) };
+	return run(module, *function);
+}
+
+auto BytecodeVM::run(const BytecodeModule& module, const BytecodeFunction& function)
+	-> std::expected<int, std::string>
+{
+	if (m_stack.size() < function.max_stack)
+		m_stack.resize(function.max_stack);
+
+	const std::uint8_t* const code = function.code.data();
+	const std::uint8_t* pc = code;
+	// 指向栈顶之上的位置
+	std::int32_t* sp = m_stack.data();
+	const char* error = nullptr;
+
+#if TINYC_VM_THREADED
+	static const void* const dispatch_table[] {
+		&&op_push, &&op_neg, &&op_logical_not, &&op_to_bool,
+		&&op_add, &&op_sub, &&op_mul, &&op_div, &&op_mod,
+		&&op_lt, &&op_le, &&op_gt, &&op_ge, &&op_eq, &&op_ne,
+		&&op_jump_if_zero_or_pop, &&op_jump_if_nonzero_or_pop, &&op_ret,
+	};
+	static_assert(std::size(dispatch_table) == static_cast<std::size_t>(last_opcode) + 1);
+#define VM_CASE(name) op_##name
+#define VM_DISPATCH() goto *dispatch_table[*pc]
+	VM_DISPATCH();
+#else
+#define VM_CASE(name) case Opcode::name
+#define VM_DISPATCH() goto dispatch
+dispatch:
+	switch (static_cast<Opcode>(*pc))
+	{
+#endif
+
+#define VM_BINARY(name, expr)			\
+	VM_CASE(name):						\
+	{									\
+		auto rhs = *--sp;				\
+		auto lhs = sp[-1];				\
+		sp[-1] = (expr);				\
+		++pc;							\
+		VM_DISPATCH();					\
+	}
+
+	VM_CASE(push):
+		*sp++ = static_cast<std::int32_t>(read_immediate(pc));
+		pc += 5;
+		VM_DISPATCH();
+	VM_CASE(neg):
+		sp[-1] = wrap(0u - static_cast<std::uint32_t>(sp[-1]));
+		++pc;
+		VM_DISPATCH();
+	VM_CASE(logical_not):
+		sp[-1] = sp[-1] == 0 ? 1 : 0;
+		++pc;
+		VM_DISPATCH();
+	VM_CASE(to_bool):
+		sp[-1] = sp[-1] != 0 ? 1 : 0;
+		++pc;
+		VM_DISPATCH();
+
+	VM_BINARY(add, wrap(static_cast<std::uint32_t>(lhs) + static_cast<std::uint32_t>(rhs)))
+	VM_BINARY(sub, wrap(static_cast<std::uint32_t>(lhs) - static_cast<std::uint32_t>(rhs)))
+	VM_BINARY(mul, wrap(static_cast<std::uint32_t>(lhs) * static_cast<std::uint32_t>(rhs)))
+	VM_BINARY(lt, lhs < rhs ? 1 : 0)
+	VM_BINARY(le, lhs <= rhs ? 1 : 0)
+	VM_BINARY(gt, lhs > rhs ? 1 : 0)
+	VM_BINARY(ge, lhs >= rhs ? 1 : 0)
+	VM_BINARY(eq, lhs == rhs ? 1 : 0)
+	VM_BINARY(ne, lhs != rhs ? 1 : 0)
+
+	VM_CASE(div):
+	VM_CASE(mod):
+	{
+		auto rhs = sp[-1];
+		auto lhs = sp[-2];
+		if (rhs == 0)
+		{
+			error = "division by zero";
+			goto fail;
+		}
+		if (lhs == std::numeric_limits<std::int32_t>::min() && rhs == -1)
+		{
+			error = "signed division overflow";
+			goto fail;
+		}
+		--sp;
+		sp[-1] = static_cast<Opcode>(*pc) == Opcode::div ? lhs / rhs : lhs % rhs;
+		++pc;
+		VM_DISPATCH();
+	}
+
+	VM_CASE(jump_if_zero_or_pop):
+		if (sp[-1] == 0)
+		{
+			pc = code + read_immediate(pc);
+			VM_DISPATCH();
+		}
+		--sp;
+		pc += 5;
+		VM_DISPATCH();
+	VM_CASE(jump_if_nonzero_or_pop):
+		if (sp[-1] != 0)
+		{
+			pc = code + read_immediate(pc);
+			VM_DISPATCH();
+		}
+		--sp;
+		pc += 5;
+		VM_DISPATCH();
+
+	VM_CASE(ret):
+		return sp[-1];
+
+#if !TINYC_VM_THREADED
+	}
+#endif
+
+#undef VM_BINARY
+#undef VM_DISPATCH
+#undef VM_CASE
+
+fail:
+	auto offset = static_cast<std::uint32_t>(pc - code);
+	if (const auto* position = function.find_position(offset); position != nullptr)
+	{
+		return std::unexpected { std::format("{}:{}:{}: {}", module.get_source_name(),
+											 position->line, position->column, error) };
+	}
+	return std::unexpected { std::format("{}: {} in {}", module.get_source_name(),
+										 error, function.name) };
+}
+
+}	//namespace tinyc
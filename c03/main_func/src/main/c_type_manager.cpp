@@ -1,54 +1,113 @@
 #include "c_type_manager.hpp"
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
 
 namespace tinyc
 {
-CTypeManager::CTypeManager(llvm::LLVMContext& context, llvm::TargetMachine* target_machine):
-	m_context { context },
-	m_data_layout { target_machine->createDataLayout() },
-	m_void_ty { llvm::Type::getVoidTy(context) }, 
-	m_bool_ty { llvm::Type::getIntNTy(context, 8) },
-	m_schar_ty { llvm::Type::getIntNTy(context, 8) },
-	m_uchar_ty { llvm::Type::getIntNTy(context, 8) },
-	m_sshort_ty { llvm::Type::getIntNTy(context, 16) },
-	m_ushort_ty { llvm::Type::getIntNTy(context, 16) },
-	m_sint_ty { llvm::Type::getIntNTy(context, 32) },
-	m_uint_ty { llvm::Type::getIntNTy(context, 32) },
-	m_slong_ty { llvm::Type::getIntNTy(context, gen_long_bit_width()) },
-	m_ulong_ty { llvm::Type::getIntNTy(context, gen_long_bit_width()) },
-	m_slong_long_ty { llvm::Type::getIntNTy(context, 64) },
-	m_ulong_long_ty { llvm::Type::getIntNTy(context, 64) },
-	m_float_ty { llvm::Type::getFloatTy(context) },
-	m_double_ty { llvm::Type::getFloatTy(context) }
-{}
-
-#define GET_TYPE(type_name)                                                    \
-	auto CTypeManager::get_##type_name() const->llvm::Type*                    \
-	{                                                                          \
-		return m_##type_name##_ty;                                             \
-	}
 
-#define GET_SIGN_TYPE(type_name)                                               \
-	auto CTypeManager::get_signed_##type_name() const->llvm::Type*             \
-	{                                                                          \
-		return m_s##type_name##_ty;                                            \
-	}                                                                          \
-                                                                               \
-	auto CTypeManager::get_unsigned_##type_name() const->llvm::Type*           \
-	{                                                                          \
-		return m_u##type_name##_ty;                                            \
+namespace
+{
+
+/// @brief 内建类型在llvm中的表示
+struct CTypeInfo
+{
+	enum Kind: std::uint8_t
+	{
+		void_kind,
+		/// @brief 位宽为bit_width的整数
+		integer_kind,
+		/// @brief 指针为64位时为64位整数, 否则为32位
+		long_kind,
+		float_kind,
+		double_kind,
+	};
+
+	Kind kind;
+	unsigned bit_width;
+};
+
+/// @brief 按CType的顺序排列
+constexpr std::array<CTypeInfo, ctype_count> ctype_infos {{
+	{ CTypeInfo::void_kind, 0 },
+	{ CTypeInfo::integer_kind, 8 },		//_Bool before c23
+	{ CTypeInfo::integer_kind, 8 },
+	{ CTypeInfo::integer_kind, 8 },
+	{ CTypeInfo::integer_kind, 16 },
+	{ CTypeInfo::integer_kind, 16 },
+	{ CTypeInfo::integer_kind, 32 },
+	{ CTypeInfo::integer_kind, 32 },
+	{ CTypeInfo::long_kind, 0 },
+	{ CTypeInfo::long_kind, 0 },
+	{ CTypeInfo::integer_kind, 64 },
+	{ CTypeInfo::integer_kind, 64 },
+	{ CTypeInfo::float_kind, 0 },
+	{ CTypeInfo::double_kind, 0 },
+}};
+
+static_assert(ctype_infos[static_cast<std::size_t>(CType::signed_long)].kind
+			  == CTypeInfo::long_kind);
+static_assert(ctype_infos[static_cast<std::size_t>(CType::double_)].kind
+			  == CTypeInfo::double_kind);
+
+auto long_bit_width(const llvm::DataLayout& data_layout) -> unsigned
+{
+	return data_layout.getPointerSizeInBits() == 64 ? 64 : 32;
+}
+
+auto make_type(llvm::LLVMContext& context, const llvm::DataLayout& data_layout,
+			   CTypeInfo info) -> llvm::Type*
+{
+	switch (info.kind)
+	{
+	case CTypeInfo::void_kind:
+		return llvm::Type::getVoidTy(context);
+	case CTypeInfo::integer_kind:
+		return llvm::Type::getIntNTy(context, info.bit_width);
+	case CTypeInfo::long_kind:
+		return llvm::Type::getIntNTy(context, long_bit_width(data_layout));
+	case CTypeInfo::float_kind:
+		return llvm::Type::getFloatTy(context);
+	case CTypeInfo::double_kind:
+		return llvm::Type::getDoubleTy(context);
 	}
+	return nullptr;
+}
 
-GET_TYPE(void)
+/// @brief 以context地址与DataLayout的字符串表示为键
+using CacheKey = std::pair<const llvm::LLVMContext*, std::string>;
 
-GET_TYPE(bool)
-GET_SIGN_TYPE(char)
-GET_SIGN_TYPE(short)
-GET_SIGN_TYPE(int)
-GET_SIGN_TYPE(long)
-GET_SIGN_TYPE(long_long)
+std::mutex cache_mutex;
+std::map<CacheKey, std::weak_ptr<const CTypeManager>> cache;
 
-GET_TYPE(float)
-GET_TYPE(double)
+}	//namespace
 
-}	//namespace tinyc
+CTypeManager::CTypeManager(llvm::LLVMContext& context, const llvm::DataLayout& data_layout):
+	m_context { context },
+	m_data_layout { data_layout },
+	m_types {}
+{
+	for (std::size_t i = 0; i < ctype_count; ++i)
+		m_types[i] = make_type(m_context, m_data_layout, ctype_infos[i]);
+}
 
+auto CTypeManager::get(llvm::LLVMContext& context, const llvm::DataLayout& data_layout)
+	-> std::shared_ptr<const CTypeManager>
+{
+	CacheKey key { &context, data_layout.getStringRepresentation() };
+	std::lock_guard lock { cache_mutex };
+	if (auto it = cache.find(key); it != cache.end())
+	{
+		if (auto type_mgr = it->second.lock())
+			return type_mgr;
+	}
+
+	// context销毁后其地址可能被复用, 过期的项在此清理
+	std::erase_if(cache, [](const auto& entry) { return entry.second.expired(); });
+	auto type_mgr = std::make_shared<const CTypeManager>(context, data_layout);
+	cache.insert_or_assign(std::move(key), type_mgr);
+	return type_mgr;
+}
+
+}	//namespace tinyc
@@ -1,31 +1,67 @@
 #include "general_visitor.hpp"
+#include "llvm_location.hpp"
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/CodeGen/CommandFlags.h>
+#include <llvm/CodeGen/ParallelCG.h>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/IRPrintingPasses.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/Support/Casting.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Pass.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/PGOOptions.h>
+#include <llvm/Support/VirtualFileSystem.h>
 
+#include <algorithm>
+#include <utility>
+#include <format>
 #include <print>
 
 namespace tinyc
 {
 
 GeneralVisitor::GeneralVisitor(llvm::LLVMContext& context, bool emit_llvm, llvm::SourceMgr& src_mgr,
-				   std::string_view output_file, llvm::TargetMachine* tm):
+				   std::string_view output_file, llvm::TargetMachine* tm,
+				   std::shared_ptr<const CTypeManager> type_mgr):
 	m_module { std::make_unique<llvm::Module>("tinyc.expr", context) },
 	m_builder { m_module->getContext() },
-	m_type_mgr { std::make_shared<CTypeManager>(m_module->getContext(), tm) },
+	m_type_mgr { std::move(type_mgr) },
 	m_emit_llvm { emit_llvm },
 	m_src_mgr { src_mgr },
 	m_output_file { output_file },
-	m_target_machine { tm }
+	m_target_machine { tm },
+	m_codegen_threads { 1 },
+	m_tm_factory {},
+	m_thin_lto { false },
+	m_optimize_options {},
+	m_optimized { false },
+	m_debug_info_kind { DebugInfoKind::none },
+	m_di_builder {},
+	m_di_file { nullptr },
+	m_di_subprogram { nullptr },
+	m_has_error { false },
+	m_report_diagnostics { true }
 {
+	// 位码与ThinLTO链接时依赖模块自带的目标信息
+	m_module->setTargetTriple(tm->getTargetTriple().str());
+	m_module->setDataLayout(m_type_mgr->get_data_layout());
 }
 
-auto GeneralVisitor::visit(BaseAST* ast) -> bool
+void GeneralVisitor::set_codegen_threads(unsigned threads,
+										 TargetMachineFactory tm_factory)
+{
+	m_codegen_threads = std::max(threads, 1u);
+	m_tm_factory = std::move(tm_factory);
+}
+
+auto GeneralVisitor::visit(const BaseAST* ast) -> bool
 {
 	if (ast == nullptr)
 	{
@@ -33,37 +69,54 @@ auto GeneralVisitor::visit(BaseAST* ast) -> bool
 		return false;
 	}
 
-	auto comp_unit_ptr = llvm::dyn_cast<CompUnit>(ast);
-
-	if (comp_unit_ptr == nullptr)
+	if (ast->get_kind() != BaseAST::ast_comunit
+		&& ast->get_kind() != BaseAST::ast_funcdef)
 	{
-		yq::error(yq::loc(), "output visitor paramater should be a CompUnit");
+		yq::error(yq::loc(),
+				  "output visitor paramater should be a CompUnit or FuncDef");
 		return false;
 	}
 	
-	handle(*comp_unit_ptr);
+	dispatch(*ast);
 
-	return true;
+	return !m_has_error;
+}
+
+auto GeneralVisitor::get_output_extension(llvm::CodeGenFileType file_type)
+	-> std::string_view
+{
+	switch(file_type)
+	{
+	case llvm::CodeGenFileType::AssemblyFile:
+		return ".s";
+	case llvm::CodeGenFileType::ObjectFile:
+		return ".o";
+	case llvm::CodeGenFileType::Null:
+		return ".null";
+	}
+	std::unreachable();
 }
 
 auto GeneralVisitor::emit() -> bool
 {
+	if (!optimize())
+		return false;
+
 	std::error_code ec;
 	
 	std::string output_file_name { m_output_file };
 
 	auto file_type = llvm::codegen::getFileType();
-	switch(file_type)
+	auto extension = get_output_extension(file_type);
+	output_file_name.append(extension);
+
+	bool print_ir = file_type == llvm::CodeGenFileType::AssemblyFile && m_emit_llvm;
+	auto func_count = llvm::count_if(m_module->functions(),
+		[](const llvm::Function& func) { return !func.isDeclaration(); });
+	if (!print_ir && m_codegen_threads > 1 && func_count > 1)
 	{
-	case llvm::CodeGenFileType::AssemblyFile:
-		output_file_name.append(".s");
-		break;
-	case llvm::CodeGenFileType::ObjectFile:
-		output_file_name.append(".o");
-		break;
-	case llvm::CodeGenFileType::Null:
-		output_file_name.append(".null");
-		break;
+		auto partitions = std::min<std::size_t>(m_codegen_threads, func_count);
+		return emit_split(file_type, extension, partitions);
 	}
 
 	auto open_flags = llvm::sys::fs::OF_None;
@@ -78,7 +131,7 @@ auto GeneralVisitor::emit() -> bool
 	llvm::legacy::PassManager pm;
 
 	//输出llvm ir文件
-	if (file_type == llvm::CodeGenFileType::AssemblyFile && m_emit_llvm)
+	if (print_ir)
 	{
 		pm.add(createPrintModulePass(os));
 		//m_module->print(os, nullptr);
@@ -97,32 +150,314 @@ auto GeneralVisitor::emit() -> bool
 	return true;
 }
 
-void GeneralVisitor::handle(const CompUnit& node)
+auto GeneralVisitor::emit(std::span<const EmitKind> kinds) -> bool
+{
+	if (!optimize())
+		return false;
+
+	auto requested = [kinds](EmitKind kind) {
+		return llvm::is_contained(kinds, kind);
+	};
+	auto output_name = [this](std::string_view extension) {
+		return std::format("{}{}", m_output_file, extension);
+	};
+	auto open_output = [](const std::string& file_name)
+		-> std::unique_ptr<llvm::raw_fd_ostream> {
+		std::error_code ec;
+		auto os = std::make_unique<llvm::raw_fd_ostream>(
+			file_name, ec, llvm::sys::fs::OF_None);
+		if (ec)
+		{
+			yq::error("Could not open file {}: {}", file_name, ec.message());
+			return nullptr;
+		}
+		return os;
+	};
+
+	auto write_file = [&](llvm::Module& module, EmitKind kind,
+						  std::string_view extension) {
+		auto os = open_output(output_name(extension));
+		return os != nullptr && write_output(module, kind, *os);
+	};
+
+	// 不修改模块的输出先进行
+	if (requested(EmitKind::llvm_ir) && !write_file(*m_module, EmitKind::llvm_ir, ".ll"))
+		return false;
+	if (requested(EmitKind::bitcode) && !write_file(*m_module, EmitKind::bitcode, ".bc"))
+		return false;
+
+	bool need_asm = requested(EmitKind::assembly);
+	bool need_obj = requested(EmitKind::object);
+	if (need_asm)
+	{
+		// 只有之后还要生成目标文件时才复制模块
+		std::unique_ptr<llvm::Module> clone;
+		if (need_obj)
+			clone = llvm::CloneModule(*m_module);
+		auto& module = need_obj ? *clone : *m_module;
+		if (!write_file(module, EmitKind::assembly, ".s"))
+			return false;
+	}
+	if (need_obj && !write_file(*m_module, EmitKind::object, ".o"))
+		return false;
+
+	return true;
+}
+
+auto GeneralVisitor::emit(EmitKind kind, llvm::raw_pwrite_stream& os,
+						  bool preserve_module) -> bool
+{
+	if (!optimize())
+		return false;
+
+	bool rewrites_module = kind == EmitKind::assembly || kind == EmitKind::object;
+	if (preserve_module && rewrites_module)
+	{
+		auto clone = llvm::CloneModule(*m_module);
+		return write_output(*clone, kind, os);
+	}
+	return write_output(*m_module, kind, os);
+}
+
+auto GeneralVisitor::optimize() -> bool
+{
+	const auto& options = m_optimize_options;
+	if (m_optimized)
+		return true;
+	m_optimized = true;
+
+	if (m_di_builder != nullptr)
+		m_di_builder->finalize();
+
+	std::optional<llvm::PGOOptions> pgo_options;
+	if (!options.profile_generate.empty())
+	{
+		pgo_options = llvm::PGOOptions { options.profile_generate, "", "", "",
+										 llvm::vfs::getRealFileSystem(),
+										 llvm::PGOOptions::IRInstr };
+	}
+	else if (!options.profile_use.empty())
+	{
+		if (!llvm::sys::fs::exists(options.profile_use))
+		{
+			yq::error("Could not open profile {}", options.profile_use);
+			return false;
+		}
+		pgo_options = llvm::PGOOptions { options.profile_use, "", "", "",
+										 llvm::vfs::getRealFileSystem(),
+										 llvm::PGOOptions::IRUse };
+	}
+
+	if (options.level == 0 && !pgo_options)
+		return true;
+
+	llvm::LoopAnalysisManager lam;
+	llvm::FunctionAnalysisManager fam;
+	llvm::CGSCCAnalysisManager cgam;
+	llvm::ModuleAnalysisManager mam;
+
+	llvm::PassBuilder pb { m_target_machine, llvm::PipelineTuningOptions {},
+						   pgo_options };
+	pb.registerModuleAnalyses(mam);
+	pb.registerCGSCCAnalyses(cgam);
+	pb.registerFunctionAnalyses(fam);
+	pb.registerLoopAnalyses(lam);
+	pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+	llvm::ModulePassManager mpm;
+	switch(options.level)
+	{
+	case 0:
+		// O0流水线同样会插入插桩并降级为运行时调用
+		mpm = pb.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+		break;
+	case 1:
+		mpm = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O1);
+		break;
+	case 2:
+		mpm = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+		break;
+	default:
+		mpm = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+		break;
+	}
+	mpm.run(*m_module, mam);
+
+	return true;
+}
+
+auto GeneralVisitor::write_output(llvm::Module& module, EmitKind kind,
+								  llvm::raw_pwrite_stream& os) -> bool
+{
+	llvm::CodeGenFileType file_type;
+	switch(kind)
+	{
+	case EmitKind::llvm_ir:
+		module.print(os, nullptr);
+		return true;
+	case EmitKind::bitcode:
+		if (m_thin_lto)
+		{
+			// 摘要记录函数的调用与引用关系, 供tinyc-lto决定跨模块导入
+			auto index = llvm::buildModuleSummaryIndex(module, nullptr, nullptr);
+			llvm::WriteBitcodeToFile(module, os, false, &index);
+		}
+		else
+		{
+			llvm::WriteBitcodeToFile(module, os);
+		}
+		return true;
+	case EmitKind::assembly:
+		file_type = llvm::CodeGenFileType::AssemblyFile;
+		break;
+	case EmitKind::object:
+		file_type = llvm::CodeGenFileType::ObjectFile;
+		break;
+	}
+
+	llvm::legacy::PassManager pm;
+	if (m_target_machine->addPassesToEmitFile(pm, os, nullptr, file_type))
+	{
+		yq::error(yq::loc(), "No support for file type");
+		return false;
+	}
+	pm.run(module);
+
+	return true;
+}
+
+auto GeneralVisitor::emit_split(llvm::CodeGenFileType file_type,
+								std::string_view extension,
+								std::size_t partitions) -> bool
+{
+	assert(m_tm_factory && "set_codegen_threads before parallel codegen");
+
+	std::vector<std::unique_ptr<llvm::raw_fd_ostream>> streams;
+	std::vector<llvm::raw_pwrite_stream*> output_streams;
+	streams.reserve(partitions);
+	output_streams.reserve(partitions);
+
+	for (std::size_t i = 0; i < partitions; ++i)
+	{
+		auto file_name = std::format("{}.{}{}", m_output_file, i, extension);
+		std::error_code ec;
+		auto os = std::make_unique<llvm::raw_fd_ostream>(
+			file_name, ec, llvm::sys::fs::OF_None);
+		if (ec)
+		{
+			yq::error("Could not open file {}: {}", file_name, ec.message());
+			return false;
+		}
+		output_streams.push_back(os.get());
+		streams.push_back(std::move(os));
+	}
+
+	// 每个分区在独立线程上使用独立的TargetMachine生成代码
+	llvm::splitCodeGen(*m_module, output_streams, {}, m_tm_factory, file_type);
+
+	return true;
+}
+
+auto GeneralVisitor::visit_comp_unit(const CompUnit& node) -> llvm::Value*
 {
 	yq::debug("CompUnitBegin:");
-	handle(node.get_func_def());
+	for (const auto& func_def : node)
+	{
+		assert(func_def != nullptr);
+		visit_node(*func_def);
+	}
 	yq::debug("CompUnitEnd");
+
+	return nullptr;
 }
 
-void GeneralVisitor::handle(const FuncDef& node)
+auto GeneralVisitor::visit_func_def(const FuncDef& node) -> llvm::Value*
 {
 	yq::debug("FuncDefBegin:");
 	auto return_type = handle(node.get_type());
-	auto func_name = handle(node.get_ident()).second;
+	auto func_name = node.get_ident().get_value();
+	// 同名函数会被llvm自动重命名为f.1, 需要在这里拒绝
+	if (m_module->getFunction(func_name) != nullptr)
+	{
+		report(node.get_ident(), Location::dk_error,
+			   std::format("redefinition of function {}", func_name));
+		m_has_error = true;
+		return nullptr;
+	}
 	auto param_types = handle(node.get_paramlist());
 
 	auto func_type = llvm::FunctionType::get(return_type, param_types, false);
 
-	//auto func =
-	//	llvm::Function::Create(func_type, llvm::GlobalValue::ExternalLinkage,
-	//						   func_name, m_module.get());
-
 	auto func =
 		llvm::Function::Create(func_type, llvm::GlobalValue::ExternalLinkage,
 							   func_name, m_module.get());
-	handle(node.get_block(), func, "entry");
+	if (m_debug_info_kind != DebugInfoKind::none)
+		attach_subprogram(*func, node);
+
+	auto entry = llvm::BasicBlock::Create(m_module->getContext(), "entry", func);
+	m_builder.SetInsertPoint(entry);
+	visit_node(node.get_block());
+	// 位置的作用域属于当前函数, 不能带到下一个函数中
+	m_builder.SetCurrentDebugLocation(llvm::DebugLoc {});
 
 	yq::debug("FuncDefEnd");
+	return func;
+}
+
+void GeneralVisitor::attach_subprogram(llvm::Function& func, const FuncDef& node)
+{
+	if (m_di_builder == nullptr)
+	{
+		const auto& location = static_cast<const LLVMLocation&>(node.get_location());
+		auto buffer_id = m_src_mgr.FindBufferContainingLoc(location.begin);
+		llvm::StringRef file_name =
+			m_src_mgr.getMemoryBuffer(buffer_id)->getBufferIdentifier();
+
+		m_di_builder = std::make_unique<llvm::DIBuilder>(*m_module);
+		m_di_file = m_di_builder->createFile(llvm::sys::path::filename(file_name),
+											 llvm::sys::path::parent_path(file_name));
+		auto emission_kind = m_debug_info_kind == DebugInfoKind::line_tables_only
+			? llvm::DICompileUnit::LineTablesOnly : llvm::DICompileUnit::NoDebug;
+		m_di_builder->createCompileUnit(llvm::dwarf::DW_LANG_C, m_di_file, "tinyc",
+										m_optimize_options.level > 0, "", 0, "",
+										emission_kind);
+		m_module->addModuleFlag(llvm::Module::Warning, "Debug Info Version",
+								llvm::DEBUG_METADATA_VERSION);
+		if (emission_kind != llvm::DICompileUnit::NoDebug)
+			m_module->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 5);
+	}
+
+	auto line = get_line_and_column(node).first;
+	auto subroutine_type = m_di_builder->createSubroutineType(
+		m_di_builder->getOrCreateTypeArray({}));
+	m_di_subprogram = m_di_builder->createFunction(
+		m_di_file, func.getName(), func.getName(), m_di_file, line, subroutine_type,
+		line, llvm::DINode::FlagZero, llvm::DISubprogram::SPFlagDefinition);
+	func.setSubprogram(m_di_subprogram);
+}
+
+void GeneralVisitor::set_debug_location(const BaseAST& node)
+{
+	if (m_di_subprogram == nullptr)
+		return;
+
+	auto [line, column] = get_line_and_column(node);
+	m_builder.SetCurrentDebugLocation(llvm::DILocation::get(
+		m_module->getContext(), line, column, m_di_subprogram));
+}
+
+void GeneralVisitor::report(const BaseAST& node, Location::DiagKind kind,
+							std::string_view msg) const
+{
+	if (m_report_diagnostics)
+		node.report(kind, msg);
+}
+
+auto GeneralVisitor::get_line_and_column(const BaseAST& node) const
+	-> std::pair<unsigned, unsigned>
+{
+	// 每条指令都要查询一次, 由driver建立的行首偏移表二分查找
+	return node.get_location().get_line_and_column();
 }
 
 auto GeneralVisitor::handle(const Type& node) -> llvm::Type*
@@ -151,15 +486,14 @@ auto GeneralVisitor::handle(const Type& node) -> llvm::Type*
 	return ret;
 }
 
-auto GeneralVisitor::handle(const Ident& node) -> std::pair<llvm::Value*, std::string>
+auto GeneralVisitor::visit_ident(const Ident& node) -> llvm::Value*
 {
 	yq::debug("Ident[{}]Begin:", node.get_value());
 	
 	llvm::Value* value = nullptr;
-	std::string name = node.get_value();
 
 	yq::debug("Ident[{}]End:", node.get_value());
-	return { value, name };
+	return value;
 }
 
 auto GeneralVisitor::handle(const ParamList& node) -> std::vector<llvm::Type*>
@@ -179,98 +513,80 @@ auto GeneralVisitor::handle(const ParamList& node) -> std::vector<llvm::Type*>
 	return type_list;
 }
 
-auto GeneralVisitor::handle(const Block& node, llvm::Function* func,
-							std::string_view block_name) -> llvm::BasicBlock*
+auto GeneralVisitor::visit_block(const Block& node) -> llvm::Value*
 {
 	yq::debug("BlockBegin: ");
 
-	auto basic_block =
-		llvm::BasicBlock::Create(m_module->getContext(), block_name.data(), func);
-	m_builder.SetInsertPoint(basic_block);
-
 	for (const auto& stmt : node)
 	{
 		assert(stmt != nullptr);
-		handle(*stmt);
+		// return之后的语句不可达, 基本块不能在终结指令后继续追加
+		if (m_builder.GetInsertBlock()->getTerminator() != nullptr)
+		{
+			report(*stmt, Location::dk_warning, "code will never be executed");
+			break;
+		}
+		visit_node(*stmt);
 	}
 	yq::debug("BlockEnd");
 
-	return basic_block;
+	return m_builder.GetInsertBlock();
 }
 
-void GeneralVisitor::handle(const Stmt& node)
+auto GeneralVisitor::visit_stmt(const Stmt& node) -> llvm::Value*
 {
 	yq::debug("StmtBegin:");
-	auto value = handle(node.get_expr());
+	auto value = visit_node(node.get_expr());
 	assert(value != nullptr);
 	
-	m_builder.CreateRet(value);
+	set_debug_location(node);
+	auto ret = m_builder.CreateRet(value);
 	yq::debug("StmtEnd");
+
+	return ret;
 }
 
-auto GeneralVisitor::handle(const Expr& node) -> llvm::Value*
+auto GeneralVisitor::visit_expr(const Expr& node) -> llvm::Value*
 {
 	yq::debug("ExprBegin:");
-	auto ret = handle(node.get_low_expr());
+	auto ret = visit_node(node.get_low_expr());
 	yq::debug("ExprEnd");
 
 	return ret;
 }
 
-auto GeneralVisitor::handle(const PrimaryExpr& node) -> llvm::Value*
+auto GeneralVisitor::visit_primary_expr(const PrimaryExpr& node) -> llvm::Value*
 {
 	yq::debug("PrimaryExprBegin: ");
 
-	// ast 搁置了对visit的实现
-	//auto func = [this](auto& v) {
-	//	auto ret = this->handle(v);
-	//	static_assert(std::is_same_v<std::decay_t<decltype(ret)>, llvm::Value*>);
-	//	return ret;
-	//};
-	//node.visit(func);
-	
-	llvm::Value* result = nullptr;
-	if (node.has_expr())
-	{
-		result = handle(node.get_expr());	
-	}
-	else if (node.has_ident())
-	{
-		result = handle(node.get_ident()).first;
-	}
-	else if (node.has_number())
-	{
-		result = handle(node.get_number());
-	}
+	auto result = node.visit([this](const auto& value) {
+		return visit_node(value);
+	});
 
 	yq::debug("PrimaryExprEnd");
 	return result;
 }
 
-auto GeneralVisitor::handle(const UnaryExpr& node) -> llvm::Value*
+auto GeneralVisitor::visit_unary_expr(const UnaryExpr& node) -> llvm::Value*
 {
 	yq::debug("UnaryExpr Begin:");
 
-	llvm::Value* result = nullptr;
-	if (node.has_unary_expr())
-	{
-		result = handle(node.get_unary_expr());
-		result = unary_operate(node.get_unary_op(), result);
-	}
-	else if (node.has_primary_expr())
-	{
-		result = handle(node.get_primary_expr());
-	}
-	else
-	{
-		assert(false && "UnaryExpr has an unkown type in its variant");
-	}
+	auto result = node.visit(util::overloaded {
+		[this](const PrimaryExpr& primary_expr) {
+			return visit_node(primary_expr);
+		},
+		[this](const UnaryOp& op, const UnaryExpr& unary_expr) {
+			auto operand = visit_node(unary_expr);
+			set_debug_location(op);
+			return unary_operate(op, operand);
+		},
+	});
 
 	yq::debug("UnaryExpr End");
 	return result;
 }
 
-auto GeneralVisitor::handle(const Number& node) -> llvm::Value*
+auto GeneralVisitor::visit_number(const Number& node) -> llvm::Value*
 {
 	yq::debug("Number[{}] Begin: ", node.get_int_literal());
 
@@ -281,6 +597,13 @@ auto GeneralVisitor::handle(const Number& node) -> llvm::Value*
 	return result;
 }
 
+auto GeneralVisitor::visit_default(const BaseAST& node) -> llvm::Value*
+{
+	yq::fatal(yq::loc(), "{} can not be lowered to llvm::Value",
+			  node.get_kind_str());
+	return nullptr;
+}
+
 auto GeneralVisitor::unary_operate(const UnaryOp& op, llvm::Value* operand)
 	-> llvm::Value*
 {
@@ -306,21 +629,18 @@ auto GeneralVisitor::unary_operate(const UnaryOp& op, llvm::Value* operand)
 		else 
 			result = m_builder.CreateFNeg(operand);
 		break;
-	/// c语言not操作将操作数转换为int类型
+	/// c语言not操作的结果为int类型的0或1, 而不是按位取反
 	case UnaryOp::op_not: {
-		llvm::Value* zero = llvm::ConstantInt::get(type, 0);
-		llvm::Value* is_nonzero = nullptr;
+		llvm::Value* is_zero = nullptr;
 		if (type->isIntegerTy())
 		{
-			is_nonzero = m_builder.CreateICmpNE(operand, zero);
+			is_zero = m_builder.CreateICmpEQ(operand, llvm::ConstantInt::get(type, 0));
 		}
 		else
 		{
-			is_nonzero = m_builder.CreateFCmpUNE(operand, zero);
+			is_zero = m_builder.CreateFCmpOEQ(operand, llvm::ConstantFP::get(type, 0));
 		}
-		llvm::Value* int_value = m_builder.CreateZExt(is_nonzero, m_type_mgr->get_signed_int());
-
-		result = m_builder.CreateNot(int_value);
+		result = m_builder.CreateZExt(is_zero, m_type_mgr->get_signed_int());
 		break;
 	}
 	default:
@@ -338,35 +658,32 @@ auto GeneralVisitor::handle(const Param& node) -> llvm::Type*
 {
 	yq::debug("ParamBegin: ");
 	auto type = handle(node.get_type());
-	handle(node.get_ident());
 	yq::debug("ParamEnd");
 
 	return type;
 }
 
 template<typename BinaryExpr>
-auto GeneralVisitor::handle(const BinaryExpr& node) -> llvm::Value*
+auto GeneralVisitor::visit_binary_expr(const BinaryExpr& node) -> llvm::Value*
 {
 	yq::debug("{} begin:", node.get_kind_str());
 
-	llvm::Value* result = nullptr;
-
-	if (node.has_higher_expr())
-	{
-		result = handle(node.get_higher_expr());
-	}
-	else if (node.has_combined_expr())
-	{
-		auto [ self_expr_ref, op, higher_expr_ref ] = node.get_combined_expr();
-		auto left = handle(self_expr_ref.get());
-		auto right = handle(higher_expr_ref.get());
-		
-		result = binary_operate(left, op, right);
-	}
-	else
-	{
-		yq::fatal("{}'s Variant has an unkown type", node.get_kind_str());
-	}
+	using SelfExpr = typename BinaryExpr::SelfExprPtr::element_type;
+	using HigherExpr = typename BinaryExpr::HigherExprPtr::element_type;
+	using Op = typename BinaryExpr::OpPtr::element_type;
+
+	auto result = node.visit(util::overloaded {
+		[this](const HigherExpr& higher_expr) {
+			return visit_node(higher_expr);
+		},
+		[this](const SelfExpr& self_expr, const Op& op,
+			   const HigherExpr& higher_expr) {
+			auto left = visit_node(self_expr);
+			auto right = visit_node(higher_expr);
+			set_debug_location(op);
+			return binary_operate(left, op, right);
+		},
+	});
 
 	yq::debug("{} end", node.get_kind_str());
 	return result;
@@ -415,14 +732,15 @@ auto GeneralVisitor::binary_operate(llvm::Value* left, const Operation& op,
 	case Operation::op_ne:
 		result = m_builder.CreateICmpNE(left, right);
 		break;
+	// 非零即为真, 截断只保留最低位, 2 && 1会得到0
 	case Operation::op_land:
-		left = m_builder.CreateTrunc(left, llvm::Type::getInt1Ty(m_module->getContext()));
-		right = m_builder.CreateTrunc(right, llvm::Type::getInt1Ty(m_module->getContext()));
+		left = m_builder.CreateICmpNE(left, llvm::ConstantInt::get(left->getType(), 0));
+		right = m_builder.CreateICmpNE(right, llvm::ConstantInt::get(right->getType(), 0));
 		result = m_builder.CreateLogicalAnd(left, right);
 		break;
 	case Operation::op_lor:
-		left = m_builder.CreateTrunc(left, llvm::Type::getInt1Ty(m_module->getContext()));
-		right = m_builder.CreateTrunc(right, llvm::Type::getInt1Ty(m_module->getContext()));
+		left = m_builder.CreateICmpNE(left, llvm::ConstantInt::get(left->getType(), 0));
+		right = m_builder.CreateICmpNE(right, llvm::ConstantInt::get(right->getType(), 0));
 		result = m_builder.CreateLogicalOr(left, right);
 		break;
 	default:
@@ -431,7 +749,8 @@ auto GeneralVisitor::binary_operate(llvm::Value* left, const Operation& op,
 	}
 
 	assert(result != nullptr);
-	m_builder.CreateZExt(result, m_type_mgr->get_signed_int());
+	// 比较与逻辑运算得到i1, 与c语言相同转换为int; 算术运算的结果不变
+	result = m_builder.CreateZExt(result, m_type_mgr->get_signed_int());
 
 	yq::debug("{} [{}] End", op.get_kind_str(), op.get_type_str());
 
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tinyc
+{
+
+/**
+ * @brief 基于栈的字节码指令, 操作数为32位有符号整数
+ * @note 指令为1字节操作码, 带立即数时随后是4字节小端序立即数
+ * @note 跳转只能向前, 目标为函数内的绝对偏移
+ */
+enum class Opcode: std::uint8_t
+{
+	/// @brief imm32: 压入常量
+	push,
+	neg,
+	/// @brief 栈顶为0时替换为1, 否则替换为0
+	logical_not,
+	/// @brief 栈顶非0时替换为1
+	to_bool,
+	add,
+	sub,
+	mul,
+	div,
+	mod,
+	lt,
+	le,
+	gt,
+	ge,
+	eq,
+	ne,
+	/// @brief imm32: 栈顶为0时保留并跳转, 否则弹出, 用于"&&"的短路
+	jump_if_zero_or_pop,
+	/// @brief imm32: 栈顶非0时保留并跳转, 否则弹出, 用于"||"的短路
+	jump_if_nonzero_or_pop,
+	/// @brief 返回栈顶
+	ret,
+};
+
+/// @brief 最后一个操作码, 用于校验
+inline constexpr auto last_opcode = Opcode::ret;
+
+/// @brief 带有4字节立即数的指令
+constexpr auto has_immediate(Opcode opcode) -> bool
+{
+	return opcode == Opcode::push || opcode == Opcode::jump_if_zero_or_pop
+		|| opcode == Opcode::jump_if_nonzero_or_pop;
+}
+
+/**
+ * @brief 字节码文件的公共定义
+ * @note 布局: magic | version | 源文件名 | 函数数量 | 函数*
+ * @note 函数: 名称 | 最大栈深度 | 代码 | 位置表, 整数均为ULEB128
+ */
+struct BytecodeFormat
+{
+	static constexpr char magic[4] { 'T', 'C', 'B', 'C' };
+	/// @note Opcode的数值或编码变化时需要递增
+	static constexpr std::uint64_t version = 1;
+};
+
+/// @brief 一个函数的字节码
+struct BytecodeFunction
+{
+	/// @brief 可能出现运行时错误的指令对应的源码位置, 行列号从1开始
+	struct Position
+	{
+		std::uint32_t pc;
+		std::uint32_t line;
+		std::uint32_t column;
+	};
+
+	std::string name;
+	/// @brief 求值栈需要的最大深度, 由编译器计算, 载入时校验与实际深度相等
+	std::uint32_t max_stack = 0;
+	std::vector<std::uint8_t> code;
+	/// @brief 按pc升序排列
+	std::vector<Position> positions;
+
+	/// @brief pc处指令的位置, 未记录时为nullptr
+	auto find_position(std::uint32_t pc) const -> const Position*;
+};
+
+/**
+ * @brief 一个CompUnit编译出的所有函数
+ * @note 由BytecodeCompiler构造, 或通过read从缓存文件载入
+ */
+class BytecodeModule
+{
+public:
+	BytecodeModule() = default;
+	explicit BytecodeModule(std::string source_name):
+		m_source_name { std::move(source_name) }
+	{}
+
+	void add_function(BytecodeFunction function)
+	{ m_functions.push_back(std::move(function)); }
+
+	/// @return 找不到时为nullptr
+	auto find_function(std::string_view name) const -> const BytecodeFunction*;
+
+	auto get_functions() const -> const std::vector<BytecodeFunction>&
+	{ return m_functions; }
+	auto get_source_name() const -> const std::string&
+	{ return m_source_name; }
+
+	void write(llvm::raw_ostream& os) const;
+
+	/**
+	 * @brief 解析write写出的内容, 并校验每个函数
+	 * @return 出错时返回std::unexpected, 描述错误内容
+	 */
+	static
+	auto read(llvm::StringRef buffer) -> std::expected<BytecodeModule, std::string>;
+
+	/**
+	 * @brief 检查操作码, 跳转目标与栈深度, 通过后虚拟机执行时不再检查
+	 * @note max_stack需要等于实际的最大深度, 虚拟机据此分配求值栈, \
+	 * 过大的值会使载入的文件申请任意大小的内存
+	 * @return 出错时返回std::unexpected, 描述错误内容
+	 */
+	static
+	auto verify(const BytecodeFunction& function) -> std::expected<void, std::string>;
+
+	/// @brief 输出反汇编, 用于调试
+	void print(llvm::raw_ostream& os) const;
+
+private:
+	std::string m_source_name;
+	std::vector<BytecodeFunction> m_functions;
+};
+
+}	//namespace tinyc
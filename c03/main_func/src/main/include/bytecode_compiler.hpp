@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ast_visitor.hpp"
+#include "bytecode.hpp"
+#include <cstdint>
+#include <expected>
+#include <string>
+
+namespace tinyc
+{
+
+/**
+ * @brief 将语法树编译为BytecodeModule
+ * @note 语义与Interpreter相同; 除法与取余记录源码位置, 运行时错误据此报告
+ * @note 比较, "!"与逻辑运算的结果已经是0或1, 作为"&&"与"||"的操作数时省去to_bool
+ */
+class BytecodeCompiler: public ASTVisitorBase<BytecodeCompiler, bool>
+{
+	friend class ASTVisitorBase<BytecodeCompiler, bool>;
+public:
+	/**
+	 * @param source_name 写入模块, 用于运行时错误信息
+	 * @return 出错时返回std::unexpected, 描述错误内容
+	 * @note 编译错误同时通过节点的report报告位置
+	 */
+	auto compile(const CompUnit& comp_unit, std::string source_name)
+		-> std::expected<BytecodeModule, std::string>;
+
+private:
+	auto visit_func_def(const FuncDef& node) -> bool;
+	auto visit_block(const Block& node) -> bool;
+	auto visit_stmt(const Stmt& node) -> bool;
+	auto visit_expr(const Expr& node) -> bool;
+	auto visit_primary_expr(const PrimaryExpr& node) -> bool;
+	auto visit_unary_expr(const UnaryExpr& node) -> bool;
+	auto visit_number(const Number& node) -> bool;
+	auto visit_ident(const Ident& node) -> bool;
+
+	template<typename BinaryExpr>
+	auto visit_binary_expr(const BinaryExpr& node) -> bool;
+
+	auto visit_default(const BaseAST& node) -> bool;
+
+	/// @param stack_effect 执行后栈深度的变化
+	void emit(Opcode opcode, int stack_effect);
+	void emit(Opcode opcode, std::uint32_t immediate, int stack_effect);
+	/// @brief 记录下一条指令的源码位置
+	void mark_position(const BaseAST& node);
+	/// @brief 将at处跳转指令的目标改为当前位置
+	void patch_jump(std::size_t at);
+
+private:
+	BytecodeFunction m_function;
+	std::uint32_t m_depth = 0;
+	/// @brief 最近生成的表达式的值已经是0或1
+	bool m_is_bool = false;
+};
+
+}	//namespace tinyc
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tinyc
+{
+
+/**
+ * @brief 执行BytecodeModule中的函数
+ * @note GCC与Clang下使用computed goto, 每条指令末尾直接跳到下一条指令的处理代码, \
+ * 其余编译器退化为switch循环
+ * @note 执行时不检查栈深度与跳转目标, 由BytecodeModule::verify保证; \
+ * BytecodeCompiler的输出与BytecodeModule::read的结果均已满足
+ * @note 求值栈在多次调用间复用, 同一实例不能在多个线程上同时使用
+ */
+class BytecodeVM
+{
+public:
+	/**
+	 * @brief 调用module中的入口函数, 与JitRunner::run相同
+	 * @return 入口函数的返回值, 出错时返回std::unexpected, 描述错误内容
+	 */
+	auto run(const BytecodeModule& module, std::string_view entry)
+		-> std::expected<int, std::string>;
+
+	/// @param function 属于module, 用于运行时错误信息中的文件名
+	auto run(const BytecodeModule& module, const BytecodeFunction& function)
+		-> std::expected<int, std::string>;
+
+private:
+	std::vector<std::int32_t> m_stack;
+};
+
+}	//namespace tinyc
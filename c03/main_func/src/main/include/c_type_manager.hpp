@@ -1,66 +1,103 @@
 #pragma once
+#include <llvm/IR/DataLayout.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/LLVMContext.h>
-#include <llvm/Target/TargetMachine.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 
 namespace tinyc
 {
 
+/// @brief C的内建类型, 作为CTypeManager中类型表的下标
+enum class CType: std::uint8_t
+{
+	void_,
+	bool_,
+	/// @note 包括char
+	signed_char,
+	unsigned_char,
+	signed_short,
+	unsigned_short,
+	signed_int,
+	unsigned_int,
+	signed_long,
+	unsigned_long,
+	signed_long_long,
+	unsigned_long_long,
+	float_,
+	double_,
+};
+
+inline constexpr std::size_t ctype_count = static_cast<std::size_t>(CType::double_) + 1;
+
+/**
+ * @brief 一个(LLVMContext, DataLayout)下C内建类型到llvm::Type的映射
+ * @note 构造后只读, 可以在多个线程的visitor间共享; 通过get获取缓存的实例
+ * @note llvm::Type属于LLVMContext, 实例不能比context存活更久
+ */
 class CTypeManager
 {
 public:
-	CTypeManager(llvm::LLVMContext& context, llvm::TargetMachine* target_machine);
+	CTypeManager(llvm::LLVMContext& context, const llvm::DataLayout& data_layout);
 
-	auto get_void() const -> llvm::Type*;
-	auto get_bool() const -> llvm::Type*;
-	/// @note 包括char
-	auto get_signed_char() const -> llvm::Type*;
-	auto get_unsigned_char() const -> llvm::Type*;
-	auto get_signed_short() const -> llvm::Type*;
-	auto get_unsigned_short() const -> llvm::Type*;
-	auto get_signed_int() const -> llvm::Type*;
-	auto get_unsigned_int() const -> llvm::Type*;
-	auto get_signed_long() const -> llvm::Type*;
-	auto get_unsigned_long() const -> llvm::Type*;
-	auto get_signed_long_long() const -> llvm::Type*;
-	auto get_unsigned_long_long() const -> llvm::Type*;
+	CTypeManager(const CTypeManager&) = delete;
+	auto operator=(const CTypeManager&) -> CTypeManager& = delete;
 
-	auto get_float() const -> llvm::Type*;
-	auto get_double() const -> llvm::Type*;
+	/**
+	 * @brief 获取context与data_layout对应的实例, 不存在时创建
+	 * @note 缓存只持有weak_ptr, 最后一个使用者释放后实例随之销毁; \
+	 * 持有context的一方(Compiler, IncrementalCompiler等)应在context的生命周期内保留返回值
+	 * @note 线程安全
+	 */
+	static
+	auto get(llvm::LLVMContext& context, const llvm::DataLayout& data_layout)
+		-> std::shared_ptr<const CTypeManager>;
 
-private:
-	auto gen_long_bit_width() -> int
-	{
-		auto pointer_bit_width = m_data_layout.getPointerSizeInBits();
+	auto get(CType type) const -> llvm::Type*
+	{ return m_types[static_cast<std::size_t>(type)]; }
+
+	auto get_void() const -> llvm::Type*
+	{ return get(CType::void_); }
+	auto get_bool() const -> llvm::Type*
+	{ return get(CType::bool_); }
+	/// @note 包括char
+	auto get_signed_char() const -> llvm::Type*
+	{ return get(CType::signed_char); }
+	auto get_unsigned_char() const -> llvm::Type*
+	{ return get(CType::unsigned_char); }
+	auto get_signed_short() const -> llvm::Type*
+	{ return get(CType::signed_short); }
+	auto get_unsigned_short() const -> llvm::Type*
+	{ return get(CType::unsigned_short); }
+	auto get_signed_int() const -> llvm::Type*
+	{ return get(CType::signed_int); }
+	auto get_unsigned_int() const -> llvm::Type*
+	{ return get(CType::unsigned_int); }
+	auto get_signed_long() const -> llvm::Type*
+	{ return get(CType::signed_long); }
+	auto get_unsigned_long() const -> llvm::Type*
+	{ return get(CType::unsigned_long); }
+	auto get_signed_long_long() const -> llvm::Type*
+	{ return get(CType::signed_long_long); }
+	auto get_unsigned_long_long() const -> llvm::Type*
+	{ return get(CType::unsigned_long_long); }
 
-		if (pointer_bit_width == 32)
-			return 32;
-		else if (pointer_bit_width == 64)
-			return 64;
-		else
-			return 32;
-	}
+	auto get_float() const -> llvm::Type*
+	{ return get(CType::float_); }
+	auto get_double() const -> llvm::Type*
+	{ return get(CType::double_); }
+
+	auto get_context() const -> llvm::LLVMContext&
+	{ return m_context; }
+	auto get_data_layout() const -> const llvm::DataLayout&
+	{ return m_data_layout; }
 
 private:
 	llvm::LLVMContext& m_context;
 	llvm::DataLayout m_data_layout;
-
-	llvm::Type* m_void_ty;
-	// integer
-	llvm::Type* m_bool_ty;	//_Bool before c23
-	llvm::Type* m_schar_ty;
-	llvm::Type* m_uchar_ty;
-	llvm::Type* m_sshort_ty;
-	llvm::Type* m_ushort_ty;
-	llvm::Type* m_sint_ty;
-	llvm::Type* m_uint_ty;
-	llvm::Type* m_slong_ty;
-	llvm::Type* m_ulong_ty;
-	llvm::Type* m_slong_long_ty;
-	llvm::Type* m_ulong_long_ty;
-	// floating point
-	llvm::Type* m_float_ty;
-	llvm::Type* m_double_ty;
+	std::array<llvm::Type*, ctype_count> m_types;
 };
 
 }	//namespace tinyc
@@ -1,11 +1,17 @@
 #pragma once
 
 #include "ast.hpp"
+#include "ast_visitor.hpp"
 #include "c_type_manager.hpp"
 #include <easylog.hpp>
 #include <memory>
 #include <expected>
+#include <functional>
+#include <span>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <llvm/IR/DIBuilder.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
@@ -15,14 +21,61 @@
 namespace tinyc
 {
 
-class GeneralVisitor: public ASTVisitor
+/**
+ * @brief 生成llvm ir的访问者
+ * @note 通过ASTVisitorBase静态分派, 表达式, 语句, 块和函数均返回对应的llvm::Value
+ */
+class GeneralVisitor: public ASTVisitorBase<GeneralVisitor, llvm::Value*>
 {
+	friend class ASTVisitorBase<GeneralVisitor, llvm::Value*>;
 public:
+	using TargetMachineFactory =
+		std::function<std::unique_ptr<llvm::TargetMachine>()>;
+
+	/// @brief --emit可以指定的输出种类, 扩展名分别为.o .s .ll .bc
+	enum class EmitKind
+	{
+		object,
+		assembly,
+		llvm_ir,
+		bitcode,
+	};
+
+	/// @brief 生成的调试信息种类
+	enum class DebugInfoKind
+	{
+		none,
+		/// @brief 只为指令附加位置, 不输出调试段, 供优化记录定位源码
+		location_tracking,
+		/// @brief 输出行号表, 使perf等工具可以将样本对应到tinyc源码行
+		line_tables_only,
+	};
+
+	/// @brief emit之前运行的优化流水线
+	struct OptimizeOptions
+	{
+		/// @brief 0表示只在需要插桩或使用profile时运行O0流水线
+		unsigned level = 0;
+		/// @brief 非空时插入插桩, 程序退出时将计数写入该路径, 可以包含%p, %m
+		std::string profile_generate;
+		/// @brief 非空时读取llvm-profdata合并后的profile, 指导分支布局与内联
+		std::string profile_use;
+	};
+
+	/**
+	 * @param type_mgr 需要属于context且与tm的DataLayout一致, 由context的持有者 \
+	 * 通过CTypeManager::get获取一次, 在context的生命周期内供多个visitor共享
+	 */
 	GeneralVisitor(llvm::LLVMContext& context, bool emit_llvm, llvm::SourceMgr& src_mgr,
-				   std::string_view output_file, llvm::TargetMachine* tm);
-	/// @note 只支持从根节点翻译
+				   std::string_view output_file, llvm::TargetMachine* tm,
+				   std::shared_ptr<const CTypeManager> type_mgr);
+	/**
+	 * @note 只支持从CompUnit或FuncDef翻译
+	 * @note 以FuncDef为根时可以逐个函数调用, 结果累积在同一个模块中
+	 * @return 报告过错误(如函数重定义)时返回false
+	 */
 	[[nodiscard]]
-	auto visit(BaseAST* ast) -> bool override;
+	auto visit(const BaseAST* ast) -> bool;
 
 	/**
 	 * @brief 将m_module转换为对应格式输出, 由程序的argc参数指定
@@ -33,24 +86,117 @@ public:
 	[[nodiscard]]
 	auto emit() -> bool;
 
+	/**
+	 * @brief 一次输出多种格式, 文件名为<output>加对应扩展名
+	 * @note 先输出不修改模块的.ll与.bc, 后端会改写IR, 同时需要.s和.o时
+	 * 汇编使用模块的副本, 目标文件使用原模块
+	 * @note 重复的种类只输出一次, 不进行按函数划分的并行代码生成
+	 */
+	[[nodiscard]]
+	auto emit(std::span<const EmitKind> kinds) -> bool;
+
+	/**
+	 * @brief 将一种格式写入调用者提供的流, 不访问文件系统
+	 * @param preserve_module 生成汇编或目标文件会改写模块, 为true时改写模块的副本, \
+	 * 之后仍可以继续输出其他格式
+	 */
+	[[nodiscard]]
+	auto emit(EmitKind kind, llvm::raw_pwrite_stream& os,
+			  bool preserve_module = false) -> bool;
+
+	/**
+	 * @brief 按函数划分模块, 在多个线程上并行生成代码
+	 * @param threads 最大分区数, 实际不超过函数数量
+	 * @param tm_factory 为每个线程构造独立的TargetMachine
+	 * @note 分区数大于1时输出<output>.<i>.o等多个文件, 需要一起链接
+	 */
+	void set_codegen_threads(unsigned threads, TargetMachineFactory tm_factory);
+
+	/// @note 需要在visit之前设置
+	void set_debug_info(DebugInfoKind kind)
+	{ m_debug_info_kind = kind; }
+
+	/// @note 在第一次emit之前生效, 每个模块只优化一次
+	void set_optimize_options(OptimizeOptions options)
+	{ m_optimize_options = std::move(options); }
+
+	/// @brief 输出位码时附带模块摘要索引, 供tinyc-lto进行ThinLTO
+	void set_thin_lto(bool thin_lto)
+	{ m_thin_lto = thin_lto; }
+
+	/**
+	 * @brief 为false时visit不报告诊断, 出错时仍返回false
+	 * @note 同一语法树为多个目标生成IR时, 诊断与目标无关, 只需报告一次
+	 */
+	void set_report_diagnostics(bool report_diagnostics)
+	{ m_report_diagnostics = report_diagnostics; }
+
+	/// @brief emit在输出文件名后追加的扩展名
+	static auto get_output_extension(llvm::CodeGenFileType file_type)
+		-> std::string_view;
+
+	/**
+	 * @brief 按m_optimize_options通过PassBuilder构造并运行流水线
+	 * @note 没有要求优化与PGO时不做任何事
+	 * @note emit会自动调用, 只有不经过emit直接使用模块时(如JIT)需要手动调用
+	 */
+	[[nodiscard]]
+	auto optimize() -> bool;
+
+	/// @brief 生成的模块, 需要在take_module之前调用
+	auto get_module() const -> const llvm::Module&
+	{ return *m_module; }
+
+	/// @brief 转移模块的所有权, 之后不能再调用visit与emit
+	auto take_module() -> std::unique_ptr<llvm::Module>
+	{
+		m_builder.ClearInsertionPoint();
+		return std::move(m_module);
+	}
+
 private:
-	void handle(const CompUnit& node);
-	void handle(const FuncDef& node);
+
+	/// @brief 为函数创建DISubprogram, 第一次调用时创建DICompileUnit
+	void attach_subprogram(llvm::Function& func, const FuncDef& node);
+	/// @brief 之后创建的指令位于node的起始位置
+	void set_debug_location(const BaseAST& node);
+	/// @brief 按m_report_diagnostics决定是否报告
+	void report(const BaseAST& node, Location::DiagKind kind, std::string_view msg) const;
+	/// @brief node起始位置在源码中的行列号, 均从1开始
+	auto get_line_and_column(const BaseAST& node) const
+		-> std::pair<unsigned, unsigned>;
+
+	/// @brief 将module按kind写入os, 汇编与目标文件通过m_target_machine生成
+	auto write_output(llvm::Module& module, EmitKind kind,
+					  llvm::raw_pwrite_stream& os) -> bool;
+
+	/// @brief 使用llvm::splitCodeGen输出partitions个文件
+	auto emit_split(llvm::CodeGenFileType file_type, std::string_view extension,
+					std::size_t partitions) -> bool;
+
+	auto visit_comp_unit(const CompUnit& node) -> llvm::Value*;
+	/// @return 生成的llvm::Function
+	auto visit_func_def(const FuncDef& node) -> llvm::Value*;
+	/// @note 在当前插入点生成语句, 返回插入点所在的llvm::BasicBlock
+	auto visit_block(const Block& node) -> llvm::Value*;
+	/// @return 生成的ret指令
+	auto visit_stmt(const Stmt& node) -> llvm::Value*;
+	auto visit_expr(const Expr& node) -> llvm::Value*;
+	auto visit_primary_expr(const PrimaryExpr& node) -> llvm::Value*;
+	auto visit_unary_expr(const UnaryExpr& node) -> llvm::Value*;
+	auto visit_number(const Number& node) -> llvm::Value*;
+	auto visit_ident(const Ident& node) -> llvm::Value*;
+
+	/// @note L3Expr到LOrExpr均由此处理
+	template<typename BinaryExpr>
+	auto visit_binary_expr(const BinaryExpr& node) -> llvm::Value*;
+
+	/// @brief 类型, 参数等节点不对应llvm::Value, 不应被分派到这里
+	auto visit_default(const BaseAST& node) -> llvm::Value*;
+
 	auto handle(const Type& node) -> llvm::Type*;
-	auto handle(const Ident& node) -> std::pair<llvm::Value*, std::string>;
 	auto handle(const ParamList& node) -> std::vector<llvm::Type*>;
-	auto handle(const Block& node, llvm::Function* func,
-				std::string_view block_name) -> llvm::BasicBlock*;
 	auto handle(const Param& node) -> llvm::Type*;
-	void handle(const Stmt& node);
-	auto handle(const Expr& expr) -> llvm::Value*;
-	auto handle(const PrimaryExpr& node) -> llvm::Value*;
-	auto handle(const UnaryExpr& node) -> llvm::Value*;
-	auto handle(const Number& num) -> llvm::Value*;
-
-	/// @note 在上层会传入所有的BinaryExpr, 无需在实现文件中显式实例化声明
-	template<typename BinaryExpr>
-	auto handle(const BinaryExpr& node) -> llvm::Value*;
 
 	/// @brief 一元运算符处理
 	auto unary_operate(const UnaryOp& op, llvm::Value* operand) -> llvm::Value*;
@@ -61,13 +207,27 @@ private:
 private:
 	std::unique_ptr<llvm::Module> m_module;
 	llvm::IRBuilder<> m_builder;
-	std::shared_ptr<CTypeManager> m_type_mgr;
+	/// @brief 同一context与目标的visitor共享
+	std::shared_ptr<const CTypeManager> m_type_mgr;
 	
 	bool m_emit_llvm;
 	llvm::SourceMgr& m_src_mgr;
 	std::string_view m_output_file;
 	
 	llvm::TargetMachine* m_target_machine;
+	unsigned m_codegen_threads;
+	TargetMachineFactory m_tm_factory;
+	bool m_thin_lto;
+	OptimizeOptions m_optimize_options;
+	bool m_optimized;
+
+	DebugInfoKind m_debug_info_kind;
+	std::unique_ptr<llvm::DIBuilder> m_di_builder;
+	llvm::DIFile* m_di_file;
+	llvm::DISubprogram* m_di_subprogram;
+	/// @brief visit期间报告过错误, 模块不完整
+	bool m_has_error;
+	bool m_report_diagnostics;
 };
 
 }	//namespace tinyc
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ast.hpp"
+#include "general_visitor.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Target/TargetMachine.h>
+
+namespace tinyc
+{
+
+/**
+ * @brief 以函数为单位的增量编译, 每个FuncDef单独生成一个输出文件
+ * @note 缓存键由FuncDef的结构哈希与代码生成选项组成, 命中时跳过
+ * GeneralVisitor与后端, 直接复制缓存中的文件
+ * @note 输出为<output>.<i>.o等多个文件, 与-codegen-threads相同, 需要一起链接;
+ * 编号不小于函数个数的旧文件会被删除
+ * @note 目前函数之间没有调用关系, 单个函数的结果只取决于自身子树;
+ * 支持调用后需要把被调用函数的签名并入键中
+ */
+class IncrementalCompiler
+{
+public:
+	/**
+	 * @param cache_dir 缓存目录, 不存在时自动创建
+	 * @note 其余参数与GeneralVisitor相同
+	 */
+	IncrementalCompiler(llvm::LLVMContext& context, bool emit_llvm,
+						llvm::SourceMgr& src_mgr, std::string_view output_file,
+						llvm::TargetMachine* tm, std::string_view cache_dir);
+
+	/// @brief 转交给每个函数的GeneralVisitor, 同时并入缓存键
+	void set_optimize_options(GeneralVisitor::OptimizeOptions options)
+	{ m_optimize_options = std::move(options); }
+
+	void set_debug_info(GeneralVisitor::DebugInfoKind kind)
+	{ m_debug_info_kind = kind; }
+
+	/// @return true 所有函数均已输出
+	[[nodiscard]]
+	auto compile(const CompUnit& ast) -> bool;
+
+	/// @brief 最近一次compile中复用与重新编译的函数个数
+	auto get_reused_count() const -> std::size_t
+	{ return m_reused_count; }
+	auto get_compiled_count() const -> std::size_t
+	{ return m_compiled_count; }
+
+private:
+	/// @brief 生成调试信息时, 函数的源码位置也是缓存键的一部分
+	auto location_key(const FuncDef& node) const -> std::string;
+
+	/// @brief 影响输出内容的选项, 任何一项变化都会使缓存整体失效
+	auto options_hash() const -> std::uint64_t;
+
+	/**
+	 * @brief 删除之前的编译留下的<output>.<i>文件, i从first_index开始
+	 * @note 函数变少后旧文件仍会被`<output>.*.o`一起链接
+	 */
+	void remove_stale_outputs(std::size_t first_index, std::string_view extension) const;
+
+	/// @brief 为单个函数生成模块并写入缓存, 先写临时文件再改名
+	auto compile_func_def(const FuncDef& node, const std::string& cache_file)
+		-> bool;
+
+private:
+	llvm::LLVMContext& m_context;
+	bool m_emit_llvm;
+	llvm::SourceMgr& m_src_mgr;
+	std::string_view m_output_file;
+	llvm::TargetMachine* m_target_machine;
+	/// @brief 所有未命中缓存的函数共享
+	std::shared_ptr<const CTypeManager> m_type_mgr;
+	std::string m_cache_dir;
+	GeneralVisitor::OptimizeOptions m_optimize_options;
+	GeneralVisitor::DebugInfoKind m_debug_info_kind;
+
+	std::size_t m_reused_count;
+	std::size_t m_compiled_count;
+};
+
+}	//namespace tinyc
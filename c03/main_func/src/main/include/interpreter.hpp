@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ast_visitor.hpp"
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace tinyc
+{
+
+/**
+ * @brief 直接在语法树上求值, 不经过LLVM
+ * @note 语义与GeneralVisitor生成的代码一致: 32位有符号整数, 加减乘按补码回绕, \
+ * "!"与比较, 逻辑运算的结果为int类型的0或1
+ * @note "&&"与"||"按C语言短路求值, 未求值的一侧不会报告运行时错误
+ * @note 除零与INT_MIN / -1在生成的代码中为未定义行为, 此处作为运行时错误报告
+ */
+class Interpreter: public ASTVisitorBase<Interpreter, std::optional<std::int32_t>>
+{
+	friend class ASTVisitorBase<Interpreter, std::optional<std::int32_t>>;
+public:
+	/**
+	 * @brief 调用comp_unit中无参数的入口函数, 与JitRunner::run相同
+	 * @return 入口函数的返回值, 出错时返回std::unexpected, 描述错误内容
+	 * @note 运行时错误同时通过节点的report报告位置
+	 */
+	auto run(const CompUnit& comp_unit, std::string_view entry)
+		-> std::expected<int, std::string>;
+
+private:
+	auto visit_func_def(const FuncDef& node) -> result_type;
+	auto visit_block(const Block& node) -> result_type;
+	auto visit_stmt(const Stmt& node) -> result_type;
+	auto visit_expr(const Expr& node) -> result_type;
+	auto visit_primary_expr(const PrimaryExpr& node) -> result_type;
+	auto visit_unary_expr(const UnaryExpr& node) -> result_type;
+	auto visit_number(const Number& node) -> result_type;
+	auto visit_ident(const Ident& node) -> result_type;
+
+	template<typename BinaryExpr>
+	auto visit_binary_expr(const BinaryExpr& node) -> result_type;
+
+	auto visit_default(const BaseAST& node) -> result_type;
+
+	static
+	auto binary_operate(std::int32_t left, const Operation& op, std::int32_t right)
+		-> result_type;
+};
+
+}	//namespace tinyc
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <expected>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/Module.h>
+
+namespace tinyc
+{
+
+/**
+ * @brief 在当前进程中通过ORC JIT执行生成的模块
+ * @note 使用RTDyldObjectLinkingLayer, 以便挂载JITEventListener, \
+ * 让perf与gdb能够识别JIT生成的函数
+ * @note 需要通过create构造
+ */
+class JitRunner
+{
+public:
+	/// @brief 可以注册的JIT事件监听者
+	enum class Listener
+	{
+		/// @brief 写出/tmp/perf-<pid>.map, perf report据此解析符号
+		perf_map,
+		/// @brief 写出jitdump, perf inject之后可以带行号annotate, 需要LLVM开启LLVM_USE_PERF
+		jitdump,
+		/// @brief 通过GDB JIT接口注册目标文件, 带有调试信息时gdb可以按源码行断点
+		gdb,
+	};
+
+	/**
+	 * @return 出错时返回std::unexpected, 描述错误内容
+	 */
+	static auto create(std::span<const Listener> listeners)
+		-> std::expected<std::unique_ptr<JitRunner>, std::string>;
+
+	/**
+	 * @brief 将模块复制到JIT自己的LLVMContext后加入
+	 * @note 调用者的模块与context不受影响, 可以继续输出文件
+	 */
+	auto add_module(const llvm::Module& module) -> std::expected<void, std::string>;
+
+	/// @brief 可以从宿主直接调用的函数: 无参数, 返回int
+	using EntryFunction = int (*)();
+
+	/**
+	 * @brief 检查模块中定义了name, 且签名与EntryFunction一致
+	 * @note lookup只返回地址, 按EntryFunction调用void或带参数的函数是未定义行为, \
+	 * 需要在加入模块前检查
+	 */
+	static auto check_entry(const llvm::Module& module, std::string_view name)
+		-> std::expected<void, std::string>;
+
+	/**
+	 * @brief 查找函数的地址, 首次查找时触发编译
+	 * @note LLJIT允许在其他线程上调用已编译的函数时继续加入模块与查找
+	 */
+	auto lookup(std::string_view name) -> std::expected<EntryFunction, std::string>;
+
+	/**
+	 * @brief 查找并调用无参数, 返回int的入口函数
+	 * @return 入口函数的返回值
+	 */
+	auto run(std::string_view entry) -> std::expected<int, std::string>;
+
+private:
+	JitRunner() = default;
+
+private:
+	// 对象链接层持有监听者的引用, 需要晚于m_jit析构
+	std::unique_ptr<llvm::JITEventListener> m_perf_map_listener;
+	std::unique_ptr<llvm::orc::LLJIT> m_jit;
+};
+
+}	//namespace tinyc
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "driver.hpp"
+#include "line_index.hpp"
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/SourceMgr.h>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tinyc
+{
+
+/**
+ * @brief 编辑器中打开的一个文档, 按顶层函数切分为若干段分别解析
+ * @note 每段从上一段结尾开始, 到顶层的"}"为止, 拥有独立的SourceMgr, driver与语法树
+ * @note 编辑只重新扫描受损区域内的段边界, 重新解析与之相交的段; \
+ * 其余段的FuncDef与诊断信息原样复用, 只平移偏移量
+ * @note 位置中的character按字节计算, tinyc源码只含ASCII字符时与UTF-16相同
+ */
+class LspDocument
+{
+public:
+	struct Options
+	{
+		Driver::ParserKind parser = Driver::ParserKind::bison;
+		/// @brief 每段的错误上限, 0表示不限制
+		std::size_t error_limit = 20;
+	};
+
+	/// @brief LSP中的位置, 行与列均从0开始
+	struct Position
+	{
+		std::size_t line;
+		std::size_t character;
+	};
+
+	struct Range
+	{
+		Position start;
+		Position end;
+	};
+
+	LspDocument(std::string uri, std::string text, Options options);
+
+	LspDocument(const LspDocument&) = delete;
+	auto operator=(const LspDocument&) -> LspDocument& = delete;
+
+	/**
+	 * @brief 应用textDocument/didChange中的一项修改
+	 * @param range 为空时text替换整个文档
+	 * @note 只标记受影响的段, 解析在update中进行
+	 */
+	void apply_change(std::optional<Range> range, std::string_view text);
+
+	/**
+	 * @brief 解析所有被标记的段
+	 * @return 本次解析的段数
+	 */
+	auto update() -> std::size_t;
+
+	/// @brief 所有段的诊断信息, 格式为LSP的Diagnostic[]
+	auto get_diagnostics() const -> llvm::json::Array;
+
+	auto get_uri() const -> const std::string&
+	{ return m_uri; }
+	auto get_text() const -> const std::string&
+	{ return m_text; }
+	auto get_chunk_count() const -> std::size_t
+	{ return m_chunks.size(); }
+
+private:
+	/// @brief 文档中的一段, [begin, end)为在当前文本中的偏移
+	struct Chunk
+	{
+		std::size_t begin = 0;
+		std::size_t end = 0;
+		/// @brief 只含空白与注释的段不需要解析
+		bool has_tokens = false;
+		bool dirty = true;
+		/// @brief driver中的语法树位置指向src_mgr中的缓冲区
+		std::unique_ptr<llvm::SourceMgr> src_mgr;
+		std::unique_ptr<Driver> driver;
+		/// @brief 行列号相对于段的开头
+		std::vector<llvm::SMDiagnostic> diagnostics;
+	};
+
+	/**
+	 * @brief 从offset开始扫描一段: 跳过注释, 到深度回到0的"}"之后为止
+	 * @note 深度为0时多余的"}"同样结束一段, 没有闭合时延伸到文本末尾
+	 */
+	auto scan_chunk(std::size_t offset) const -> Chunk;
+
+	void parse_chunk(Chunk& chunk);
+
+	auto to_offset(Position position) const -> std::size_t;
+
+private:
+	std::string m_uri;
+	std::string m_text;
+	Options m_options;
+	/// @brief m_text的行首偏移, 每次修改后重建
+	LineIndex m_line_index;
+	/// @brief 按偏移排列, 首尾相接覆盖整个文本
+	std::vector<Chunk> m_chunks;
+};
+
+}	//namespace tinyc
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "lsp_document.hpp"
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include <istream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace tinyc
+{
+
+/**
+ * @brief 通过stdin/stdout与编辑器通信的语言服务器, 只提供诊断信息
+ * @note 消息格式为Content-Length头加JSON-RPC, 文档同步使用增量模式
+ * @note 每次修改后只重新解析受影响的函数, 见LspDocument
+ * @note 单线程处理, 消息按到达顺序执行
+ */
+class LspServer
+{
+public:
+	LspServer(std::istream& in, llvm::raw_ostream& out, LspDocument::Options options);
+
+	/**
+	 * @brief 处理消息直到收到exit或输入结束
+	 * @return 按协议, 收到shutdown后退出为0, 否则为1
+	 */
+	auto run() -> int;
+
+private:
+	/// @brief 读取一条消息的内容, 输入结束或格式错误时为空
+	auto read_message() -> std::optional<std::string>;
+	void write_message(llvm::json::Value message);
+
+	void handle_message(const llvm::json::Object& message);
+	void reply(const llvm::json::Value& id, llvm::json::Value result);
+	void reply_error(const llvm::json::Value& id, int code, llvm::StringRef message);
+	void notify(llvm::StringRef method, llvm::json::Value params);
+
+	void did_open(const llvm::json::Object& params);
+	void did_change(const llvm::json::Object& params);
+	void did_close(const llvm::json::Object& params);
+
+	/// @brief 解析被修改的部分并发送textDocument/publishDiagnostics
+	void publish_diagnostics(LspDocument& document);
+
+	static
+	auto parse_position(const llvm::json::Object* position)
+		-> std::optional<LspDocument::Position>;
+
+private:
+	std::istream& m_in;
+	llvm::raw_ostream& m_out;
+	LspDocument::Options m_options;
+	/// @brief uri -> 打开的文档
+	std::map<std::string, std::unique_ptr<LspDocument>, std::less<>> m_documents;
+	bool m_shutdown;
+	bool m_exit;
+};
+
+}	//namespace tinyc
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "driver.hpp"
+#include "general_visitor.hpp"
+#include <llvm/Target/TargetMachine.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace tinyc
+{
+
+/**
+ * @brief 只解析一次, 为每个目标生成IR并输出到<output>.<triple>
+ * @note 每个目标拥有独立的TargetMachine, LLVMContext与visitor
+ * @note 语义错误与目标无关, 第一个目标的IR先在当前线程上生成, 只有它报告诊断; \
+ * 之后其余目标的IR生成与所有目标的优化和输出并行进行
+ */
+class MultiTargetCompiler
+{
+public:
+	/// @brief 按三元组创建TargetMachine, 不支持时报告错误并返回nullptr
+	using TargetMachineFactory =
+		std::function<std::unique_ptr<llvm::TargetMachine>(const std::string& triple)>;
+	/// @brief 按命令行选择的种类写出一个目标的输出
+	using EmitFunction = std::function<bool(GeneralVisitor&)>;
+
+	struct Options
+	{
+		/// @brief 源文件, load_ast非空时忽略
+		std::string input_file;
+		/// @brief 非空时载入-emit-ast写出的语法树, 不再解析
+		std::string load_ast;
+		Driver::ParserKind parser = Driver::ParserKind::bison;
+		/// @brief 0表示不限制
+		std::size_t error_limit = 0;
+		/// @brief 输出bison的移进与归约过程
+		bool trace = false;
+		/// @brief 输出各阶段的耗时
+		bool time_report = false;
+		/// @brief 各目标的输出为<output_file>.<triple>
+		std::string output_file;
+		bool emit_llvm = false;
+		/// @brief 见GeneralVisitor::set_codegen_threads
+		unsigned codegen_threads = 1;
+		bool thin_lto = false;
+		GeneralVisitor::OptimizeOptions optimize;
+		GeneralVisitor::DebugInfoKind debug_info = GeneralVisitor::DebugInfoKind::none;
+	};
+
+	MultiTargetCompiler(TargetMachineFactory tm_factory, EmitFunction emit, Options options);
+
+	/**
+	 * @param triples 已规范化并去重
+	 * @return 所有目标都成功时为0, 失败的目标逐个报告
+	 */
+	auto compile(std::span<const std::string> triples) -> int;
+
+private:
+	TargetMachineFactory m_tm_factory;
+	EmitFunction m_emit;
+	Options m_options;
+};
+
+}	//namespace tinyc
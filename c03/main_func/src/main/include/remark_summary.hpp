@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace tinyc
+{
+
+/**
+ * @brief 统计优化过程中产生的remark, 按函数与pass分别计数
+ * @note 安装到LLVMContext后所有remark都会被生成, 但不会逐条输出
+ * @note 其余诊断, 包括"loop not vectorized"之类的优化失败警告, 仍交给LLVMContext的默认处理
+ */
+class RemarkSummary: public llvm::DiagnosticHandler
+{
+public:
+	struct Counter
+	{
+		std::size_t passed = 0;
+		std::size_t missed = 0;
+		std::size_t analysis = 0;
+	};
+
+	auto handleDiagnostics(const llvm::DiagnosticInfo& info) -> bool override;
+
+	auto isAnalysisRemarkEnabled(llvm::StringRef) const -> bool override
+	{ return true; }
+	auto isMissedOptRemarkEnabled(llvm::StringRef) const -> bool override
+	{ return true; }
+	auto isPassedOptRemarkEnabled(llvm::StringRef) const -> bool override
+	{ return true; }
+	auto isAnyRemarkEnabled() const -> bool override
+	{ return true; }
+
+	/// @brief 输出按函数与按pass两张表
+	void print(llvm::raw_ostream& os) const;
+
+private:
+	static void print_table(llvm::raw_ostream& os, llvm::StringRef title,
+							const std::map<std::string, Counter>& counters);
+
+private:
+	// 使用有序容器, 输出顺序稳定
+	std::map<std::string, Counter> m_by_function;
+	std::map<std::string, Counter> m_by_pass;
+};
+
+}	//namespace tinyc
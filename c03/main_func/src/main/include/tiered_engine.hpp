@@ -0,0 +1,130 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "general_visitor.hpp"
+#include "jit_runner.hpp"
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tinyc
+{
+
+/**
+ * @brief 分层执行: 函数先在字节码虚拟机上执行, 调用次数达到阈值后在后台线程上 \
+ * 经GeneralVisitor与ORC编译, 完成后替换入口
+ * @note 每个FuncDef有一个入口指针作为跳板, call先读取该指针, 非空时直接调用本机代码; \
+ * 后台线程编译完成后以release写入, 调用者无需加锁
+ * @note 语法树与src_mgr需要比引擎活得更久, 后台线程编译时读取语法树
+ * @note 需要通过create构造
+ */
+class TieredEngine
+{
+public:
+	struct Options
+	{
+		/// @brief 在字节码层的调用次数达到该值时开始编译, 0表示不升层
+		std::uint64_t tier_up_threshold = 1000;
+		GeneralVisitor::OptimizeOptions optimize;
+	};
+
+	/**
+	 * @param tm_factory 在后台线程第一次编译时调用
+	 * @return 出错时返回std::unexpected, 描述错误内容
+	 */
+	static
+	auto create(const CompUnit& comp_unit, llvm::SourceMgr& src_mgr,
+				GeneralVisitor::TargetMachineFactory tm_factory, Options options)
+		-> std::expected<std::unique_ptr<TieredEngine>, std::string>;
+
+	/// @brief 放弃尚未开始的编译, 等待正在进行的编译结束
+	~TieredEngine();
+
+	TieredEngine(const TieredEngine&) = delete;
+	auto operator=(const TieredEngine&) -> TieredEngine& = delete;
+
+	/**
+	 * @brief 调用无参数的函数, 可以在多个线程上同时调用
+	 * @return 函数的返回值, 出错时返回std::unexpected, 描述错误内容
+	 */
+	auto call(std::string_view name) -> std::expected<int, std::string>;
+
+	/// @brief 等待已经触发的编译全部完成, 用于测量与测试
+	void wait_for_compilation();
+
+	/// @brief 输出每个函数在字节码层的调用次数与当前所在的层
+	void print_stats(llvm::raw_ostream& os) const;
+
+private:
+	enum class Tier
+	{
+		bytecode,
+		/// @brief 已加入编译队列
+		compiling,
+		native,
+		/// @brief 编译失败, 之后一直留在字节码层
+		failed,
+		/**
+		 * @brief 字节码层执行出错过, 之后一直留在字节码层
+		 * @note 除零等错误在本机代码中是未定义行为, 升层会使报错变成任意返回值
+		 */
+		pinned,
+	};
+
+	struct FunctionState
+	{
+		const FuncDef* func_def = nullptr;
+		const BytecodeFunction* bytecode = nullptr;
+		std::atomic<std::uint64_t> calls { 0 };
+		std::atomic<JitRunner::EntryFunction> native { nullptr };
+		std::atomic<Tier> tier { Tier::bytecode };
+	};
+
+	TieredEngine(llvm::SourceMgr& src_mgr, GeneralVisitor::TargetMachineFactory tm_factory,
+				 Options options, BytecodeModule module);
+
+	void compile_loop(std::stop_token stop_token);
+	/// @brief 在后台线程上调用
+	auto compile_native(FunctionState& state) -> std::expected<void, std::string>;
+	/// @brief 字节码层执行出错后调用, 阻止之后的升层与已编译代码的发布
+	void pin_to_bytecode(FunctionState& state);
+
+private:
+	llvm::SourceMgr& m_src_mgr;
+	GeneralVisitor::TargetMachineFactory m_tm_factory;
+	Options m_options;
+	BytecodeModule m_module;
+	/// @brief 构造后不再增删, 元素地址稳定
+	std::vector<std::unique_ptr<FunctionState>> m_functions;
+	std::unordered_map<std::string_view, FunctionState*> m_index;
+
+	/// @brief 以下各项只在后台线程上访问, 与m_tm一起创建
+	std::unique_ptr<llvm::TargetMachine> m_tm;
+	/// @brief 所有函数的模块都在此context中生成, add_module之后即销毁
+	std::unique_ptr<llvm::LLVMContext> m_context;
+	std::shared_ptr<const CTypeManager> m_type_mgr;
+	std::unique_ptr<JitRunner> m_jit;
+
+	/// @brief 同时保护编译队列, 以及本机入口的发布与pin_to_bytecode
+	std::mutex m_mutex;
+	std::condition_variable_any m_queue_cv;
+	std::condition_variable m_idle_cv;
+	std::deque<FunctionState*> m_queue;
+	/// @brief 已取出但尚未完成的编译数
+	std::size_t m_in_progress;
+	// 最后构造, 最先析构, 后台线程结束前其余成员均有效
+	std::jthread m_compile_thread;
+};
+
+}	//namespace tinyc
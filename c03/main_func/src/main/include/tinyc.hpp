@@ -0,0 +1,104 @@
+#pragma once
+
+#include "diagnostic_engine.hpp"
+#include "driver.hpp"
+#include "general_visitor.hpp"
+#include "jit_runner.hpp"
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+/**
+ * libtinyc 对外接口: 编译内存中的源码, 结果与诊断信息均留在内存中
+ * 不创建进程, 不读写文件
+ */
+
+namespace tinyc
+{
+
+/// @brief 一条诊断信息
+struct Diagnostic
+{
+	Location::DiagKind kind;
+	std::string message;
+	/// @brief CompileOptions::buffer_name
+	std::string file_name;
+	/// @brief 行列号从1开始, 与源码无关的诊断为0
+	unsigned line;
+	unsigned column;
+	/// @brief 与命令行输出相同的文本, 包括源码行与位置标记
+	std::string rendered;
+};
+
+struct CompileOptions
+{
+	/// @brief 诊断信息与调试信息中使用的文件名
+	std::string buffer_name = "<input>";
+	/// @brief output_kinds为空时只生成模块, 不运行后端
+	std::vector<GeneralVisitor::EmitKind> output_kinds = {
+		GeneralVisitor::EmitKind::object
+	};
+	GeneralVisitor::OptimizeOptions optimize = {};
+	GeneralVisitor::DebugInfoKind debug_info = GeneralVisitor::DebugInfoKind::none;
+	/// @brief 保留优化后的模块, 用于检查IR或交给JIT
+	bool keep_module = false;
+	/// @brief 与-ferror-limit相同, 达到后停止解析, 0表示不限制
+	std::size_t error_limit = 20;
+	Driver::ParserKind parser = Driver::ParserKind::bison;
+};
+
+struct CompileResult
+{
+	std::vector<Diagnostic> diagnostics;
+	/// @brief 与CompileOptions::output_kinds一一对应
+	std::vector<llvm::SmallVector<char, 0>> outputs;
+	/// @brief 属于Compiler的LLVMContext, 只在keep_module时非空
+	std::unique_ptr<llvm::Module> module;
+	bool success = false;
+};
+
+
+/**
+ * @brief 使用调用者提供的LLVMContext与TargetMachine编译源码
+ * @note 多个Compiler可以在不同线程上使用各自的context同时编译
+ * @note 同一个Compiler不能被多个线程同时使用
+ */
+class Compiler
+{
+public:
+	Compiler(llvm::LLVMContext& context, llvm::TargetMachine& tm);
+
+	[[nodiscard]]
+	auto compile(std::string_view source, const CompileOptions& options = {})
+		-> CompileResult;
+
+	/**
+	 * @brief 为compile保留的模块创建JIT
+	 * @param entry 之后通过JitRunner::run调用的函数, 需要是int entry()
+	 * @note 模块会被复制, result仍可继续使用
+	 */
+	[[nodiscard]]
+	static auto create_jit(const llvm::Module& module, std::string_view entry = "main",
+						   std::span<const JitRunner::Listener> listeners = {})
+		-> std::expected<std::unique_ptr<JitRunner>, std::string>;
+
+private:
+	/// @brief 源码诊断留在diag_engine中, 其余错误加入result
+	auto compile_source(std::string_view source, const CompileOptions& options,
+						llvm::SourceMgr& src_mgr,
+						const DiagnosticEngine& diag_engine,
+						CompileResult& result) -> bool;
+
+	llvm::LLVMContext& m_context;
+	llvm::TargetMachine& m_target_machine;
+	/// @brief 每次compile的visitor共享
+	std::shared_ptr<const CTypeManager> m_type_mgr;
+};
+
+}	//namespace tinyc
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "tinyc.hpp"
+#include <llvm/Target/TargetMachine.h>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <map>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tinyc
+{
+
+/**
+ * @brief 通过inotify监视源文件, 只重新编译发生变化的文件
+ * @note 目标初始化, TargetMachine与未变化文件的结果均留在内存中
+ * @note 每次编译使用新的LLVMContext, 类型与常量不会随会话时长累积
+ * @note 监视文件所在的目录而不是文件本身, 编辑器以改名方式保存时也能收到事件
+ * @note 输出写到源文件旁, 扩展名替换为对应格式, 如foo.c -> foo.o
+ */
+class Watcher
+{
+public:
+	Watcher(llvm::TargetMachine& tm, CompileOptions options);
+	~Watcher();
+
+	Watcher(const Watcher&) = delete;
+	auto operator=(const Watcher&) -> Watcher& = delete;
+
+	/**
+	 * @param path 源文件或目录, 目录中所有.c文件都会被监视(不递归)
+	 * @return 出错时返回std::unexpected, 描述错误内容
+	 */
+	auto add_path(std::string_view path) -> std::expected<void, std::string>;
+
+	/**
+	 * @brief 先编译所有文件, 之后阻塞等待变化并增量编译
+	 * @return 只在inotify出错时返回
+	 */
+	auto run() -> int;
+
+	/// @brief 强制编译所有已知的文件
+	void compile_all();
+
+	/**
+	 * @brief 阻塞读取一批inotify事件并处理
+	 * @return 出错时返回std::unexpected, 描述错误内容
+	 */
+	auto read_events() -> std::expected<void, std::string>;
+
+	/**
+	 * @brief 处理read读到的一段inotify_event
+	 * @note 队列溢出(IN_Q_OVERFLOW)时事件已丢失, 重新检查所有文件, 内容未变的不会编译
+	 */
+	void handle_events(std::span<const char> events);
+
+	/// @brief 实际调用Compiler的次数, 内容未变而跳过的不计
+	auto get_compile_count() const -> std::size_t
+	{ return m_compile_count; }
+
+private:
+	/// @brief 单个源文件上一次编译的状态
+	struct FileState
+	{
+		/// @brief 内容不变时(如只更新了时间戳)跳过编译
+		std::uint64_t content_hash = 0;
+		bool success = false;
+	};
+
+	/// @brief 在目录上注册inotify, 同一目录只注册一次
+	auto watch_directory(const std::string& dir) -> std::expected<void, std::string>;
+	/// @brief 该文件是否需要编译: 被显式添加, 或位于整体监视的目录中
+	auto is_tracked(const std::string& dir, std::string_view name) const -> bool;
+
+	/// @brief 编译并写出一个文件, 输出诊断与耗时
+	void compile_file(const std::string& path, bool force);
+	/// @brief 文件被删除或移走
+	void forget_file(const std::string& path);
+	/// @brief 事件丢失后重新扫描整体监视的目录, 并检查所有文件
+	void rescan();
+	auto output_path(const std::string& path, GeneralVisitor::EmitKind kind) const
+		-> std::string;
+
+private:
+	llvm::TargetMachine& m_target_machine;
+	CompileOptions m_options;
+	int m_inotify_fd;
+
+	/// @brief watch descriptor -> 目录
+	std::unordered_map<int, std::string> m_watched_dirs;
+	/// @brief 显式添加的文件
+	std::set<std::string> m_files;
+	/// @brief 整体监视的目录
+	std::set<std::string> m_whole_dirs;
+	std::map<std::string, FileState> m_states;
+	std::size_t m_compile_count;
+};
+
+}	//namespace tinyc
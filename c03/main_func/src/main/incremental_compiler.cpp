@@ -0,0 +1,190 @@
+#include "incremental_compiler.hpp"
+#include "ast_hash.hpp"
+#include "llvm_location.hpp"
+#include <easylog.hpp>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/CodeGen/CommandFlags.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/xxhash.h>
+
+#include <format>
+
+namespace tinyc
+{
+
+/// @brief GeneralVisitor的生成结果改变时需要递增, 使旧缓存失效
+static constexpr std::uint64_t irgen_version = 1;
+
+IncrementalCompiler::IncrementalCompiler(llvm::LLVMContext& context, bool emit_llvm,
+										 llvm::SourceMgr& src_mgr,
+										 std::string_view output_file,
+										 llvm::TargetMachine* tm,
+										 std::string_view cache_dir):
+	m_context { context },
+	m_emit_llvm { emit_llvm },
+	m_src_mgr { src_mgr },
+	m_output_file { output_file },
+	m_target_machine { tm },
+	m_type_mgr { CTypeManager::get(context, tm->createDataLayout()) },
+	m_cache_dir { cache_dir },
+	m_optimize_options {},
+	m_debug_info_kind { GeneralVisitor::DebugInfoKind::none },
+	m_reused_count { 0 },
+	m_compiled_count { 0 }
+{
+}
+
+auto IncrementalCompiler::compile(const CompUnit& ast) -> bool
+{
+	m_reused_count = 0;
+	m_compiled_count = 0;
+
+	if (auto ec = llvm::sys::fs::create_directories(m_cache_dir))
+	{
+		yq::error("Could not create cache directory {}: {}", m_cache_dir, ec.message());
+		return false;
+	}
+
+	// 每个函数在各自的模块中生成, GeneralVisitor看不到同名函数, 需要在这里拒绝
+	llvm::StringSet<> func_names;
+	bool redefined = false;
+	for (const auto& func_def : ast)
+	{
+		assert(func_def != nullptr);
+		const auto& ident = func_def->get_ident();
+		if (func_names.insert(ident.get_value()).second)
+			continue;
+		ident.report(Location::dk_error,
+					 std::format("redefinition of function {}", ident.get_value()));
+		redefined = true;
+	}
+	if (redefined)
+		return false;
+
+	auto extension =
+		GeneralVisitor::get_output_extension(llvm::codegen::getFileType());
+	auto options = options_hash();
+
+	std::size_t index = 0;
+	for (const auto& func_def : ast)
+	{
+		assert(func_def != nullptr);
+		auto key = std::format("{:016x}{:016x}{}", structural_hash(*func_def), options,
+							   location_key(*func_def));
+
+		llvm::SmallString<128> cache_file { m_cache_dir };
+		llvm::sys::path::append(cache_file, key + std::string { extension });
+		std::string cache_path { cache_file.str() };
+
+		if (llvm::sys::fs::exists(cache_path))
+		{
+			yq::debug("reuse {} from {}", func_def->get_ident().get_value(), cache_path);
+			++m_reused_count;
+		}
+		else
+		{
+			if (!compile_func_def(*func_def, cache_path))
+				return false;
+			++m_compiled_count;
+		}
+
+		auto output_path = std::format("{}.{}{}", m_output_file, index, extension);
+		if (auto ec = llvm::sys::fs::copy_file(cache_path, output_path))
+		{
+			yq::error("Could not copy {} to {}: {}", cache_path, output_path,
+					  ec.message());
+			return false;
+		}
+		++index;
+	}
+
+	remove_stale_outputs(index, extension);
+	return true;
+}
+
+void IncrementalCompiler::remove_stale_outputs(std::size_t first_index,
+											   std::string_view extension) const
+{
+	// 输出总是从0开始连续编号, 遇到第一个不存在的编号即可停止
+	for (auto index = first_index;; ++index)
+	{
+		auto output_path = std::format("{}.{}{}", m_output_file, index, extension);
+		if (!llvm::sys::fs::exists(output_path))
+			break;
+		if (auto ec = llvm::sys::fs::remove(output_path))
+		{
+			yq::error("Could not remove stale output {}: {}", output_path, ec.message());
+			break;
+		}
+		yq::debug("remove stale output {}", output_path);
+	}
+}
+
+auto IncrementalCompiler::location_key(const FuncDef& node) const -> std::string
+{
+	if (m_debug_info_kind == GeneralVisitor::DebugInfoKind::none)
+		return {};
+
+	// 结构哈希不含位置, 而调试信息中的行列号取决于函数所在行与其中的排版
+	const auto& location = static_cast<const LLVMLocation&>(node.get_location());
+	auto line = location.get_line_and_column().first;
+	llvm::StringRef text { location.begin.getPointer(),
+						   static_cast<std::size_t>(location.end.getPointer()
+													- location.begin.getPointer()) };
+	return std::format("{:016x}l{}", llvm::xxHash64(text), line);
+}
+
+auto IncrementalCompiler::options_hash() const -> std::uint64_t
+{
+	const auto& tm = *m_target_machine;
+	const auto& optimize = m_optimize_options;
+
+	// profile内容变化时优化结果也会变化, 因此使用内容的哈希而不是路径
+	std::uint64_t profile_hash = 0;
+	if (!optimize.profile_use.empty())
+	{
+		if (auto buffer = llvm::MemoryBuffer::getFile(optimize.profile_use))
+			profile_hash = llvm::xxHash64((*buffer)->getBuffer());
+	}
+
+	auto options = std::format(
+		"{}|{}|{}|{}|{}|{}|{}|{}|{}|{}|{}|{:x}|{}", irgen_version,
+		tm.getTargetTriple().str(), tm.getTargetCPU().str(),
+		tm.getTargetFeatureString().str(),
+		static_cast<int>(tm.getRelocationModel()),
+		static_cast<int>(tm.getCodeModel()),
+		static_cast<int>(tm.getOptLevel()),
+		static_cast<int>(llvm::codegen::getFileType()), m_emit_llvm,
+		optimize.level, optimize.profile_generate, profile_hash,
+		static_cast<int>(m_debug_info_kind));
+	return llvm::xxHash64(options);
+}
+
+auto IncrementalCompiler::compile_func_def(const FuncDef& node,
+										   const std::string& cache_file) -> bool
+{
+	// GeneralVisitor在名字后追加扩展名, 临时文件为<key>.tmp<ext>
+	auto extension =
+		GeneralVisitor::get_output_extension(llvm::codegen::getFileType());
+	auto stem = cache_file.substr(0, cache_file.size() - extension.size());
+	auto tmp_stem = stem + ".tmp";
+
+	GeneralVisitor visitor { m_context, m_emit_llvm, m_src_mgr, tmp_stem,
+							 m_target_machine, m_type_mgr };
+	visitor.set_optimize_options(m_optimize_options);
+	visitor.set_debug_info(m_debug_info_kind);
+	if (!visitor.visit(&node) || !visitor.emit())
+		return false;
+
+	auto tmp_file = tmp_stem + std::string { extension };
+	if (auto ec = llvm::sys::fs::rename(tmp_file, cache_file))
+	{
+		yq::error("Could not rename {} to {}: {}", tmp_file, cache_file, ec.message());
+		return false;
+	}
+	return true;
+}
+
+}	//namespace tinyc
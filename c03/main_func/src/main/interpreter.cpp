@@ -0,0 +1,202 @@
+#include "interpreter.hpp"
+#include <easylog.hpp>
+#include <format>
+#include <limits>
+
+namespace tinyc
+{
+
+namespace
+{
+
+/// @brief 与LLVM的add, sub, mul相同, 按补码回绕而不是有符号溢出
+auto wrap(std::uint32_t value) -> std::int32_t
+{
+	return static_cast<std::int32_t>(value);
+}
+
+}	//namespace
+
+auto Interpreter::run(const CompUnit& comp_unit, std::string_view entry)
+	-> std::expected<int, std::string>
+{
+	for (const auto& func_def : comp_unit)
+	{
+		assert(func_def != nullptr);
+		if (func_def->get_ident().get_value() != entry)
+			continue;
+		if (!func_def->get_paramlist().get_params().empty())
+			return std::unexpected { std::format("entry function {} must take no parameters",
+												 entry) };
+
+		auto result = visit_node(*func_def);
+		if (!result)
+			return std::unexpected { std::format("evaluation of {} failed", entry) };
+		return *result;
+	}
+	return std::unexpected { std::format("entry function {} not found", entry) };
+}
+
+auto Interpreter::visit_func_def(const FuncDef& node) -> result_type
+{
+	auto result = visit_node(node.get_block());
+	if (!result && node.get_block().get_exprs().empty())
+		node.report(Location::dk_error, std::format("function {} does not return a value",
+													 node.get_ident().get_value()));
+	return result;
+}
+
+auto Interpreter::visit_block(const Block& node) -> result_type
+{
+	// 每条语句都是return, 之后的语句不可达, 与GeneralVisitor相同
+	for (const auto& stmt : node)
+	{
+		assert(stmt != nullptr);
+		return visit_node(*stmt);
+	}
+	return std::nullopt;
+}
+
+auto Interpreter::visit_stmt(const Stmt& node) -> result_type
+{
+	return visit_node(node.get_expr());
+}
+
+auto Interpreter::visit_expr(const Expr& node) -> result_type
+{
+	return visit_node(node.get_low_expr());
+}
+
+auto Interpreter::visit_primary_expr(const PrimaryExpr& node) -> result_type
+{
+	return node.visit([this](const auto& value) {
+		return visit_node(value);
+	});
+}
+
+auto Interpreter::visit_unary_expr(const UnaryExpr& node) -> result_type
+{
+	return node.visit(util::overloaded {
+		[this](const PrimaryExpr& primary_expr) {
+			return visit_node(primary_expr);
+		},
+		[this](const UnaryOp& op, const UnaryExpr& unary_expr) -> result_type {
+			auto operand = visit_node(unary_expr);
+			if (!operand)
+				return std::nullopt;
+
+			switch (op.get_type())
+			{
+			case Operation::op_add:
+				return *operand;
+			case Operation::op_sub:
+				return wrap(0u - static_cast<std::uint32_t>(*operand));
+			// c语言not操作的结果为int类型
+			case Operation::op_not:
+				return *operand == 0 ? 1 : 0;
+			default:
+				yq::fatal(yq::loc(), "Unprocessed unary operate");
+				return std::nullopt;
+			}
+		},
+	});
+}
+
+auto Interpreter::visit_number(const Number& node) -> result_type
+{
+	return node.get_int_literal();
+}
+
+auto Interpreter::visit_ident(const Ident& node) -> result_type
+{
+	// GeneralVisitor同样不能对标识符生成代码
+	node.report(Location::dk_error,
+				std::format("identifier {} cannot be evaluated", node.get_value()));
+	return std::nullopt;
+}
+
+template<typename BinaryExpr>
+auto Interpreter::visit_binary_expr(const BinaryExpr& node) -> result_type
+{
+	using SelfExpr = typename BinaryExpr::SelfExprPtr::element_type;
+	using HigherExpr = typename BinaryExpr::HigherExprPtr::element_type;
+	using Op = typename BinaryExpr::OpPtr::element_type;
+
+	return node.visit(util::overloaded {
+		[this](const HigherExpr& higher_expr) {
+			return visit_node(higher_expr);
+		},
+		[this](const SelfExpr& self_expr, const Op& op,
+			   const HigherExpr& higher_expr) -> result_type {
+			auto left = visit_node(self_expr);
+			if (!left)
+				return std::nullopt;
+
+			// 左侧已经决定结果时不再求值右侧
+			if (op.get_type() == Operation::op_land && *left == 0)
+				return 0;
+			if (op.get_type() == Operation::op_lor && *left != 0)
+				return 1;
+
+			auto right = visit_node(higher_expr);
+			if (!right)
+				return std::nullopt;
+
+			auto result = binary_operate(*left, op, *right);
+			if (!result)
+				op.report(Location::dk_error, *right == 0
+					? "division by zero" : "signed division overflow");
+			return result;
+		},
+	});
+}
+
+auto Interpreter::visit_default(const BaseAST& node) -> result_type
+{
+	yq::fatal(yq::loc(), "{} can not be evaluated", node.get_kind_str());
+	return std::nullopt;
+}
+
+auto Interpreter::binary_operate(std::int32_t left, const Operation& op,
+								 std::int32_t right) -> result_type
+{
+	auto lhs = static_cast<std::uint32_t>(left);
+	auto rhs = static_cast<std::uint32_t>(right);
+
+	switch (op.get_type())
+	{
+	case Operation::op_add:
+		return wrap(lhs + rhs);
+	case Operation::op_sub:
+		return wrap(lhs - rhs);
+	case Operation::op_mul:
+		return wrap(lhs * rhs);
+	case Operation::op_div:
+	case Operation::op_mod:
+		if (right == 0
+			|| (left == std::numeric_limits<std::int32_t>::min() && right == -1))
+			return std::nullopt;
+		return op.get_type() == Operation::op_div ? left / right : left % right;
+	case Operation::op_lt:
+		return left < right ? 1 : 0;
+	case Operation::op_le:
+		return left <= right ? 1 : 0;
+	case Operation::op_gt:
+		return left > right ? 1 : 0;
+	case Operation::op_ge:
+		return left >= right ? 1 : 0;
+	case Operation::op_eq:
+		return left == right ? 1 : 0;
+	case Operation::op_ne:
+		return left != right ? 1 : 0;
+	case Operation::op_land:
+		return left != 0 && right != 0 ? 1 : 0;
+	case Operation::op_lor:
+		return left != 0 || right != 0 ? 1 : 0;
+	default:
+		yq::fatal(yq::loc(), "Unprocessed binary operate");
+		return std::nullopt;
+	}
+}
+
+}	//namespace tinyc
@@ -0,0 +1,190 @@
+#include "jit_runner.hpp"
+#include <easylog.hpp>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <format>
+#include <mutex>
+
+namespace tinyc
+{
+
+namespace
+{
+
+/**
+ * @brief perf的map文件格式: 每行 "起始地址 大小 符号名", 地址与大小为十六进制
+ * @note perf只在采样时读取该文件, 函数释放后条目保留
+ */
+class PerfMapListener: public llvm::JITEventListener
+{
+public:
+	PerfMapListener():
+		m_mutex {},
+		m_os {}
+	{
+		auto file_name = std::format("/tmp/perf-{}.map",
+									 llvm::sys::Process::getProcessId());
+		std::error_code ec;
+		m_os = std::make_unique<llvm::raw_fd_ostream>(
+			file_name, ec, llvm::sys::fs::OF_Append);
+		if (ec)
+		{
+			yq::error("Could not open file {}: {}", file_name, ec.message());
+			m_os.reset();
+		}
+	}
+
+	void notifyObjectLoaded(ObjectKey, const llvm::object::ObjectFile& obj,
+							const llvm::RuntimeDyld::LoadedObjectInfo& info) override
+	{
+		if (m_os == nullptr)
+			return;
+
+		// 用于调试的副本中符号地址已经重定位为加载后的地址
+		auto debug_obj = info.getObjectForDebug(obj);
+		if (debug_obj.getBinary() == nullptr)
+			return;
+
+		std::lock_guard lock { m_mutex };
+		for (const auto& [symbol, size] :
+			 llvm::object::computeSymbolSizes(*debug_obj.getBinary()))
+		{
+			auto type = symbol.getType();
+			if (!type)
+			{
+				llvm::consumeError(type.takeError());
+				continue;
+			}
+			if (*type != llvm::object::SymbolRef::ST_Function)
+				continue;
+
+			auto name = symbol.getName();
+			auto address = symbol.getAddress();
+			if (!name || !address)
+			{
+				llvm::consumeError(name.takeError());
+				llvm::consumeError(address.takeError());
+				continue;
+			}
+			*m_os << std::format("{:x} {:x} {}\n", *address, size, name->str());
+		}
+		m_os->flush();
+	}
+
+private:
+	std::mutex m_mutex;
+	std::unique_ptr<llvm::raw_fd_ostream> m_os;
+};
+
+}	//namespace
+
+auto JitRunner::create(std::span<const Listener> listeners)
+	-> std::expected<std::unique_ptr<JitRunner>, std::string>
+{
+	// 构造函数为私有，无法使用std::make_unique
+	std::unique_ptr<JitRunner> runner { new JitRunner };
+
+	std::vector<llvm::JITEventListener*> event_listeners;
+	if (llvm::is_contained(listeners, Listener::perf_map))
+	{
+		runner->m_perf_map_listener = std::make_unique<PerfMapListener>();
+		event_listeners.push_back(runner->m_perf_map_listener.get());
+	}
+	if (llvm::is_contained(listeners, Listener::jitdump))
+	{
+		auto listener = llvm::JITEventListener::createPerfJITEventListener();
+		if (listener == nullptr)
+			return std::unexpected { "jitdump requires LLVM built with LLVM_USE_PERF" };
+		event_listeners.push_back(listener);
+	}
+	if (llvm::is_contained(listeners, Listener::gdb))
+		event_listeners.push_back(llvm::JITEventListener::createGDBRegistrationListener());
+
+	auto jit_or_error = llvm::orc::LLJITBuilder {}
+		.setObjectLinkingLayerCreator(
+			[event_listeners](llvm::orc::ExecutionSession& session, const llvm::Triple&)
+				-> llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>> {
+				auto layer = std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(
+					session, [] { return std::make_unique<llvm::SectionMemoryManager>(); });
+				for (auto listener : event_listeners)
+					layer->registerJITEventListener(*listener);
+				return layer;
+			})
+		.create();
+	if (!jit_or_error)
+		return std::unexpected { llvm::toString(jit_or_error.takeError()) };
+	runner->m_jit = std::move(*jit_or_error);
+
+	return runner;
+}
+
+auto JitRunner::add_module(const llvm::Module& module) -> std::expected<void, std::string>
+{
+	// 经过位码复制到新的context, JIT可以独占该context
+	llvm::SmallVector<char, 0> buffer;
+	llvm::raw_svector_ostream os { buffer };
+	llvm::WriteBitcodeToFile(module, os);
+
+	auto context = std::make_unique<llvm::LLVMContext>();
+	auto module_or_error = llvm::parseBitcodeFile(
+		llvm::MemoryBufferRef { llvm::StringRef { buffer.data(), buffer.size() },
+								module.getModuleIdentifier() },
+		*context);
+	if (!module_or_error)
+		return std::unexpected { llvm::toString(module_or_error.takeError()) };
+
+	auto copy = std::move(*module_or_error);
+	copy->setDataLayout(m_jit->getDataLayout());
+	copy->setTargetTriple(m_jit->getTargetTriple().str());
+
+	if (auto err = m_jit->addIRModule(
+			llvm::orc::ThreadSafeModule { std::move(copy), std::move(context) }))
+		return std::unexpected { llvm::toString(std::move(err)) };
+
+	return {};
+}
+
+auto JitRunner::check_entry(const llvm::Module& module, std::string_view name)
+	-> std::expected<void, std::string>
+{
+	auto func = module.getFunction(name);
+	if (func == nullptr || func->isDeclaration())
+		return std::unexpected { std::format("function {} not found", name) };
+
+	auto func_type = func->getFunctionType();
+	if (!func_type->getReturnType()->isIntegerTy(32) || func_type->getNumParams() != 0
+		|| func_type->isVarArg())
+	{
+		return std::unexpected { std::format(
+			"function {} cannot be called from the host, expected int {}()", name, name) };
+	}
+	return {};
+}
+
+auto JitRunner::lookup(std::string_view name) -> std::expected<EntryFunction, std::string>
+{
+	auto symbol_or_error = m_jit->lookup(name);
+	if (!symbol_or_error)
+		return std::unexpected { llvm::toString(symbol_or_error.takeError()) };
+
+	return symbol_or_error->toPtr<EntryFunction>();
+}
+
+auto JitRunner::run(std::string_view entry) -> std::expected<int, std::string>
+{
+	auto func_or_error = lookup(entry);
+	if (!func_or_error)
+		return std::unexpected { std::move(func_or_error.error()) };
+
+	return (*func_or_error)();
+}
+
+}	//namespace tinyc
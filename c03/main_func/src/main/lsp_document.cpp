@@ -0,0 +1,236 @@
+#include "lsp_document.hpp"
+#include "diagnostic_engine.hpp"
+#include <easylog.hpp>
+#include <algorithm>
+#include <iterator>
+
+namespace tinyc
+{
+
+LspDocument::LspDocument(std::string uri, std::string text, Options options):
+	m_uri { std::move(uri) },
+	m_text {},
+	m_options { options },
+	m_line_index { m_text },
+	m_chunks {}
+{
+	apply_change(std::nullopt, text);
+}
+
+void LspDocument::apply_change(std::optional<Range> range, std::string_view text)
+{
+	// 修改在旧文本中的范围[start, end)
+	std::size_t start = 0;
+	std::size_t end = m_text.size();
+	if (range.has_value())
+	{
+		start = to_offset(range->start);
+		end = std::max(start, to_offset(range->end));
+	}
+	auto old_size = m_text.size();
+	m_text.replace(start, end - start, text);
+	m_line_index = LineIndex { m_text };
+
+	// 完全位于修改之前的段原样保留, 修改之后的段平移到新文本中的位置
+	// 延伸到文本末尾的段可能没有闭合, 在末尾追加时同样需要重新扫描
+	auto first_damaged = std::ranges::find_if(m_chunks,
+		[start, old_size](const Chunk& chunk)
+		{ return chunk.end > start || chunk.end == old_size; });
+	auto first_kept = std::find_if(first_damaged, m_chunks.end(),
+		[end](const Chunk& chunk) { return chunk.begin >= end; });
+
+	auto delta = static_cast<std::ptrdiff_t>(text.size())
+		- static_cast<std::ptrdiff_t>(end - start);
+	std::vector<Chunk> kept_after;
+	kept_after.reserve(static_cast<std::size_t>(m_chunks.end() - first_kept));
+	for (auto it = first_kept; it != m_chunks.end(); ++it)
+	{
+		it->begin = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(it->begin) + delta);
+		it->end = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(it->end) + delta);
+		kept_after.push_back(std::move(*it));
+	}
+
+	std::size_t offset = first_damaged == m_chunks.begin()
+		? 0 : std::prev(first_damaged)->end;
+	m_chunks.erase(first_damaged, m_chunks.end());
+	auto kept_before = m_chunks.size();
+
+	// 扫描过修改的文本后, 停在某个保留段的开头时扫描状态与之前相同, 之后的段不再扫描
+	auto damaged_end = start + text.size();
+	auto next_kept = kept_after.begin();
+	while (offset < m_text.size())
+	{
+		if (offset >= damaged_end)
+		{
+			while (next_kept != kept_after.end() && next_kept->begin < offset)
+				++next_kept;
+			if (next_kept != kept_after.end() && next_kept->begin == offset)
+				break;
+		}
+		auto chunk = scan_chunk(offset);
+		offset = chunk.end;
+		m_chunks.push_back(std::move(chunk));
+	}
+	auto rescanned = m_chunks.size() - kept_before;
+
+	if (offset < m_text.size())
+		m_chunks.insert(m_chunks.end(), std::make_move_iterator(next_kept),
+						std::make_move_iterator(kept_after.end()));
+	yq::debug("{}: {} chunks, {} rescanned", m_uri, m_chunks.size(), rescanned);
+}
+
+auto LspDocument::update() -> std::size_t
+{
+	std::size_t parsed = 0;
+	for (auto& chunk : m_chunks)
+	{
+		if (!chunk.dirty)
+			continue;
+		chunk.dirty = false;
+		chunk.diagnostics.clear();
+		chunk.driver.reset();
+		chunk.src_mgr.reset();
+		if (!chunk.has_tokens)
+			continue;
+		parse_chunk(chunk);
+		++parsed;
+	}
+	return parsed;
+}
+
+void LspDocument::parse_chunk(Chunk& chunk)
+{
+	chunk.src_mgr = std::make_unique<llvm::SourceMgr>();
+	DiagnosticEngine diag_engine { *chunk.src_mgr };
+	diag_engine.set_error_limit(m_options.error_limit);
+
+	DriverFactory driver_factory { *chunk.src_mgr };
+	auto source = llvm::StringRef { m_text }.slice(chunk.begin, chunk.end);
+	auto driver_or_error = driver_factory.produce_driver(
+		llvm::MemoryBuffer::getMemBufferCopy(source, m_uri));
+	if (!driver_or_error)
+	{
+		yq::error("{}", driver_or_error.error());
+		return;
+	}
+	chunk.driver = std::move(driver_or_error.value());
+	chunk.driver->set_diag_engine(&diag_engine);
+	chunk.driver->set_parser_kind(m_options.parser);
+	chunk.driver->parse();
+	chunk.driver->set_diag_engine(nullptr);
+	chunk.driver->release_parser();
+	chunk.diagnostics = diag_engine.take_diagnostics();
+}
+
+auto LspDocument::get_diagnostics() const -> llvm::json::Array
+{
+	llvm::json::Array result;
+	for (const auto& chunk : m_chunks)
+	{
+		if (chunk.diagnostics.empty())
+			continue;
+		auto [first_line, first_column] =
+			m_line_index.get_line_and_column(m_text.data() + chunk.begin);
+
+		for (const auto& diag : chunk.diagnostics)
+		{
+			// 诊断中的行号从1开始, 列号从0开始, 均相对于段的开头
+			auto line = diag.getLineNo() > 0
+				? static_cast<std::size_t>(diag.getLineNo()) : std::size_t { 1 };
+			auto column_base = line == 1 ? std::size_t { first_column - 1 } : 0;
+			auto doc_line = static_cast<std::int64_t>(first_line - 1 + line - 1);
+			auto column = static_cast<std::int64_t>(column_base
+				+ static_cast<std::size_t>(std::max(diag.getColumnNo(), 0)));
+			auto column_end = column + 1;
+			if (!diag.getRanges().empty())
+			{
+				column = static_cast<std::int64_t>(column_base
+					+ diag.getRanges().front().first);
+				column_end = static_cast<std::int64_t>(column_base
+					+ diag.getRanges().back().second);
+			}
+
+			int severity = 1;
+			switch (diag.getKind())
+			{
+			case llvm::SourceMgr::DK_Error:
+				severity = 1;
+				break;
+			case llvm::SourceMgr::DK_Warning:
+				severity = 2;
+				break;
+			case llvm::SourceMgr::DK_Remark:
+				severity = 3;
+				break;
+			case llvm::SourceMgr::DK_Note:
+				severity = 4;
+				break;
+			}
+
+			result.push_back(llvm::json::Object {
+				{ "range", llvm::json::Object {
+					{ "start", llvm::json::Object {
+						{ "line", doc_line }, { "character", column } } },
+					{ "end", llvm::json::Object {
+						{ "line", doc_line }, { "character", column_end } } },
+				} },
+				{ "severity", severity },
+				{ "source", "tinyc" },
+				{ "message", diag.getMessage().str() },
+			});
+		}
+	}
+	return result;
+}
+
+auto LspDocument::scan_chunk(std::size_t offset) const -> Chunk
+{
+	Chunk chunk;
+	chunk.begin = offset;
+	std::size_t depth = 0;
+	std::size_t pos = offset;
+	const std::size_t size = m_text.size();
+
+	while (pos < size)
+	{
+		char ch = m_text[pos];
+		if (ch == '/' && pos + 1 < size && m_text[pos + 1] == '/')
+		{
+			auto newline = m_text.find('\n', pos);
+			pos = newline == std::string::npos ? size : newline + 1;
+			continue;
+		}
+		if (ch == '/' && pos + 1 < size && m_text[pos + 1] == '*')
+		{
+			auto close = m_text.find("*/", pos + 2);
+			pos = close == std::string::npos ? size : close + 2;
+			continue;
+		}
+		++pos;
+		if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r')
+			continue;
+
+		chunk.has_tokens = true;
+		if (ch == '{')
+			++depth;
+		else if (ch == '}')
+		{
+			if (depth <= 1)
+				break;
+			--depth;
+		}
+	}
+
+	chunk.end = pos;
+	return chunk;
+}
+
+auto LspDocument::to_offset(Position position) const -> std::size_t
+{
+	// 超出最后一行时为文本末尾, 列号不越过行尾
+	auto line_start = m_line_index.get_line_start(position.line);
+	auto line_end = m_line_index.get_line_start(position.line + 1);
+	return std::min(line_start + position.character, line_end);
+}
+
+}	//namespace tinyc
@@ -0,0 +1,269 @@
+#include "lsp_server.hpp"
+#include <easylog.hpp>
+#include <charconv>
+#include <chrono>
+#include <format>
+
+namespace tinyc
+{
+
+namespace
+{
+
+/// @brief JSON-RPC定义的错误码
+constexpr int method_not_found = -32601;
+
+}	//namespace
+
+LspServer::LspServer(std::istream& in, llvm::raw_ostream& out,
+					 LspDocument::Options options):
+	m_in { in },
+	m_out { out },
+	m_options { options },
+	m_documents {},
+	m_shutdown { false },
+	m_exit { false }
+{}
+
+auto LspServer::run() -> int
+{
+	while (!m_exit)
+	{
+		auto content = read_message();
+		if (!content)
+			break;
+
+		auto message = llvm::json::parse(*content);
+		if (!message)
+		{
+			yq::error("lsp: {}", llvm::toString(message.takeError()));
+			continue;
+		}
+		if (auto* object = message->getAsObject(); object != nullptr)
+			handle_message(*object);
+		else
+			yq::error("lsp: message is not an object");
+	}
+	return m_shutdown ? 0 : 1;
+}
+
+auto LspServer::read_message() -> std::optional<std::string>
+{
+	std::size_t length = 0;
+	bool has_length = false;
+	std::string line;
+	// 头部以空行结束, 每行以\r\n结尾
+	while (std::getline(m_in, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty())
+			break;
+
+		constexpr std::string_view content_length = "Content-Length:";
+		if (line.starts_with(content_length))
+		{
+			auto value = std::string_view { line }.substr(content_length.size());
+			while (!value.empty() && value.front() == ' ')
+				value.remove_prefix(1);
+			auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+			has_length = ec == std::errc {};
+		}
+	}
+	if (!m_in || !has_length)
+		return std::nullopt;
+
+	std::string content(length, '\0');
+	if (!m_in.read(content.data(), static_cast<std::streamsize>(length)))
+		return std::nullopt;
+	return content;
+}
+
+void LspServer::write_message(llvm::json::Value message)
+{
+	std::string content;
+	llvm::raw_string_ostream os { content };
+	os << message;
+	os.flush();
+	m_out << "Content-Length: " << content.size() << "\r\n\r\n" << content;
+	m_out.flush();
+}
+
+void LspServer::handle_message(const llvm::json::Object& message)
+{
+	auto method = message.getString("method");
+	const auto* id = message.get("id");
+	const auto* params = message.getObject("params");
+	if (!method)
+	{
+		// 服务器不发送请求, 不会收到响应
+		return;
+	}
+
+	if (*method == "initialize" && id != nullptr)
+	{
+		reply(*id, llvm::json::Object {
+			{ "capabilities", llvm::json::Object {
+				{ "textDocumentSync", llvm::json::Object {
+					{ "openClose", true },
+					// 2: Incremental
+					{ "change", 2 },
+				} },
+			} },
+			{ "serverInfo", llvm::json::Object { { "name", "tinyc" } } },
+		});
+	}
+	else if (*method == "shutdown" && id != nullptr)
+	{
+		m_shutdown = true;
+		reply(*id, nullptr);
+	}
+	else if (*method == "exit")
+		m_exit = true;
+	else if (params != nullptr && *method == "textDocument/didOpen")
+		did_open(*params);
+	else if (params != nullptr && *method == "textDocument/didChange")
+		did_change(*params);
+	else if (params != nullptr && *method == "textDocument/didClose")
+		did_close(*params);
+	else if (id != nullptr)
+		reply_error(*id, method_not_found, std::format("unsupported method {}", method->str()));
+	// 其余通知(如initialized)直接忽略
+}
+
+void LspServer::reply(const llvm::json::Value& id, llvm::json::Value result)
+{
+	write_message(llvm::json::Object {
+		{ "jsonrpc", "2.0" },
+		{ "id", id },
+		{ "result", std::move(result) },
+	});
+}
+
+void LspServer::reply_error(const llvm::json::Value& id, int code, llvm::StringRef message)
+{
+	write_message(llvm::json::Object {
+		{ "jsonrpc", "2.0" },
+		{ "id", id },
+		{ "error", llvm::json::Object {
+			{ "code", code },
+			{ "message", message },
+		} },
+	});
+}
+
+void LspServer::notify(llvm::StringRef method, llvm::json::Value params)
+{
+	write_message(llvm::json::Object {
+		{ "jsonrpc", "2.0" },
+		{ "method", method },
+		{ "params", std::move(params) },
+	});
+}
+
+void LspServer::did_open(const llvm::json::Object& params)
+{
+	const auto* text_document = params.getObject("textDocument");
+	if (text_document == nullptr)
+		return;
+	auto uri = text_document->getString("uri");
+	auto text = text_document->getString("text");
+	if (!uri || !text)
+		return;
+
+	auto document = std::make_unique<LspDocument>(uri->str(), text->str(), m_options);
+	auto& ref = *document;
+	m_documents.insert_or_assign(uri->str(), std::move(document));
+	publish_diagnostics(ref);
+}
+
+void LspServer::did_change(const llvm::json::Object& params)
+{
+	const auto* text_document = params.getObject("textDocument");
+	const auto* changes = params.getArray("contentChanges");
+	if (text_document == nullptr || changes == nullptr)
+		return;
+	auto uri = text_document->getString("uri");
+	if (!uri)
+		return;
+	auto it = m_documents.find(*uri);
+	if (it == m_documents.end())
+	{
+		yq::error("lsp: change to unopened document {}", uri->str());
+		return;
+	}
+
+	auto& document = *it->second;
+	for (const auto& change_value : *changes)
+	{
+		const auto* change = change_value.getAsObject();
+		if (change == nullptr)
+			continue;
+		auto text = change->getString("text");
+		if (!text)
+			continue;
+
+		std::optional<LspDocument::Range> range;
+		if (const auto* range_object = change->getObject("range"); range_object != nullptr)
+		{
+			auto start = parse_position(range_object->getObject("start"));
+			auto end = parse_position(range_object->getObject("end"));
+			if (!start || !end)
+				continue;
+			range = LspDocument::Range { *start, *end };
+		}
+		document.apply_change(range, *text);
+	}
+	publish_diagnostics(document);
+}
+
+void LspServer::did_close(const llvm::json::Object& params)
+{
+	const auto* text_document = params.getObject("textDocument");
+	if (text_document == nullptr)
+		return;
+	auto uri = text_document->getString("uri");
+	if (!uri)
+		return;
+	auto it = m_documents.find(*uri);
+	if (it == m_documents.end())
+		return;
+	m_documents.erase(it);
+
+	// 清除编辑器中残留的诊断
+	notify("textDocument/publishDiagnostics", llvm::json::Object {
+		{ "uri", *uri },
+		{ "diagnostics", llvm::json::Array {} },
+	});
+}
+
+void LspServer::publish_diagnostics(LspDocument& document)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto parsed = document.update();
+	auto diagnostics = document.get_diagnostics();
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start);
+	yq::debug("lsp: {} reparsed {}/{} chunks in {} us", document.get_uri(),
+			  parsed, document.get_chunk_count(), elapsed.count());
+
+	notify("textDocument/publishDiagnostics", llvm::json::Object {
+		{ "uri", document.get_uri() },
+		{ "diagnostics", std::move(diagnostics) },
+	});
+}
+
+auto LspServer::parse_position(const llvm::json::Object* position)
+	-> std::optional<LspDocument::Position>
+{
+	if (position == nullptr)
+		return std::nullopt;
+	auto line = position->getInteger("line");
+	auto character = position->getInteger("character");
+	if (!line || !character || *line < 0 || *character < 0)
+		return std::nullopt;
+	return LspDocument::Position {
+		static_cast<std::size_t>(*line), static_cast<std::size_t>(*character) };
+}
+
+}	//namespace tinyc
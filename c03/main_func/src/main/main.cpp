@@ -1,22 +1,50 @@
+#include "ast_serializer.hpp"
+#include "bytecode_compiler.hpp"
+#include "bytecode_vm.hpp"
+#include "bounded_queue.hpp"
+#include "diagnostic_engine.hpp"
 #include "driver.hpp"
 #include "general_visitor.hpp"
+#include "incremental_compiler.hpp"
+#include "interpreter.hpp"
+#include "jit_runner.hpp"
+#include "lsp_server.hpp"
+#include "multi_target_compiler.hpp"
+#include "remark_summary.hpp"
+#include "tiered_engine.hpp"
+#include "watcher.hpp"
 #include <llvm/CodeGen/CommandFlags.h>
+#include <llvm/IR/LLVMRemarkStreamer.h>
 #include <llvm/MC/TargetRegistry.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/InitLLVM.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/Timer.h>
+#include <llvm/Support/ToolOutputFile.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/TargetParser/Host.h>
 #include <llvm/TargetParser/Triple.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 //帮助codegen 生成target_options
 static llvm::codegen::RegisterCodeGenFlags CGF;
 
 // 定义命令行选项
-static llvm::cl::opt<std::string> input_file {
-	llvm::cl::Positional, // 位置参数，无需用 "--" 指定
-	llvm::cl::desc("<input file>"),
-	llvm::cl::init("tinyc.out") // 默认值为 empty
+/// 位置参数，无需用 "--" 指定; 只有-watch可以接受多个
+static llvm::cl::list<std::string> input_files {
+	llvm::cl::Positional,
+	llvm::cl::desc("<input files>")
 };
 
 static llvm::cl::opt<std::string> output_file{
@@ -38,9 +66,201 @@ static llvm::cl::opt<bool> debug_trace{
 	llvm::cl::init(false)
 };
 
-static llvm::cl::opt<std::string> mtriple {
+/// 可以重复指定; 多于一个目标时只解析一次, 各目标并行生成<output>.<triple>的输出
+static llvm::cl::list<std::string> mtriple {
 	"mtriple",
-	llvm::cl::desc("Override target triple for module")
+	llvm::cl::desc("Override target triple for module, repeat for several targets"),
+	llvm::cl::value_desc("triple")
+};
+
+/// 逗号分隔的目标三元组, 与-mtriple合并
+static llvm::cl::list<std::string> target_list {
+	"targets",
+	llvm::cl::desc("Compile for each of the comma separated target triples"),
+	llvm::cl::value_desc("triple,..."),
+	llvm::cl::CommaSeparated
+};
+
+/// 指定后忽略-filetype与-emit-llvm, 一次编译输出多种格式
+static llvm::cl::list<tinyc::GeneralVisitor::EmitKind> emit_kinds {
+	"emit",
+	llvm::cl::desc("Comma separated list of outputs to write"),
+	llvm::cl::CommaSeparated,
+	llvm::cl::values(
+		clEnumValN(tinyc::GeneralVisitor::EmitKind::object, "obj",
+				   "Object file (.o)"),
+		clEnumValN(tinyc::GeneralVisitor::EmitKind::assembly, "asm",
+				   "Assembly (.s)"),
+		clEnumValN(tinyc::GeneralVisitor::EmitKind::llvm_ir, "llvm",
+				   "LLVM IR (.ll)"),
+		clEnumValN(tinyc::GeneralVisitor::EmitKind::bitcode, "bc",
+				   "LLVM bitcode (.bc)"))
+};
+
+static llvm::cl::opt<bool> emit_bc {
+	"emit-bc",
+	llvm::cl::desc("Emit LLVM bitcode (.bc) instead of machine code"),
+	llvm::cl::init(false)
+};
+
+enum class LtoMode
+{
+	none,
+	thin,
+};
+
+/// 输出带摘要索引的位码, 之后由tinyc-lto完成跨文件优化与代码生成
+static llvm::cl::opt<LtoMode> lto_mode {
+	"flto",
+	llvm::cl::desc("Emit bitcode for link time optimization"),
+	llvm::cl::init(LtoMode::none),
+	llvm::cl::values(
+		clEnumValN(LtoMode::none, "none", "No link time optimization"),
+		clEnumValN(LtoMode::thin, "thin", "Bitcode with a ThinLTO module summary"))
+};
+
+/// 同时决定IR优化流水线与后端的优化级别
+static llvm::cl::opt<unsigned> opt_level {
+	"O",
+	llvm::cl::desc("Optimization level, -O0 to -O3"),
+	llvm::cl::Prefix,
+	llvm::cl::init(0)
+};
+
+/// 不带值时与clang相同, 写入当前目录的default_%m.profraw
+static llvm::cl::opt<std::string> profile_generate {
+	"fprofile-generate",
+	llvm::cl::desc("Instrument the generated code to collect an execution profile"),
+	llvm::cl::value_desc("path"),
+	llvm::cl::ValueOptional
+};
+
+static llvm::cl::opt<std::string> profile_use {
+	"fprofile-use",
+	llvm::cl::desc("Optimize with a profile merged by llvm-profdata"),
+	llvm::cl::value_desc("file")
+};
+
+static llvm::cl::opt<bool> line_tables_only {
+	"gline-tables-only",
+	llvm::cl::desc("Emit debug line tables mapping code to tinyc source lines"),
+	llvm::cl::init(false)
+};
+
+/// 不输出文件, 在当前进程中JIT执行入口函数, 以其返回值作为退出码
+static llvm::cl::opt<bool> jit {
+	"jit",
+	llvm::cl::desc("Run the entry function in-process through ORC JIT"),
+	llvm::cl::init(false)
+};
+
+static llvm::cl::opt<std::string> jit_entry {
+	"jit-entry",
+	llvm::cl::desc("Function called by -jit"),
+	llvm::cl::value_desc("name"),
+	llvm::cl::init("main")
+};
+
+/// 单独使用时不初始化任何目标, 与-jit同时使用时比较两者的结果
+static llvm::cl::opt<bool> interpret {
+	"interpret",
+	llvm::cl::desc("Evaluate the entry function on the AST without LLVM"),
+	llvm::cl::init(false)
+};
+
+enum class InterpreterKind
+{
+	ast,
+	bytecode,
+	/// @brief 见TieredEngine
+	tiered,
+};
+
+static llvm::cl::opt<InterpreterKind> interpreter_kind {
+	"interpreter",
+	llvm::cl::desc("Execution engine used by -interpret"),
+	llvm::cl::init(InterpreterKind::ast),
+	llvm::cl::values(
+		clEnumValN(InterpreterKind::ast, "ast", "Walk the AST"),
+		clEnumValN(InterpreterKind::bytecode, "bytecode",
+				   "Compile to bytecode and run it on the threaded VM"),
+		clEnumValN(InterpreterKind::tiered, "tiered",
+				   "Start in the bytecode VM and JIT hot functions in the background"))
+};
+
+static llvm::cl::opt<unsigned> tier_up_threshold {
+	"tier-up-threshold",
+	llvm::cl::desc("Bytecode calls before -interpreter=tiered compiles a function (0 = never)"),
+	llvm::cl::value_desc("N"),
+	llvm::cl::init(1000)
+};
+
+/// 与-ftime-report一起使用时输出每次的平均耗时
+static llvm::cl::opt<unsigned> interpret_runs {
+	"interpret-runs",
+	llvm::cl::desc("Call the entry function N times under -interpret"),
+	llvm::cl::value_desc("N"),
+	llvm::cl::init(1)
+};
+
+/// 写出后停止, 之后可以通过-load-bytecode跳过解析与编译
+static llvm::cl::opt<std::string> emit_bytecode {
+	"emit-bytecode",
+	llvm::cl::desc("Write the compiled bytecode and stop"),
+	llvm::cl::value_desc("filename")
+};
+
+/// 指定后忽略<input file>, 直接在虚拟机上执行
+static llvm::cl::opt<std::string> load_bytecode {
+	"load-bytecode",
+	llvm::cl::desc("Run the bytecode written by -emit-bytecode"),
+	llvm::cl::value_desc("filename")
+};
+
+static llvm::cl::list<tinyc::JitRunner::Listener> jit_listeners {
+	"jit-listener",
+	llvm::cl::desc("Make JIT code visible to profilers and debuggers"),
+	llvm::cl::CommaSeparated,
+	llvm::cl::values(
+		clEnumValN(tinyc::JitRunner::Listener::perf_map, "perf-map",
+				   "Write /tmp/perf-<pid>.map"),
+		clEnumValN(tinyc::JitRunner::Listener::jitdump, "jitdump",
+				   "Write a jitdump file for perf inject"),
+		clEnumValN(tinyc::JitRunner::Listener::gdb, "gdb",
+				   "Register objects through the GDB JIT interface"))
+};
+
+/// 输入可以是文件或目录, 每次变化只重新编译对应的文件
+static llvm::cl::opt<bool> watch {
+	"watch",
+	llvm::cl::desc("Watch the inputs with inotify and recompile changed files"),
+	llvm::cl::init(false)
+};
+
+/// 不带值时使用yaml格式
+static llvm::cl::opt<std::string> save_optimization_record {
+	"fsave-optimization-record",
+	llvm::cl::desc("Save optimization remarks in the given format (yaml, bitstream)"),
+	llvm::cl::value_desc("format"),
+	llvm::cl::ValueOptional
+};
+
+static llvm::cl::opt<std::string> optimization_record_file {
+	"foptimization-record-file",
+	llvm::cl::desc("Remark file name, defaults to <output>.opt.<format>"),
+	llvm::cl::value_desc("filename")
+};
+
+static llvm::cl::opt<std::string> optimization_record_passes {
+	"foptimization-record-passes",
+	llvm::cl::desc("Only record remarks from passes matching the regex"),
+	llvm::cl::value_desc("regex")
+};
+
+static llvm::cl::opt<bool> remarks_summary {
+	"fremarks-summary",
+	llvm::cl::desc("Print the number of remarks per function and per pass"),
+	llvm::cl::init(false)
 };
 
 static llvm::cl::opt<bool> trace_debug {
@@ -49,12 +269,194 @@ static llvm::cl::opt<bool> trace_debug {
 	llvm::cl::init(false)
 };
 
-auto create_target_machine() -> llvm::TargetMachine*
+static llvm::cl::opt<tinyc::Driver::ParserKind> parser_kind {
+	"parser",
+	llvm::cl::desc("Parser used for the source input"),
+	llvm::cl::init(tinyc::Driver::ParserKind::bison),
+	llvm::cl::values(
+		clEnumValN(tinyc::Driver::ParserKind::bison, "bison", "Generated LALR(1) parser"),
+		clEnumValN(tinyc::Driver::ParserKind::recursive_descent, "rd",
+				   "Hand-written recursive descent parser"))
+};
+
+/// 不生成代码, 可以接受多个输入
+static llvm::cl::opt<bool> compare_parsers {
+	"compare-parsers",
+	llvm::cl::desc("Parse the inputs with both parsers, compare the ASTs and report throughput"),
+	llvm::cl::init(false)
+};
+
+/// 不需要输入文件, 只报告语法诊断
+static llvm::cl::opt<bool> lsp {
+	"lsp",
+	llvm::cl::desc("Run as a language server on stdin/stdout"),
+	llvm::cl::init(false)
+};
+
+static llvm::cl::opt<std::string> emit_ast {
+	"emit-ast",
+	llvm::cl::desc("Write the parsed AST in binary format and stop"),
+	llvm::cl::value_desc("filename")
+};
+
+/// 指定后忽略<input file>, 不经过flex和bison
+static llvm::cl::opt<std::string> load_ast {
+	"load-ast",
+	llvm::cl::desc("Load the AST written by -emit-ast instead of parsing"),
+	llvm::cl::value_desc("filename")
+};
+
+/// 与clang相同, 0表示不限制
+static llvm::cl::opt<unsigned> error_limit {
+	"ferror-limit",
+	llvm::cl::desc("Stop reporting and parsing after N errors (0 = no limit)"),
+	llvm::cl::value_desc("N"),
+	llvm::cl::init(20)
+};
+
+static llvm::cl::opt<bool> time_report {
+	"ftime-report",
+	llvm::cl::desc("Print the time spent in each compilation phase"),
+	llvm::cl::init(false)
+};
+
+/// 大于1时按函数划分模块并行生成代码, 输出多个目标文件
+static llvm::cl::opt<unsigned> codegen_threads {
+	"codegen-threads",
+	llvm::cl::desc("Split the module and run codegen on N threads"),
+	llvm::cl::value_desc("N"),
+	llvm::cl::init(1)
+};
+
+/// 解析后释放parser与flex缓冲区, 代码生成前释放语法树与源码, 降低后端阶段的峰值内存
+static llvm::cl::opt<bool> bounded_memory {
+	"bounded-memory",
+	llvm::cl::desc("Free the AST and the source before code generation"),
+	llvm::cl::init(false)
+};
+
+/// 解析与IR生成在两个线程上重叠执行, 每个函数生成后立即释放其语法树
+static llvm::cl::opt<bool> pipeline {
+	"pipeline",
+	llvm::cl::desc("Generate IR for each function while parsing the next one"),
+	llvm::cl::init(false)
+};
+
+static llvm::cl::opt<unsigned> pipeline_depth {
+	"pipeline-depth",
+	llvm::cl::desc("Maximum number of parsed functions waiting for IR generation"),
+	llvm::cl::value_desc("N"),
+	llvm::cl::init(16)
+};
+
+/// 每个函数单独输出, 结构未变的函数直接复用缓存中的结果
+static llvm::cl::opt<std::string> incremental_cache {
+	"incremental-cache",
+	llvm::cl::desc("Cache per-function outputs in <dir> and reuse unchanged ones"),
+	llvm::cl::value_desc("dir")
+};
+
+static llvm::cl::opt<bool> print_peak_rss {
+	"print-peak-rss",
+	llvm::cl::desc("Print the peak resident set size before exit"),
+	llvm::cl::init(false)
+};
+
+/// @brief 单文件编译的输入, 未指定时沿用原先的默认值
+auto get_input_file() -> std::string
+{
+	return input_files.empty() ? std::string { "tinyc.out" } : input_files.front();
+}
+
+/// @brief 由-O与-fprofile-*组成GeneralVisitor的优化选项
+auto optimize_options() -> tinyc::GeneralVisitor::OptimizeOptions
+{
+	tinyc::GeneralVisitor::OptimizeOptions options;
+	options.level = opt_level;
+	if (profile_generate.getNumOccurrences() > 0)
+	{
+		options.profile_generate = profile_generate.empty()
+			? std::string { "default_%m.profraw" } : profile_generate.getValue();
+	}
+	options.profile_use = profile_use.getValue();
+	return options;
+}
+
+/**
+ * @brief 优化visitor生成的模块并在当前进程中执行
+ * @return 入口函数的返回值, 出错时返回std::unexpected, 描述错误内容
+ */
+auto run_jit(tinyc::GeneralVisitor& visitor) -> std::expected<int, std::string>
+{
+	if (!visitor.optimize())
+		return std::unexpected { std::string { "optimization failed" } };
+	auto checked = tinyc::JitRunner::check_entry(visitor.get_module(), jit_entry.getValue());
+	if (!checked)
+		return std::unexpected { std::move(checked.error()) };
+
+	auto runner_or_error = tinyc::JitRunner::create(jit_listeners);
+	if (!runner_or_error)
+		return std::unexpected { std::move(runner_or_error.error()) };
+	auto& runner = **runner_or_error;
+
+	if (auto added = runner.add_module(visitor.get_module()); !added)
+		return std::unexpected { std::move(added.error()) };
+
+	return runner.run(jit_entry.getValue());
+}
+
+/// @brief 各阶段计时, 在llvm_shutdown时统一输出
+static constexpr const char* timer_group = "tinyc";
+static constexpr const char* timer_group_desc = "tinyc phases";
+
+/// @brief -mtriple与--targets指定的目标, 已规范化并去重, 保持指定的顺序
+auto target_triples() -> std::vector<std::string>
+{
+	std::vector<std::string> triples;
+	for (const auto* list : { &mtriple, &target_list })
+	{
+		for (const auto& name : *list)
+		{
+			if (name.empty())
+				continue;
+			auto triple = llvm::Triple::normalize(name);
+			if (std::ranges::find(triples, triple) == triples.end())
+				triples.push_back(std::move(triple));
+		}
+	}
+	return triples;
+}
+
+/**
+ * @brief 初始化LLVM的目标支持组件, 只在第一次创建TargetMachine时进行
+ * @note 分层执行在后台线程上升层, 与codegen线程可能同时调用
+ */
+void initialize_targets()
 {
+	static std::once_flag once;
+	std::call_once(once, [] {
+		llvm::InitializeAllTargets();
+		llvm::InitializeAllTargetMCs();
+		llvm::InitializeAllAsmPrinters();
+		llvm::InitializeAllAsmParsers();
+	});
+}
+
+/**
+ * @param triple_name 为空时使用第一个指定的目标, 均未指定时为主机
+ * @note -mcpu, -mattr与-march对所有目标生效
+ */
+auto create_target_machine(std::string_view triple_name = {}) -> llvm::TargetMachine*
+{
+	initialize_targets();
+	std::string triple_str { triple_name };
+	if (triple_str.empty())
+	{
+		auto triples = target_triples();
+		triple_str = triples.empty() ? llvm::sys::getDefaultTargetTriple() : triples.front();
+	}
 	//三元组包括: 架构, 供应商, 操作系统环境
-	auto triple = llvm::Triple {
-		llvm::sys::getDefaultTargetTriple()
-	};
+	auto triple = llvm::Triple { triple_str };
 
 	//初始化目标选项, 优化代码选项
 	auto target_options =
@@ -77,56 +479,717 @@ auto create_target_machine() -> llvm::TargetMachine*
 	// 创建目标机器
 	// getTriple 返回三元组字符串表示
 	// 指定目标的重定位模型：静态，动态(位置无关)
+	// 未指定-O时保持后端默认的优化级别
+	auto codegen_level = llvm::CodeGenOptLevel::Default;
+	if (opt_level.getNumOccurrences() > 0)
+	{
+		codegen_level = llvm::CodeGenOpt::getLevel(static_cast<int>(
+			std::min(opt_level.getValue(), 3u))).value_or(codegen_level);
+	}
+
 	auto tm = target->createTargetMachine(
 		triple.getTriple(), cpu_str, feature_str, target_options,
-		std::optional<llvm::Reloc::Model>{llvm::codegen::getRelocModel()});
+		std::optional<llvm::Reloc::Model>{llvm::codegen::getRelocModel()},
+		std::nullopt, codegen_level);
 
 	return tm;
 }
 
+/// @brief 进程的峰值常驻内存, 单位KiB
+auto peak_rss_kib() -> long
+{
+	rusage usage {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+	return usage.ru_maxrss;
+}
+
+/// @brief 按--emit, -emit-bc与-flto选择输出种类并写出
+auto emit_outputs(tinyc::GeneralVisitor& visitor) -> bool
+{
+	if (!emit_kinds.empty())
+		return visitor.emit(emit_kinds);
+	if (emit_bc || lto_mode == LtoMode::thin)
+	{
+		const tinyc::GeneralVisitor::EmitKind bitcode[] {
+			tinyc::GeneralVisitor::EmitKind::bitcode
+		};
+		return visitor.emit(bitcode);
+	}
+	return visitor.emit();
+}
+
+auto compile() -> int;
+auto compile_targets(const std::vector<std::string>& triples) -> int;
+auto watch_inputs() -> int;
+auto run_compare_parsers() -> int;
+auto run_interpreter() -> int;
+
 auto main(int argc, char* argv[]) -> int
 {
-	// 初始化LLVM的目标支持组件
+	// 目标支持组件在create_target_machine中按需初始化, 解释执行与-lsp不需要
 	llvm::InitLLVM X(argc, argv);
-	llvm::InitializeAllTargets();
-	llvm::InitializeAllTargetMCs();
-	llvm::InitializeAllAsmPrinters();
-	llvm::InitializeAllAsmParsers();
 
 	// 解析命令行选项
 	llvm::cl::ParseCommandLineOptions(argc, argv,
 									  "Simple LLVM CommandLine Example\n");
 	
+	if (!watch && !compare_parsers && input_files.size() > 1)
+	{
+		yq::error("multiple input files are only supported with -watch or -compare-parsers");
+		return 1;
+	}
+
+	// stdout用于协议消息
+	if (lsp)
+	{
+		tinyc::LspServer server { std::cin, llvm::outs(),
+			{ .parser = parser_kind, .error_limit = error_limit } };
+		return server.run();
+	}
+
+	// 不在启动时初始化目标与创建TargetMachine, 分层执行只在函数升层时创建
+	if (!load_bytecode.empty())
+		interpreter_kind = InterpreterKind::bytecode;
+	if ((interpret && !jit) || !emit_bytecode.empty() || !load_bytecode.empty())
+		return run_interpreter();
+
+	int ret = 0;
+	if (compare_parsers)
+		ret = run_compare_parsers();
+	else
+		ret = watch ? watch_inputs() : compile();
+	if (print_peak_rss)
+		llvm::errs() << "peak RSS: " << peak_rss_kib() << " KiB\n";
+
+	return ret;
+}
+
+auto compile() -> int
+{
+	if (auto triples = target_triples(); triples.size() > 1)
+		return compile_targets(triples);
+
 	auto tm = create_target_machine();
 	if (tm == nullptr)
 		return 1;
 
+	// 优化记录由ctx写出, 文件需要比ctx活得更久
+	std::unique_ptr<llvm::ToolOutputFile> remarks_file;
 	llvm::LLVMContext ctx;
+	tinyc::RemarkSummary* remark_summary = nullptr;
+	if (remarks_summary)
+	{
+		auto handler = std::make_unique<tinyc::RemarkSummary>();
+		remark_summary = handler.get();
+		ctx.setDiagnosticHandler(std::move(handler));
+	}
+	if (save_optimization_record.getNumOccurrences() > 0)
+	{
+		std::string format = save_optimization_record.empty()
+			? std::string { "yaml" } : save_optimization_record.getValue();
+		std::string file_name = optimization_record_file.empty()
+			? std::format("{}.opt.{}", output_file.getValue(), format)
+			: optimization_record_file.getValue();
+
+		auto file_or_error = llvm::setupLLVMOptimizationRemarks(
+			ctx, file_name, optimization_record_passes, format, false);
+		if (!file_or_error)
+		{
+			yq::error("{}", llvm::toString(file_or_error.takeError()));
+			return 1;
+		}
+		remarks_file = std::move(*file_or_error);
+		// 编译失败时也保留已经产生的记录
+		remarks_file->keep();
+	}
+
 	llvm::SourceMgr src_mgr;
+	// 诊断信息先缓冲, 析构时按位置排序一次写出
+	tinyc::DiagnosticEngine diag_engine { src_mgr };
+	diag_engine.set_error_limit(error_limit);
 	tinyc::DriverFactory driver_factory { src_mgr };
-	
+	// loader持有映射的文件, 需要与src_mgr同样长的生命周期
+	tinyc::ASTLoader ast_loader { src_mgr };
+
+	std::unique_ptr<tinyc::Driver> driver;
+	std::unique_ptr<tinyc::CompUnit> owned_ast;
+	tinyc::CompUnit* ast = nullptr;
+
+	if (pipeline && (!load_ast.empty() || !emit_ast.empty()))
+	{
+		yq::error("-pipeline cannot be combined with -load-ast or -emit-ast");
+		return 1;
+	}
+	if (profile_generate.getNumOccurrences() > 0 && !profile_use.empty())
+	{
+		yq::error("-fprofile-generate cannot be combined with -fprofile-use");
+		return 1;
+	}
+	if (interpret && pipeline)
+	{
+		yq::error("-interpret cannot be combined with -pipeline");
+		return 1;
+	}
+	if (pipeline && !incremental_cache.empty())
+	{
+		yq::error("-pipeline cannot be combined with -incremental-cache");
+		return 1;
+	}
+	// 增量编译按函数写出<output>.<i>, 不经过emit_outputs与remark统计
+	if (!incremental_cache.empty()
+		&& (!emit_kinds.empty() || emit_bc || lto_mode != LtoMode::none || remarks_summary
+			|| save_optimization_record.getNumOccurrences() > 0))
+	{
+		yq::error("-incremental-cache cannot be combined with --emit, -emit-bc, -flto, "
+				  "-fremarks-summary or -fsave-optimization-record");
+		return 1;
+	}
+
+	// 流水线模式在解析期间就需要生成IR, 因此先于前端构造
+	tinyc::GeneralVisitor visitor(ctx, emit_llvm, src_mgr, output_file, tm,
+								  tinyc::CTypeManager::get(ctx, tm->createDataLayout()));
+	visitor.set_codegen_threads(codegen_threads, [] {
+		return std::unique_ptr<llvm::TargetMachine> { create_target_machine() };
+	});
+	visitor.set_thin_lto(lto_mode == LtoMode::thin);
+	visitor.set_optimize_options(optimize_options());
+	// remark的位置来自指令上的DILocation, 由语法树节点的位置得到
+	if (line_tables_only)
+		visitor.set_debug_info(tinyc::GeneralVisitor::DebugInfoKind::line_tables_only);
+	else if (remark_summary != nullptr || remarks_file != nullptr)
+		visitor.set_debug_info(tinyc::GeneralVisitor::DebugInfoKind::location_tracking);
+
+	if (!load_ast.empty())
+	{
+		llvm::NamedRegionTimer timer { "load", "Load AST", timer_group,
+									   timer_group_desc, time_report };
+		auto ast_or_error = ast_loader.load(load_ast.getValue());
+		if (!ast_or_error)
+		{
+			yq::error("{}", ast_or_error.error());
+			return 1;
+		}
+		owned_ast = std::move(*ast_or_error);
+		ast = owned_ast.get();
+	}
+	else if (pipeline)
+	{
+		llvm::NamedRegionTimer timer { "pipeline", "Parse + IR generation (pipelined)",
+									   timer_group, timer_group_desc, time_report };
+		auto driver_or_error = driver_factory.produce_driver(get_input_file());
+		if (!driver_or_error)
+		{
+			yq::error("{}", driver_or_error.error());
+			return 1;
+		}
+		driver = std::move(*driver_or_error);
+		driver->set_trace(trace_debug);
+		driver->set_diag_engine(&diag_engine);
+		driver->set_parser_kind(parser_kind);
+
+		tinyc::BoundedQueue<std::unique_ptr<tinyc::FuncDef>> queue { pipeline_depth };
+		driver->set_func_def_sink([&queue](std::unique_ptr<tinyc::FuncDef> func_def) {
+			queue.push(std::move(func_def));
+		});
+
+		bool parse_ok = false;
+		std::jthread parser_thread { [&] {
+			parse_ok = driver->parse();
+			queue.close();
+		} };
+
+		bool irgen_ok = true;
+		std::size_t func_count = 0;
+		while (auto func_def = queue.pop())
+		{
+			// 出错后继续取出, 避免解析线程阻塞在push上
+			if (irgen_ok)
+				irgen_ok = visitor.visit(func_def->get());
+			++func_count;
+		}
+		parser_thread.join();
+
+		if (!parse_ok || !irgen_ok)
+			return 1;
+		yq::debug("pipelined {} function definitions", func_count);
+		ast = driver->get_ast_ptr();
+	}
+	else
+	{
+		llvm::NamedRegionTimer timer { "parse", "Parse", timer_group,
+									   timer_group_desc, time_report };
+		auto file = get_input_file();
+		
+		auto driver_or_error = driver_factory.produce_driver(file);
+		if (!driver_or_error)
+		{
+			yq::error("{}", driver_or_error.error());
+			return 1;
+		}
+		driver = std::move(*driver_or_error);
+
+		driver->set_trace(trace_debug);
+		driver->set_diag_engine(&diag_engine);
+		driver->set_parser_kind(parser_kind);
+		if (!driver->parse())
+			return 1;
+		ast = driver->get_ast_ptr();
+
+		// -emit-ast仍需要driver提供源码缓冲区
+		// 语法树中的位置引用driver的行首偏移表, 只释放parser
+		if (bounded_memory && emit_ast.empty())
+		{
+			owned_ast = driver->take_ast();
+			ast = owned_ast.get();
+			driver->release_parser();
+		}
+	}
+
+	if (!emit_ast.empty())
+	{
+		llvm::NamedRegionTimer timer { "emit-ast", "Emit AST", timer_group,
+									   timer_group_desc, time_report };
+		if (driver == nullptr)
+		{
+			yq::error("-emit-ast requires a source input, not -load-ast");
+			return 1;
+		}
 
-	auto file = input_file.getValue();
+		std::error_code ec;
+		llvm::raw_fd_ostream os { emit_ast.getValue(), ec, llvm::sys::fs::OF_None };
+		if (ec)
+		{
+			yq::error("Could not open file {}: {}", emit_ast.getValue(), ec.message());
+			return 1;
+		}
+		tinyc::ASTWriter writer { os };
+		writer.write(*ast, driver->get_source_buffer());
+		return 0;
+	}
 	
-	auto driver_or_error = driver_factory.produce_driver(file);
-	if (!driver_or_error)
+	if (!incremental_cache.empty())
 	{
-		yq::error("{}", driver_or_error.error());
+		llvm::NamedRegionTimer timer { "incremental", "Incremental compile",
+									   timer_group, timer_group_desc, time_report };
+		tinyc::IncrementalCompiler compiler { ctx, emit_llvm, src_mgr, output_file, tm,
+											  incremental_cache.getValue() };
+		compiler.set_optimize_options(optimize_options());
+		if (line_tables_only)
+			compiler.set_debug_info(tinyc::GeneralVisitor::DebugInfoKind::line_tables_only);
+		if (!compiler.compile(*ast))
+			return 1;
+		if (time_report)
+			llvm::errs() << "incremental: " << compiler.get_reused_count()
+						 << " reused, " << compiler.get_compiled_count()
+						 << " recompiled\n";
+		return 0;
+	}
+
+	// 流水线模式下函数已逐个生成, CompUnit中不再保留FuncDef
+	if (!pipeline)
+	{
+		llvm::NamedRegionTimer timer { "irgen", "IR generation", timer_group,
+									   timer_group_desc, time_report };
+		if (!visitor.visit(ast))
+			return 1;
+	}
+
+	if (jit)
+	{
+		// 语法树在生成代码后仍然保留, 先求值再执行JIT
+		std::optional<int> interpreted;
+		if (interpret)
+		{
+			llvm::NamedRegionTimer timer { "interpret", "AST interpretation",
+										   timer_group, timer_group_desc, time_report };
+			tinyc::Interpreter interpreter;
+			auto ret_or_error = interpreter.run(*ast, jit_entry.getValue());
+			if (!ret_or_error)
+			{
+				yq::error("{}", ret_or_error.error());
+				return 1;
+			}
+			interpreted = *ret_or_error;
+		}
+
+		llvm::NamedRegionTimer timer { "jit", "JIT execution", timer_group,
+									   timer_group_desc, time_report };
+		auto ret_or_error = run_jit(visitor);
+		if (!ret_or_error)
+		{
+			yq::error("{}", ret_or_error.error());
+			return 1;
+		}
+		if (interpreted.has_value() && *interpreted != *ret_or_error)
+		{
+			yq::error("interpreter returned {}, but the JIT returned {}",
+					  *interpreted, *ret_or_error);
+			return 1;
+		}
+		return *ret_or_error;
+	}
+
+	if (bounded_memory)
+	{
+		// 语法树中的位置指向源码缓冲区, 需要先释放语法树
+		ast = nullptr;
+		owned_ast.reset();
+		driver.reset();
+		// 重置src_mgr会移除诊断回调, 先写出已有的消息
+		diag_engine.flush();
+		src_mgr = llvm::SourceMgr {};
+		ast_loader.release_file();
+	}
+
+	{
+		llvm::NamedRegionTimer timer { "emit", "Emit", timer_group,
+									   timer_group_desc, time_report };
+		if (!emit_outputs(visitor))
+			return 1;
+	}
+
+	if (remark_summary != nullptr)
+		remark_summary->print(llvm::errs());
+
+	return 0;
+}
+
+/// @brief 见MultiTargetCompiler
+auto compile_targets(const std::vector<std::string>& triples) -> int
+{
+	if (jit || interpret || pipeline || !incremental_cache.empty() || !emit_ast.empty()
+		|| remarks_summary || save_optimization_record.getNumOccurrences() > 0)
+	{
+		yq::error("multiple targets cannot be combined with -jit, -interpret, -pipeline, "
+				  "-incremental-cache, -emit-ast or optimization remarks");
+		return 1;
+	}
+	if (profile_generate.getNumOccurrences() > 0 && !profile_use.empty())
+	{
+		yq::error("-fprofile-generate cannot be combined with -fprofile-use");
 		return 1;
 	}
-	auto driver = std::move(*driver_or_error);
 
-	driver->set_trace(trace_debug);
-	if (!driver->parse())
+	tinyc::MultiTargetCompiler::Options options;
+	options.input_file = get_input_file();
+	options.load_ast = load_ast.getValue();
+	options.parser = parser_kind;
+	options.error_limit = error_limit;
+	options.trace = trace_debug;
+	options.time_report = time_report;
+	options.output_file = output_file.getValue();
+	options.emit_llvm = emit_llvm;
+	options.codegen_threads = codegen_threads;
+	options.thin_lto = lto_mode == LtoMode::thin;
+	options.optimize = optimize_options();
+	if (line_tables_only)
+		options.debug_info = tinyc::GeneralVisitor::DebugInfoKind::line_tables_only;
+
+	tinyc::MultiTargetCompiler compiler { [](const std::string& triple) {
+		return std::unique_ptr<llvm::TargetMachine> { create_target_machine(triple) };
+	}, emit_outputs, std::move(options) };
+	return compiler.compile(triples);
+}
+
+/// @brief 命令行选项对应的单一输出种类, 与GeneralVisitor::emit()的选择一致
+auto default_output_kinds() -> std::vector<tinyc::GeneralVisitor::EmitKind>
+{
+	using EmitKind = tinyc::GeneralVisitor::EmitKind;
+	if (!emit_kinds.empty())
+		return { emit_kinds.begin(), emit_kinds.end() };
+	if (emit_bc || lto_mode == LtoMode::thin)
+		return { EmitKind::bitcode };
+	if (llvm::codegen::getFileType() == llvm::CodeGenFileType::AssemblyFile)
+		return { emit_llvm ? EmitKind::llvm_ir : EmitKind::assembly };
+	return { EmitKind::object };
+}
+
+auto watch_inputs() -> int
+{
+	if (input_files.empty())
+	{
+		yq::error("-watch requires at least one input file or directory");
 		return 1;
-	
-	tinyc::GeneralVisitor visitor(ctx, emit_llvm, src_mgr, output_file, tm);
-	bool ret = visitor.visit(driver->get_ast_ptr());
-	if (!ret)
+	}
+	if (target_triples().size() > 1)
+	{
+		yq::error("-watch supports only one target");
 		return 1;
-	if (!visitor.emit())
+	}
+	// 输出写到各源文件旁, 也不运行程序, 这些选项会被静默忽略
+	if (output_file.getNumOccurrences() > 0 || pipeline || !incremental_cache.empty()
+		|| jit || interpret)
+	{
+		yq::error("-watch cannot be combined with -o, -pipeline, -incremental-cache, "
+				  "-jit or -interpret");
 		return 1;
+	}
 
-	return 0;
+	std::unique_ptr<llvm::TargetMachine> tm { create_target_machine() };
+	if (tm == nullptr)
+		return 1;
+
+	tinyc::CompileOptions options;
+	options.output_kinds = default_output_kinds();
+	options.optimize = optimize_options();
+	options.parser = parser_kind;
+	if (line_tables_only)
+		options.debug_info = tinyc::GeneralVisitor::DebugInfoKind::line_tables_only;
+
+	tinyc::Watcher watcher { *tm, std::move(options) };
+	for (const auto& path : input_files)
+	{
+		if (auto added = watcher.add_path(path); !added)
+		{
+			yq::error("{}", added.error());
+			return 1;
+		}
+	}
+
+	return watcher.run();
+}
+
+/**
+ * @brief 用指定的parser解析file, 并将语法树序列化
+ * @return 解析失败时为空; seconds为construct与parse的耗时
+ */
+auto parse_and_serialize(const std::string& file, tinyc::Driver::ParserKind kind,
+						 double& seconds) -> std::optional<std::string>
+{
+	llvm::SourceMgr src_mgr;
+	tinyc::DiagnosticEngine diag_engine { src_mgr };
+	diag_engine.set_error_limit(error_limit);
+	tinyc::DriverFactory driver_factory { src_mgr };
+
+	auto start = std::chrono::steady_clock::now();
+	auto driver_or_error = driver_factory.produce_driver(file);
+	if (!driver_or_error)
+	{
+		yq::error("{}", driver_or_error.error());
+		return std::nullopt;
+	}
+	auto& driver = **driver_or_error;
+	driver.set_diag_engine(&diag_engine);
+	driver.set_parser_kind(kind);
+	bool parsed = driver.parse();
+	seconds = std::chrono::duration<double> { std::chrono::steady_clock::now() - start }.count();
+	if (!parsed)
+		return std::nullopt;
+
+	// 序列化结果包含每个节点的种类, 内容与位置, 相同即语法树相同
+	std::string serialized;
+	llvm::raw_string_ostream os { serialized };
+	tinyc::ASTWriter writer { os };
+	writer.write(driver.get_ast(), driver.get_source_buffer());
+	os.flush();
+	return serialized;
 }
 
+auto run_compare_parsers() -> int
+{
+	using ParserKind = tinyc::Driver::ParserKind;
+	std::size_t mismatches = 0;
+	std::uint64_t total_bytes = 0;
+	double bison_seconds = 0;
+	double rd_seconds = 0;
+
+	for (const auto& file : input_files)
+	{
+		double bison_time = 0;
+		double rd_time = 0;
+		auto bison_ast = parse_and_serialize(file, ParserKind::bison, bison_time);
+		auto rd_ast = parse_and_serialize(file, ParserKind::recursive_descent, rd_time);
+
+		if (bison_ast.has_value() != rd_ast.has_value())
+		{
+			llvm::errs() << "[mismatch] " << file << ": only the "
+						 << (bison_ast ? "bison" : "rd") << " parser accepts it\n";
+			++mismatches;
+			continue;
+		}
+		if (bison_ast && *bison_ast != *rd_ast)
+		{
+			llvm::errs() << "[mismatch] " << file << ": the ASTs differ\n";
+			++mismatches;
+			continue;
+		}
+
+		std::uint64_t file_size = 0;
+		llvm::sys::fs::file_size(file, file_size);
+		total_bytes += file_size;
+		bison_seconds += bison_time;
+		rd_seconds += rd_time;
+	}
+
+	auto throughput = [total_bytes](double seconds) {
+		return seconds > 0 ? static_cast<double>(total_bytes) / seconds / (1 << 20) : 0.0;
+	};
+	llvm::errs() << std::format(
+		"{} inputs, {} mismatches, {} bytes\n"
+		"bison: {:.3f} ms, {:.2f} MiB/s\n"
+		"rd:    {:.3f} ms, {:.2f} MiB/s\n",
+		input_files.size(), mismatches, total_bytes,
+		bison_seconds * 1e3, throughput(bison_seconds),
+		rd_seconds * 1e3, throughput(rd_seconds));
+
+	return mismatches == 0 ? 0 : 1;
+}
+
+/// @brief 按-interpreter选择的方式执行入口函数, runs次中任何一次出错即返回错误
+auto run_entry(const tinyc::CompUnit* ast, const tinyc::BytecodeModule& module,
+			   llvm::SourceMgr& src_mgr, unsigned runs) -> std::expected<int, std::string>
+{
+	std::expected<int, std::string> ret { 0 };
+	if (interpreter_kind == InterpreterKind::tiered)
+	{
+		tinyc::TieredEngine::Options options;
+		options.tier_up_threshold = tier_up_threshold;
+		options.optimize = optimize_options();
+		auto engine_or_error = tinyc::TieredEngine::create(*ast, src_mgr, [] {
+			return std::unique_ptr<llvm::TargetMachine> { create_target_machine() };
+		}, std::move(options));
+		if (!engine_or_error)
+			return std::unexpected { std::move(engine_or_error.error()) };
+		auto& engine = **engine_or_error;
+
+		for (unsigned i = 0; i < runs && ret; ++i)
+			ret = engine.call(jit_entry.getValue());
+		if (time_report)
+			engine.print_stats(llvm::errs());
+	}
+	else if (interpreter_kind == InterpreterKind::bytecode)
+	{
+		tinyc::BytecodeVM vm;
+		const auto* function = module.find_function(jit_entry.getValue());
+		if (function == nullptr)
+			return std::unexpected { std::format("entry function {} not found",
+												 jit_entry.getValue()) };
+		for (unsigned i = 0; i < runs && ret; ++i)
+			ret = vm.run(module, *function);
+	}
+	else
+	{
+		tinyc::Interpreter interpreter;
+		for (unsigned i = 0; i < runs && ret; ++i)
+			ret = interpreter.run(*ast, jit_entry.getValue());
+	}
+	return ret;
+}
+
+auto run_interpreter() -> int
+{
+	llvm::SourceMgr src_mgr;
+	tinyc::DiagnosticEngine diag_engine { src_mgr };
+	diag_engine.set_error_limit(error_limit);
+	tinyc::DriverFactory driver_factory { src_mgr };
+	tinyc::ASTLoader ast_loader { src_mgr };
+
+	std::unique_ptr<tinyc::Driver> driver;
+	std::unique_ptr<tinyc::CompUnit> owned_ast;
+	const tinyc::CompUnit* ast = nullptr;
+	tinyc::BytecodeModule module;
+
+	if (!load_bytecode.empty())
+	{
+		llvm::NamedRegionTimer timer { "load", "Load bytecode", timer_group,
+									   timer_group_desc, time_report };
+		auto file_or_error = llvm::MemoryBuffer::getFile(
+			load_bytecode.getValue(), /*IsText=*/false, /*RequiresNullTerminator=*/false);
+		if (!file_or_error)
+		{
+			yq::error("Failed to open {}: {}", load_bytecode.getValue(),
+					  file_or_error.getError().message());
+			return 1;
+		}
+		auto module_or_error = tinyc::BytecodeModule::read((*file_or_error)->getBuffer());
+		if (!module_or_error)
+		{
+			yq::error("{}: {}", load_bytecode.getValue(), module_or_error.error());
+			return 1;
+		}
+		module = std::move(*module_or_error);
+	}
+	else
+	{
+		llvm::NamedRegionTimer timer { "parse", "Parse", timer_group,
+									   timer_group_desc, time_report };
+		if (!load_ast.empty())
+		{
+			auto ast_or_error = ast_loader.load(load_ast.getValue());
+			if (!ast_or_error)
+			{
+				yq::error("{}", ast_or_error.error());
+				return 1;
+			}
+			owned_ast = std::move(*ast_or_error);
+			ast = owned_ast.get();
+		}
+		else
+		{
+			auto driver_or_error = driver_factory.produce_driver(get_input_file());
+			if (!driver_or_error)
+			{
+				yq::error("{}", driver_or_error.error());
+				return 1;
+			}
+			driver = std::move(*driver_or_error);
+			driver->set_trace(trace_debug);
+			driver->set_diag_engine(&diag_engine);
+			driver->set_parser_kind(parser_kind);
+			if (!driver->parse())
+				return 1;
+			ast = driver->get_ast_ptr();
+		}
+	}
+
+	if (ast != nullptr
+		&& (interpreter_kind == InterpreterKind::bytecode || !emit_bytecode.empty()))
+	{
+		llvm::NamedRegionTimer timer { "bytecode", "Bytecode compilation", timer_group,
+									   timer_group_desc, time_report };
+		tinyc::BytecodeCompiler compiler;
+		auto module_or_error = compiler.compile(*ast,
+			load_ast.empty() ? get_input_file() : load_ast.getValue());
+		if (!module_or_error)
+		{
+			yq::error("{}", module_or_error.error());
+			return 1;
+		}
+		module = std::move(*module_or_error);
+	}
+
+	if (!emit_bytecode.empty())
+	{
+		std::error_code ec;
+		llvm::raw_fd_ostream os { emit_bytecode.getValue(), ec, llvm::sys::fs::OF_None };
+		if (ec)
+		{
+			yq::error("Could not open file {}: {}", emit_bytecode.getValue(), ec.message());
+			return 1;
+		}
+		module.write(os);
+		return 0;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::expected<int, std::string> ret_or_error;
+	{
+		llvm::NamedRegionTimer timer { "interpret", "Interpretation", timer_group,
+									   timer_group_desc, time_report };
+		ret_or_error = run_entry(ast, module, src_mgr, std::max(interpret_runs.getValue(), 1u));
+	}
+	if (!ret_or_error)
+	{
+		yq::error("{}", ret_or_error.error());
+		return 1;
+	}
+	if (time_report && interpret_runs > 1)
+	{
+		std::chrono::duration<double, std::micro> elapsed =
+			std::chrono::steady_clock::now() - start;
+		llvm::errs() << std::format("{} runs, {:.3f} us per run\n", interpret_runs.getValue(),
+									elapsed.count() / interpret_runs);
+	}
+	return *ret_or_error;
+}
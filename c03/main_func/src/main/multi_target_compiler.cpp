@@ -0,0 +1,151 @@
+#include "multi_target_compiler.hpp"
+#include "ast_serializer.hpp"
+#include "diagnostic_engine.hpp"
+#include "driver.hpp"
+#include <easylog.hpp>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/Timer.h>
+#include <format>
+#include <ranges>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tinyc
+{
+
+namespace
+{
+
+/// @brief 与main中的计时组同名, 各阶段的耗时一起输出
+constexpr const char* timer_group = "tinyc";
+constexpr const char* timer_group_desc = "tinyc phases";
+
+/// @brief 多目标编译中的一个目标, 拥有独立的TargetMachine, context与visitor
+struct TargetJob
+{
+	std::string triple;
+	/// @brief visitor只保存string_view
+	std::string output_file;
+	std::unique_ptr<llvm::TargetMachine> tm;
+	/// @brief 晚于type_mgr与visitor析构
+	llvm::LLVMContext ctx;
+	std::shared_ptr<const CTypeManager> type_mgr;
+	std::unique_ptr<GeneralVisitor> visitor;
+	bool ok = false;
+};
+
+}	//namespace
+
+MultiTargetCompiler::MultiTargetCompiler(TargetMachineFactory tm_factory, EmitFunction emit,
+										 Options options):
+	m_tm_factory { std::move(tm_factory) },
+	m_emit { std::move(emit) },
+	m_options { std::move(options) }
+{
+}
+
+auto MultiTargetCompiler::compile(std::span<const std::string> triples) -> int
+{
+	llvm::SourceMgr src_mgr;
+	DiagnosticEngine diag_engine { src_mgr };
+	diag_engine.set_error_limit(m_options.error_limit);
+	DriverFactory driver_factory { src_mgr };
+	ASTLoader ast_loader { src_mgr };
+
+	std::unique_ptr<Driver> driver;
+	std::unique_ptr<CompUnit> owned_ast;
+	const CompUnit* ast = nullptr;
+
+	if (!m_options.load_ast.empty())
+	{
+		llvm::NamedRegionTimer timer { "load", "Load AST", timer_group,
+									   timer_group_desc, m_options.time_report };
+		auto ast_or_error = ast_loader.load(m_options.load_ast);
+		if (!ast_or_error)
+		{
+			yq::error("{}", ast_or_error.error());
+			return 1;
+		}
+		owned_ast = std::move(*ast_or_error);
+		ast = owned_ast.get();
+	}
+	else
+	{
+		llvm::NamedRegionTimer timer { "parse", "Parse", timer_group,
+									   timer_group_desc, m_options.time_report };
+		auto driver_or_error = driver_factory.produce_driver(m_options.input_file);
+		if (!driver_or_error)
+		{
+			yq::error("{}", driver_or_error.error());
+			return 1;
+		}
+		driver = std::move(*driver_or_error);
+		driver->set_trace(m_options.trace);
+		driver->set_diag_engine(&diag_engine);
+		driver->set_parser_kind(m_options.parser);
+		if (!driver->parse())
+			return 1;
+		// 各目标只读共享语法树, 不再需要parser
+		driver->release_parser();
+		ast = driver->get_ast_ptr();
+	}
+
+	// TargetMachine在当前线程上创建, 不支持的三元组在生成代码之前报告
+	std::vector<std::unique_ptr<TargetJob>> jobs;
+	for (const auto& triple : triples)
+	{
+		auto job = std::make_unique<TargetJob>();
+		job->triple = triple;
+		job->output_file = std::format("{}.{}", m_options.output_file, triple);
+		job->tm = m_tm_factory(triple);
+		if (job->tm == nullptr)
+			return 1;
+
+		job->type_mgr = CTypeManager::get(job->ctx, job->tm->createDataLayout());
+		job->visitor = std::make_unique<GeneralVisitor>(
+			job->ctx, m_options.emit_llvm, src_mgr, job->output_file, job->tm.get(),
+			job->type_mgr);
+		job->visitor->set_codegen_threads(m_options.codegen_threads,
+			[tm_factory = m_tm_factory, triple] { return tm_factory(triple); });
+		job->visitor->set_thin_lto(m_options.thin_lto);
+		job->visitor->set_optimize_options(m_options.optimize);
+		job->visitor->set_debug_info(m_options.debug_info);
+		// 诊断与目标无关, 只由第一个目标报告, 其余线程不调用SourceMgr::PrintMessage
+		job->visitor->set_report_diagnostics(jobs.empty());
+		jobs.push_back(std::move(job));
+	}
+
+	{
+		llvm::NamedRegionTimer timer { "irgen", "IR generation", timer_group,
+									   timer_group_desc, m_options.time_report };
+		if (!jobs.front()->visitor->visit(ast))
+			return 1;
+	}
+
+	{
+		llvm::NamedRegionTimer timer { "targets", "Emit (all targets)", timer_group,
+									   timer_group_desc, m_options.time_report };
+		std::vector<std::jthread> threads;
+		for (auto& job : jobs | std::views::drop(1))
+		{
+			threads.emplace_back([this, &job, ast] {
+				job->ok = job->visitor->visit(ast) && m_emit(*job->visitor);
+			});
+		}
+		jobs.front()->ok = m_emit(*jobs.front()->visitor);
+	}
+
+	int ret = 0;
+	for (const auto& job : jobs)
+	{
+		if (job->ok)
+			continue;
+		yq::error("compilation for {} failed", job->triple);
+		ret = 1;
+	}
+	return ret;
+}
+
+}	//namespace tinyc
@@ -0,0 +1,59 @@
+#include "remark_summary.hpp"
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/Function.h>
+#include <llvm/Support/Casting.h>
+
+#include <format>
+
+namespace tinyc
+{
+
+auto RemarkSummary::handleDiagnostics(const llvm::DiagnosticInfo& info) -> bool
+{
+	// DK_OptimizationFailure等警告也是DiagnosticInfoOptimizationBase, 交给默认处理输出
+	auto remark = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info);
+	if (remark == nullptr || info.getSeverity() != llvm::DS_Remark)
+		return false;
+
+	auto count = [&info](Counter& counter) {
+		switch(info.getKind())
+		{
+		case llvm::DK_OptimizationRemark:
+		case llvm::DK_MachineOptimizationRemark:
+			++counter.passed;
+			break;
+		case llvm::DK_OptimizationRemarkMissed:
+		case llvm::DK_MachineOptimizationRemarkMissed:
+			++counter.missed;
+			break;
+		default:
+			++counter.analysis;
+			break;
+		}
+	};
+
+	count(m_by_function[remark->getFunction().getName().str()]);
+	count(m_by_pass[remark->getPassName().str()]);
+	return true;
+}
+
+void RemarkSummary::print(llvm::raw_ostream& os) const
+{
+	print_table(os, "function", m_by_function);
+	print_table(os, "pass", m_by_pass);
+}
+
+void RemarkSummary::print_table(llvm::raw_ostream& os, llvm::StringRef title,
+								const std::map<std::string, Counter>& counters)
+{
+	os << std::format("{:<32} {:>8} {:>8} {:>8}\n", title.str(), "passed",
+					  "missed", "analysis");
+	for (const auto& [name, counter] : counters)
+	{
+		os << std::format("{:<32} {:>8} {:>8} {:>8}\n", name, counter.passed,
+						  counter.missed, counter.analysis);
+	}
+	os << "\n";
+}
+
+}	//namespace tinyc
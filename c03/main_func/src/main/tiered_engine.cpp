@@ -0,0 +1,226 @@
+#include "tiered_engine.hpp"
+#include "bytecode_compiler.hpp"
+#include "bytecode_vm.hpp"
+#include <easylog.hpp>
+#include <llvm/IR/LLVMContext.h>
+#include <format>
+
+namespace tinyc
+{
+
+auto TieredEngine::create(const CompUnit& comp_unit, llvm::SourceMgr& src_mgr,
+						  GeneralVisitor::TargetMachineFactory tm_factory, Options options)
+	-> std::expected<std::unique_ptr<TieredEngine>, std::string>
+{
+	// 运行时错误信息中的文件名
+	auto source_name = src_mgr.getNumBuffers() == 0 ? std::string {}
+		: src_mgr.getMemoryBuffer(src_mgr.getMainFileID())->getBufferIdentifier().str();
+	BytecodeCompiler compiler;
+	auto module_or_error = compiler.compile(comp_unit, std::move(source_name));
+	if (!module_or_error)
+		return std::unexpected { std::move(module_or_error.error()) };
+
+	// 构造函数为私有，无法使用std::make_unique
+	std::unique_ptr<TieredEngine> engine { new TieredEngine {
+		src_mgr, std::move(tm_factory), std::move(options), std::move(*module_or_error) } };
+
+	// 字节码与FuncDef按相同顺序排列
+	const auto& functions = engine->m_module.get_functions();
+	assert(functions.size() == comp_unit.get_func_defs().size());
+	for (std::size_t i = 0; i < functions.size(); ++i)
+	{
+		auto state = std::make_unique<FunctionState>();
+		state->func_def = comp_unit.get_func_defs()[i].get();
+		state->bytecode = &functions[i];
+		engine->m_index.try_emplace(functions[i].name, state.get());
+		engine->m_functions.push_back(std::move(state));
+	}
+
+	return engine;
+}
+
+TieredEngine::TieredEngine(llvm::SourceMgr& src_mgr,
+						   GeneralVisitor::TargetMachineFactory tm_factory,
+						   Options options, BytecodeModule module):
+	m_src_mgr { src_mgr },
+	m_tm_factory { std::move(tm_factory) },
+	m_options { std::move(options) },
+	m_module { std::move(module) },
+	m_functions {},
+	m_index {},
+	m_tm {},
+	m_context {},
+	m_type_mgr {},
+	m_jit {},
+	m_mutex {},
+	m_queue_cv {},
+	m_idle_cv {},
+	m_queue {},
+	m_in_progress { 0 },
+	m_compile_thread { [this](std::stop_token stop_token) { compile_loop(stop_token); } }
+{}
+
+TieredEngine::~TieredEngine()
+{
+	m_compile_thread.request_stop();
+	// jthread析构时join, 其余成员在此之后析构
+}
+
+auto TieredEngine::call(std::string_view name) -> std::expected<int, std::string>
+{
+	auto it = m_index.find(name);
+	if (it == m_index.end())
+		return std::unexpected { std::format("function {} not found", name) };
+	auto& state = *it->second;
+
+	if (auto native = state.native.load(std::memory_order_acquire); native != nullptr)
+		return native();
+
+	auto calls = state.calls.fetch_add(1, std::memory_order_relaxed) + 1;
+	if (calls == m_options.tier_up_threshold)
+	{
+		auto expected = Tier::bytecode;
+		if (state.tier.compare_exchange_strong(expected, Tier::compiling))
+		{
+			{
+				std::lock_guard lock { m_mutex };
+				m_queue.push_back(&state);
+			}
+			m_queue_cv.notify_one();
+		}
+	}
+
+	// 虚拟机的求值栈不能共享, 每个线程一个
+	thread_local BytecodeVM vm;
+	auto ret = vm.run(m_module, *state.bytecode);
+	if (!ret)
+		pin_to_bytecode(state);
+	return ret;
+}
+
+void TieredEngine::pin_to_bytecode(FunctionState& state)
+{
+	std::lock_guard lock { m_mutex };
+	if (state.tier.load(std::memory_order_relaxed) == Tier::pinned)
+		return;
+	// 阈值为1时, 第一次调用出错前可能已经完成了编译
+	state.native.store(nullptr, std::memory_order_release);
+	state.tier.store(Tier::pinned, std::memory_order_relaxed);
+	yq::debug("{} pinned to the bytecode tier", state.bytecode->name);
+}
+
+void TieredEngine::wait_for_compilation()
+{
+	std::unique_lock lock { m_mutex };
+	m_idle_cv.wait(lock, [this] { return m_queue.empty() && m_in_progress == 0; });
+}
+
+void TieredEngine::print_stats(llvm::raw_ostream& os) const
+{
+	for (const auto& state : m_functions)
+	{
+		const char* tier = "bytecode";
+		switch (state->tier.load(std::memory_order_relaxed))
+		{
+		case Tier::bytecode:
+			break;
+		case Tier::compiling:
+			tier = "compiling";
+			break;
+		case Tier::native:
+			tier = "native";
+			break;
+		case Tier::failed:
+			tier = "failed";
+			break;
+		case Tier::pinned:
+			tier = "pinned";
+			break;
+		}
+		os << std::format("{}: {} bytecode calls, {}\n", state->bytecode->name,
+						  state->calls.load(std::memory_order_relaxed), tier);
+	}
+}
+
+void TieredEngine::compile_loop(std::stop_token stop_token)
+{
+	while (true)
+	{
+		FunctionState* state = nullptr;
+		{
+			std::unique_lock lock { m_mutex };
+			if (!m_queue_cv.wait(lock, stop_token, [this] { return !m_queue.empty(); }))
+				return;
+			state = m_queue.front();
+			m_queue.pop_front();
+			++m_in_progress;
+		}
+
+		// 排队期间已出错的函数不再编译
+		if (state->tier.load(std::memory_order_relaxed) == Tier::compiling)
+		{
+			auto compiled = compile_native(*state);
+			if (!compiled)
+			{
+				yq::error("tier-up of {} failed: {}", state->bytecode->name,
+						  compiled.error());
+				std::lock_guard lock { m_mutex };
+				if (state->tier.load(std::memory_order_relaxed) == Tier::compiling)
+					state->tier.store(Tier::failed, std::memory_order_relaxed);
+			}
+		}
+
+		{
+			std::lock_guard lock { m_mutex };
+			--m_in_progress;
+		}
+		m_idle_cv.notify_all();
+	}
+}
+
+auto TieredEngine::compile_native(FunctionState& state) -> std::expected<void, std::string>
+{
+	if (m_tm == nullptr)
+	{
+		m_tm = m_tm_factory();
+		if (m_tm == nullptr)
+			return std::unexpected { std::string { "failed to create the target machine" } };
+		m_context = std::make_unique<llvm::LLVMContext>();
+		m_type_mgr = CTypeManager::get(*m_context, m_tm->createDataLayout());
+	}
+	if (m_jit == nullptr)
+	{
+		auto jit_or_error = JitRunner::create({});
+		if (!jit_or_error)
+			return std::unexpected { std::move(jit_or_error.error()) };
+		m_jit = std::move(*jit_or_error);
+	}
+
+	// 每个函数一个模块, add_module会复制到JIT自己的context
+	GeneralVisitor visitor { *m_context, false, m_src_mgr, "", m_tm.get(), m_type_mgr };
+	visitor.set_optimize_options(m_options.optimize);
+	if (!visitor.visit(state.func_def) || !visitor.optimize())
+		return std::unexpected { std::string { "code generation failed" } };
+	// 入口指针按EntryFunction调用, 签名不符的函数留在字节码层
+	if (auto checked = JitRunner::check_entry(visitor.get_module(), state.bytecode->name);
+		!checked)
+		return std::unexpected { std::move(checked.error()) };
+	if (auto added = m_jit->add_module(visitor.get_module()); !added)
+		return std::unexpected { std::move(added.error()) };
+
+	auto func_or_error = m_jit->lookup(state.bytecode->name);
+	if (!func_or_error)
+		return std::unexpected { std::move(func_or_error.error()) };
+
+	std::lock_guard lock { m_mutex };
+	// 编译期间字节码层出错时保留字节码层的行为
+	if (state.tier.load(std::memory_order_relaxed) != Tier::compiling)
+		return {};
+	state.native.store(*func_or_error, std::memory_order_release);
+	state.tier.store(Tier::native, std::memory_order_relaxed);
+	yq::debug("{} tiered up after {} bytecode calls", state.bytecode->name,
+			  state.calls.load(std::memory_order_relaxed));
+	return {};
+}
+
+}	//namespace tinyc
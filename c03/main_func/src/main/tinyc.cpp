@@ -0,0 +1,161 @@
+#include "tinyc.hpp"
+#include "driver.hpp"
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <format>
+#include <iterator>
+
+namespace tinyc
+{
+
+namespace
+{
+
+auto convert_kind(llvm::SourceMgr::DiagKind kind) -> Location::DiagKind
+{
+	switch(kind)
+	{
+	case llvm::SourceMgr::DK_Error:
+		return Location::dk_error;
+	case llvm::SourceMgr::DK_Warning:
+		return Location::dk_warning;
+	case llvm::SourceMgr::DK_Remark:
+		return Location::dk_remark;
+	case llvm::SourceMgr::DK_Note:
+		return Location::dk_note;
+	}
+	return Location::dk_error;
+}
+
+/// @brief 将DiagnosticEngine中的消息转换为Diagnostic
+auto convert_diagnostic(const llvm::SMDiagnostic& diag) -> Diagnostic
+{
+	std::string rendered;
+	llvm::raw_string_ostream os { rendered };
+	diag.print(nullptr, os, false);
+
+	return Diagnostic {
+		.kind = convert_kind(diag.getKind()),
+		.message = diag.getMessage().str(),
+		.file_name = diag.getFilename().str(),
+		.line = static_cast<unsigned>(std::max(diag.getLineNo(), 0)),
+		.column = static_cast<unsigned>(diag.getColumnNo() + 1),
+		.rendered = std::move(rendered),
+	};
+}
+
+/// @brief 非源码错误, 如代码生成失败
+auto make_diagnostic(std::string message) -> Diagnostic
+{
+	auto rendered = std::format("error: {}\n", message);
+	return Diagnostic {
+		.kind = Location::dk_error,
+		.message = std::move(message),
+		.file_name = {},
+		.line = 0,
+		.column = 0,
+		.rendered = std::move(rendered),
+	};
+}
+
+}	//namespace
+
+Compiler::Compiler(llvm::LLVMContext& context, llvm::TargetMachine& tm):
+	m_context { context },
+	m_target_machine { tm },
+	m_type_mgr { CTypeManager::get(context, tm.createDataLayout()) }
+{
+}
+
+auto Compiler::compile(std::string_view source, const CompileOptions& options)
+	-> CompileResult
+{
+	CompileResult result;
+
+	llvm::SourceMgr src_mgr;
+	DiagnosticEngine diag_engine { src_mgr };
+	diag_engine.set_error_limit(options.error_limit);
+
+	result.success = compile_source(source, options, src_mgr, diag_engine, result);
+
+	// 源码诊断按位置排在其他错误之前
+	auto source_diagnostics = diag_engine.take_diagnostics();
+	std::vector<Diagnostic> diagnostics;
+	diagnostics.reserve(source_diagnostics.size() + result.diagnostics.size());
+	for (const auto& diag : source_diagnostics)
+		diagnostics.push_back(convert_diagnostic(diag));
+	std::ranges::move(result.diagnostics, std::back_inserter(diagnostics));
+	result.diagnostics = std::move(diagnostics);
+
+	return result;
+}
+
+auto Compiler::compile_source(std::string_view source, const CompileOptions& options,
+							  llvm::SourceMgr& src_mgr,
+							  const DiagnosticEngine& diag_engine,
+							  CompileResult& result) -> bool
+{
+	DriverFactory driver_factory { src_mgr };
+	auto driver_or_error = driver_factory.produce_driver(
+		llvm::MemoryBuffer::getMemBufferCopy(source, options.buffer_name));
+	if (!driver_or_error)
+	{
+		result.diagnostics.push_back(make_diagnostic(driver_or_error.error()));
+		return false;
+	}
+	auto& driver = **driver_or_error;
+	driver.set_diag_engine(&diag_engine);
+	driver.set_parser_kind(options.parser);
+	if (!driver.parse())
+		return false;
+
+	GeneralVisitor visitor { m_context, false, src_mgr, "", &m_target_machine, m_type_mgr };
+	visitor.set_optimize_options(options.optimize);
+	visitor.set_debug_info(options.debug_info);
+	if (!visitor.visit(driver.get_ast_ptr()) || !visitor.optimize())
+	{
+		result.diagnostics.push_back(make_diagnostic("code generation failed"));
+		return false;
+	}
+
+	const auto& kinds = options.output_kinds;
+	for (std::size_t i = 0; i < kinds.size(); ++i)
+	{
+		auto& output = result.outputs.emplace_back();
+		llvm::raw_svector_ostream os { output };
+
+		// 之后还有输出或需要保留模块时, 后端只能改写模块的副本
+		bool preserve_module = options.keep_module || i + 1 < kinds.size();
+		if (!visitor.emit(kinds[i], os, preserve_module))
+		{
+			result.diagnostics.push_back(make_diagnostic("emission failed"));
+			return false;
+		}
+	}
+
+	if (options.keep_module)
+		result.module = visitor.take_module();
+	return true;
+}
+
+auto Compiler::create_jit(const llvm::Module& module, std::string_view entry,
+						  std::span<const JitRunner::Listener> listeners)
+	-> std::expected<std::unique_ptr<JitRunner>, std::string>
+{
+	if (auto checked = JitRunner::check_entry(module, entry); !checked)
+		return std::unexpected { checked.error() };
+
+	auto runner_or_error = JitRunner::create(listeners);
+	if (!runner_or_error)
+		return std::unexpected { runner_or_error.error() };
+
+	if (auto added = (*runner_or_error)->add_module(module); !added)
+		return std::unexpected { added.error() };
+
+	return std::move(*runner_or_error);
+}
+
+}	//namespace tinyc
@@ -0,0 +1,316 @@
+#include "watcher.hpp"
+#include <easylog.hpp>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <vector>
+
+namespace tinyc
+{
+
+/// @brief 目录中被视为tinyc源码的扩展名
+static constexpr llvm::StringLiteral source_extension { ".c" };
+
+Watcher::Watcher(llvm::TargetMachine& tm, CompileOptions options):
+	m_target_machine { tm },
+	m_options { std::move(options) },
+	m_inotify_fd { inotify_init1(IN_CLOEXEC) },
+	m_watched_dirs {},
+	m_files {},
+	m_whole_dirs {},
+	m_states {},
+	m_compile_count { 0 }
+{
+}
+
+Watcher::~Watcher()
+{
+	if (m_inotify_fd >= 0)
+		close(m_inotify_fd);
+}
+
+auto Watcher::add_path(std::string_view path) -> std::expected<void, std::string>
+{
+	if (m_inotify_fd < 0)
+		return std::unexpected { std::format("inotify_init1: {}", std::strerror(errno)) };
+
+	llvm::SmallString<128> real_path;
+	if (auto ec = llvm::sys::fs::real_path(path, real_path))
+		return std::unexpected { std::format("{}: {}", path, ec.message()) };
+	std::string full_path { real_path.str() };
+
+	if (llvm::sys::fs::is_directory(full_path))
+	{
+		if (auto watched = watch_directory(full_path); !watched)
+			return watched;
+		m_whole_dirs.insert(full_path);
+
+		std::error_code ec;
+		for (llvm::sys::fs::directory_iterator it { full_path, ec }, end;
+			 it != end && !ec; it.increment(ec))
+		{
+			if (llvm::sys::path::extension(it->path()) == source_extension)
+				m_states.try_emplace(it->path());
+		}
+		if (ec)
+			return std::unexpected { std::format("{}: {}", path, ec.message()) };
+		return {};
+	}
+
+	if (auto watched = watch_directory(llvm::sys::path::parent_path(full_path).str());
+		!watched)
+		return watched;
+	m_files.insert(full_path);
+	m_states.try_emplace(full_path);
+	return {};
+}
+
+auto Watcher::run() -> int
+{
+	compile_all();
+	llvm::errs() << std::format("watching {} files, press Ctrl-C to stop\n",
+								m_states.size());
+
+	while (true)
+	{
+		if (auto handled = read_events(); !handled)
+		{
+			yq::error("{}", handled.error());
+			return 1;
+		}
+	}
+}
+
+void Watcher::compile_all()
+{
+	for (const auto& [path, state] : m_states)
+		compile_file(path, true);
+}
+
+auto Watcher::read_events() -> std::expected<void, std::string>
+{
+	alignas(inotify_event) char buffer[64 * 1024];
+	while (true)
+	{
+		auto length = read(m_inotify_fd, buffer, sizeof(buffer));
+		if (length >= 0)
+		{
+			handle_events({ buffer, static_cast<std::size_t>(length) });
+			return {};
+		}
+		if (errno != EINTR)
+			return std::unexpected { std::format("inotify read: {}", std::strerror(errno)) };
+	}
+}
+
+void Watcher::handle_events(std::span<const char> events)
+{
+	// 一次保存往往产生多个事件, 同一批中每个文件只处理一次
+	std::set<std::string> changed;
+	std::set<std::string> removed;
+	bool overflowed = false;
+	for (std::size_t offset = 0; offset + sizeof(inotify_event) <= events.size(); )
+	{
+		auto event = reinterpret_cast<const inotify_event*>(events.data() + offset);
+		offset += sizeof(inotify_event) + event->len;
+
+		// 溢出事件的wd为-1
+		if (event->mask & IN_Q_OVERFLOW)
+		{
+			overflowed = true;
+			continue;
+		}
+		// 目录被删除或移走, 内核已撤销监视, wd之后可能被复用
+		if (event->mask & IN_IGNORED)
+		{
+			m_watched_dirs.erase(event->wd);
+			continue;
+		}
+
+		auto dir = m_watched_dirs.find(event->wd);
+		if (dir == m_watched_dirs.end() || event->len == 0)
+			continue;
+
+		std::string_view name { event->name };
+		if (!is_tracked(dir->second, name))
+			continue;
+
+		llvm::SmallString<128> path { dir->second };
+		llvm::sys::path::append(path, name);
+		if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+		{
+			removed.insert(path.str().str());
+			changed.erase(path.str().str());
+		}
+		else
+		{
+			changed.insert(path.str().str());
+			removed.erase(path.str().str());
+		}
+	}
+
+	if (overflowed)
+	{
+		llvm::errs() << "[overflow] inotify queue overflowed, checking all files\n";
+		rescan();
+		return;
+	}
+	for (const auto& path : removed)
+		forget_file(path);
+	for (const auto& path : changed)
+		compile_file(path, false);
+}
+
+void Watcher::rescan()
+{
+	for (const auto& dir : m_whole_dirs)
+	{
+		std::error_code ec;
+		for (llvm::sys::fs::directory_iterator it { dir, ec }, end;
+			 it != end && !ec; it.increment(ec))
+		{
+			if (llvm::sys::path::extension(it->path()) == source_extension)
+				m_states.try_emplace(it->path());
+		}
+		if (ec)
+			yq::error("{}: {}", dir, ec.message());
+	}
+
+	std::vector<std::string> paths;
+	for (const auto& [path, state] : m_states)
+		paths.push_back(path);
+	for (const auto& path : paths)
+	{
+		if (llvm::sys::fs::exists(path))
+			compile_file(path, false);
+		else
+			forget_file(path);
+	}
+}
+
+auto Watcher::watch_directory(const std::string& dir) -> std::expected<void, std::string>
+{
+	for (const auto& [wd, watched] : m_watched_dirs)
+	{
+		if (watched == dir)
+			return {};
+	}
+
+	// 只关心写完成与改名, 避免编辑器写入过程中的半成品
+	auto wd = inotify_add_watch(m_inotify_fd, dir.c_str(),
+								IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+	if (wd < 0)
+		return std::unexpected { std::format("inotify_add_watch {}: {}", dir,
+											 std::strerror(errno)) };
+	m_watched_dirs.emplace(wd, dir);
+	return {};
+}
+
+auto Watcher::is_tracked(const std::string& dir, std::string_view name) const -> bool
+{
+	if (m_whole_dirs.contains(dir) && llvm::sys::path::extension(name) == source_extension)
+		return true;
+
+	llvm::SmallString<128> path { dir };
+	llvm::sys::path::append(path, name);
+	return m_files.contains(path.str().str());
+}
+
+void Watcher::compile_file(const std::string& path, bool force)
+{
+	auto begin = std::chrono::steady_clock::now();
+
+	auto buffer_or_error = llvm::MemoryBuffer::getFile(path);
+	if (!buffer_or_error)
+	{
+		yq::error("Failed to open {}: {}", path, buffer_or_error.getError().message());
+		return;
+	}
+	auto source = (*buffer_or_error)->getBuffer();
+
+	auto& state = m_states[path];
+	auto content_hash = llvm::xxHash64(source);
+	if (!force && state.success && state.content_hash == content_hash)
+		return;
+	state.content_hash = content_hash;
+	++m_compile_count;
+
+	auto options = m_options;
+	options.buffer_name = path;
+	// LLVMContext中的类型与常量只增不减, 长时间运行时不能共用一个
+	llvm::LLVMContext context;
+	Compiler compiler { context, m_target_machine };
+	auto result = compiler.compile(
+		std::string_view { source.data(), source.size() }, options);
+	for (const auto& diagnostic : result.diagnostics)
+		llvm::errs() << diagnostic.rendered;
+
+	state.success = result.success;
+	if (result.success)
+	{
+		for (std::size_t i = 0; i < options.output_kinds.size(); ++i)
+		{
+			auto file_name = output_path(path, options.output_kinds[i]);
+			std::error_code ec;
+			llvm::raw_fd_ostream os { file_name, ec, llvm::sys::fs::OF_None };
+			if (ec)
+			{
+				yq::error("Could not open file {}: {}", file_name, ec.message());
+				state.success = false;
+				continue;
+			}
+			os.write(result.outputs[i].data(), result.outputs[i].size());
+		}
+	}
+
+	std::chrono::duration<double, std::milli> elapsed =
+		std::chrono::steady_clock::now() - begin;
+	llvm::errs() << std::format("[{}] {} in {:.1f} ms\n",
+								state.success ? "ok" : "failed",
+								path, elapsed.count());
+}
+
+void Watcher::forget_file(const std::string& path)
+{
+	if (m_states.erase(path) > 0)
+		llvm::errs() << std::format("[removed] {}\n", path);
+}
+
+auto Watcher::output_path(const std::string& path, GeneralVisitor::EmitKind kind) const
+	-> std::string
+{
+	std::string_view extension;
+	switch(kind)
+	{
+	case GeneralVisitor::EmitKind::object:
+		extension = ".o";
+		break;
+	case GeneralVisitor::EmitKind::assembly:
+		extension = ".s";
+		break;
+	case GeneralVisitor::EmitKind::llvm_ir:
+		extension = ".ll";
+		break;
+	case GeneralVisitor::EmitKind::bitcode:
+		extension = ".bc";
+		break;
+	}
+
+	llvm::SmallString<128> output { path };
+	llvm::sys::path::replace_extension(output, extension);
+	return output.str().str();
+}
+
+}	//namespace tinyc
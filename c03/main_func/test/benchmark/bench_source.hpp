@@ -0,0 +1,38 @@
+#pragma once
+
+#include "test_source.hpp"
+#include "test_target.hpp"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace tinyc::bench
+{
+
+/**
+ * @brief 生成一个main函数, 返回一棵约有node_count个叶子的随机表达式
+ * @note 只使用不会出现除零的运算符, 种子固定, 每次生成的源码相同
+ */
+inline auto make_expression_source(std::size_t node_count) -> std::string
+{
+	std::mt19937 rng { 20241019 };
+	constexpr std::string_view ops[] {
+		"+", "-", "*", "<", ">", "<=", ">=", "==", "!=", "&&", "||",
+	};
+
+	auto gen = [&](auto& self, std::size_t leaves) -> std::string {
+		if (leaves <= 1)
+		{
+			auto value = std::to_string(rng() % 100);
+			return rng() % 4 == 0 ? std::string { "-" } + value : value;
+		}
+		auto left = 1 + rng() % (leaves - 1);
+		auto op = ops[rng() % std::size(ops)];
+		return std::string { "(" } + self(self, left) + " " + std::string { op } + " "
+			+ self(self, leaves - left) + ")";
+	};
+	return "int main() { return " + gen(gen, node_count) + "; }\n";
+}
+
+}	//namespace tinyc::bench
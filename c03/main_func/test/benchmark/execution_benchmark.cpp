@@ -0,0 +1,169 @@
+#include "bench_source.hpp"
+#include "bytecode_compiler.hpp"
+#include "bytecode_vm.hpp"
+#include "interpreter.hpp"
+#include "tinyc.hpp"
+#include <benchmark/benchmark.h>
+#include <llvm/IR/LLVMContext.h>
+#include <cstdint>
+#include <expected>
+#include <map>
+#include <memory>
+#include <string>
+
+/**
+ * 同一个main函数在三个执行层上的耗时: 直接遍历语法树, 字节码虚拟机与JIT
+ * IRBuilder在生成IR时已经折叠了常量表达式, 本机代码只剩一条返回指令, \
+ * 因此JIT另外给出包含解析, 代码生成与链接的首次执行耗时
+ */
+
+namespace tinyc
+{
+namespace
+{
+
+/// @brief 每个规模只生成与解析一次
+auto get_source(std::int64_t leaves) -> const test::ParsedSource&
+{
+	static std::map<std::int64_t, std::unique_ptr<test::ParsedSource>> sources;
+	auto& source = sources[leaves];
+	if (source == nullptr)
+	{
+		source = std::make_unique<test::ParsedSource>(
+			bench::make_expression_source(static_cast<std::size_t>(leaves)));
+	}
+	return *source;
+}
+
+/// @brief 在state中记录返回值, 各执行层的结果应当相同
+void record_result(benchmark::State& state, int ret)
+{
+	state.counters["ret"] = static_cast<double>(ret);
+	state.SetItemsProcessed(state.iterations());
+}
+
+void bm_ast_interpreter(benchmark::State& state)
+{
+	const auto& source = get_source(state.range(0));
+	Interpreter interpreter;
+	int ret = 0;
+	for (auto _ : state)
+	{
+		auto ret_or_error = interpreter.run(source.ast(), "main");
+		if (!ret_or_error)
+		{
+			state.SkipWithError(ret_or_error.error().c_str());
+			return;
+		}
+		ret = *ret_or_error;
+		benchmark::DoNotOptimize(ret);
+	}
+	record_result(state, ret);
+}
+
+void bm_bytecode_vm(benchmark::State& state)
+{
+	const auto& source = get_source(state.range(0));
+	auto module_or_error = BytecodeCompiler {}.compile(source.ast(), "bench.c");
+	if (!module_or_error)
+	{
+		state.SkipWithError(module_or_error.error().c_str());
+		return;
+	}
+	const auto* function = module_or_error->find_function("main");
+	BytecodeVM vm;
+	int ret = 0;
+	for (auto _ : state)
+	{
+		auto ret_or_error = vm.run(*module_or_error, *function);
+		if (!ret_or_error)
+		{
+			state.SkipWithError(ret_or_error.error().c_str());
+			return;
+		}
+		ret = *ret_or_error;
+		benchmark::DoNotOptimize(ret);
+	}
+	record_result(state, ret);
+}
+
+/// @brief 编译source并交给JIT, 返回main的地址
+auto compile_to_native(llvm::TargetMachine& tm, const std::string& source,
+					   std::unique_ptr<JitRunner>& jit)
+	-> std::expected<JitRunner::EntryFunction, std::string>
+{
+	llvm::LLVMContext context;
+	CompileOptions options;
+	options.output_kinds.clear();
+	options.keep_module = true;
+	auto result = Compiler { context, tm }.compile(source, options);
+	if (!result.success)
+		return std::unexpected { "failed to compile the benchmark source" };
+	auto jit_or_error = Compiler::create_jit(*result.module, "main");
+	if (!jit_or_error)
+		return std::unexpected { jit_or_error.error() };
+	jit = std::move(*jit_or_error);
+	return jit->lookup("main");
+}
+
+void bm_jit_call(benchmark::State& state)
+{
+	auto tm = test::create_host_target_machine();
+	if (tm == nullptr)
+	{
+		state.SkipWithError("no native target");
+		return;
+	}
+	auto source = bench::make_expression_source(static_cast<std::size_t>(state.range(0)));
+	std::unique_ptr<JitRunner> jit;
+	auto main_or_error = compile_to_native(*tm, source, jit);
+	if (!main_or_error)
+	{
+		state.SkipWithError(main_or_error.error().c_str());
+		return;
+	}
+	int ret = 0;
+	for (auto _ : state)
+	{
+		ret = (*main_or_error)();
+		benchmark::DoNotOptimize(ret);
+	}
+	record_result(state, ret);
+}
+
+void bm_jit_compile_and_run(benchmark::State& state)
+{
+	auto tm = test::create_host_target_machine();
+	if (tm == nullptr)
+	{
+		state.SkipWithError("no native target");
+		return;
+	}
+	auto source = bench::make_expression_source(static_cast<std::size_t>(state.range(0)));
+	int ret = 0;
+	for (auto _ : state)
+	{
+		std::unique_ptr<JitRunner> jit;
+		auto main_or_error = compile_to_native(*tm, source, jit);
+		if (!main_or_error)
+		{
+			state.SkipWithError(main_or_error.error().c_str());
+			return;
+		}
+		ret = (*main_or_error)();
+		benchmark::DoNotOptimize(ret);
+	}
+	record_result(state, ret);
+}
+
+BENCHMARK(bm_ast_interpreter)->Name("execution/ast_interpreter")
+	->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(bm_bytecode_vm)->Name("execution/bytecode_vm")
+	->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(bm_jit_call)->Name("execution/jit_call")
+	->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(bm_jit_compile_and_run)->Name("execution/jit_compile_and_run")
+	->Arg(1 << 10)->Arg(1 << 14)->Unit(benchmark::kMillisecond);
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,201 @@
+#include "ast.hpp"
+#include "ast_visitor.hpp"
+#include "bench_source.hpp"
+#include "utility.hpp"
+#include <benchmark/benchmark.h>
+#include <llvm/Support/Casting.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+
+/**
+ * ASTVisitorBase的静态分派与移植前的虚函数分派的对比
+ * 三种访问者都只统计表达式中的节点数, 差别只在于如何到达子节点
+ */
+
+namespace tinyc
+{
+namespace
+{
+
+/**
+ * @tparam runtime_dispatch 为true时子节点经过dispatch中的switch, \
+ * 否则由visit_node在编译期选择
+ */
+template<bool runtime_dispatch>
+class NodeCounter: public ASTVisitorBase<NodeCounter<runtime_dispatch>, std::uint64_t>
+{
+	using Base = ASTVisitorBase<NodeCounter<runtime_dispatch>, std::uint64_t>;
+	friend Base;
+public:
+	auto count(const Expr& node) -> std::uint64_t
+	{ return child(node); }
+
+private:
+	template<typename Node>
+	auto child(const Node& node) -> std::uint64_t
+	{
+		if constexpr (runtime_dispatch)
+			return this->dispatch(node);
+		else
+			return this->visit_node(node);
+	}
+
+	auto visit_expr(const Expr& node) -> std::uint64_t
+	{ return 1 + child(node.get_low_expr()); }
+
+	auto visit_primary_expr(const PrimaryExpr& node) -> std::uint64_t
+	{
+		return 1 + node.visit([this](const auto& value) { return child(value); });
+	}
+
+	auto visit_unary_expr(const UnaryExpr& node) -> std::uint64_t
+	{
+		return 1 + node.visit(util::overloaded {
+			[this](const PrimaryExpr& primary_expr) { return child(primary_expr); },
+			[this](const UnaryOp& op, const UnaryExpr& unary_expr) {
+				return child(op) + child(unary_expr);
+			},
+		});
+	}
+
+	template<typename BinaryExpr>
+	auto visit_binary_expr(const BinaryExpr& node) -> std::uint64_t
+	{
+		using SelfExpr = typename BinaryExpr::SelfExprPtr::element_type;
+		using HigherExpr = typename BinaryExpr::HigherExprPtr::element_type;
+		using Op = typename BinaryExpr::OpPtr::element_type;
+
+		return 1 + node.visit(util::overloaded {
+			[this](const HigherExpr& higher_expr) { return child(higher_expr); },
+			[this](const SelfExpr& self_expr, const Op& op, const HigherExpr& higher_expr) {
+				return child(self_expr) + child(op) + child(higher_expr);
+			},
+		});
+	}
+
+	auto visit_operation(const Operation&) -> std::uint64_t
+	{ return 1; }
+	auto visit_default(const BaseAST&) -> std::uint64_t
+	{ return 1; }
+};
+
+/// @brief 移植前的方式: 虚函数visit(BaseAST*)中按llvm::dyn_cast逐个尝试, 子节点经accept进入
+class LegacyNodeCounter: public ASTVisitor
+{
+public:
+	auto count(const Expr& node) -> std::uint64_t
+	{
+		m_count = 0;
+		enter(node);
+		return m_count;
+	}
+
+	auto visit(BaseAST* node) -> bool override
+	{
+		++m_count;
+		if (auto* expr = llvm::dyn_cast<Expr>(node))
+			enter(expr->get_low_expr());
+		else if (auto* primary_expr = llvm::dyn_cast<PrimaryExpr>(node))
+			visit_primary_expr(*primary_expr);
+		else if (auto* unary_expr = llvm::dyn_cast<UnaryExpr>(node))
+			visit_unary_expr(*unary_expr);
+		else if (auto* l3_expr = llvm::dyn_cast<L3Expr>(node))
+			visit_binary_expr(*l3_expr);
+		else if (auto* l4_expr = llvm::dyn_cast<L4Expr>(node))
+			visit_binary_expr(*l4_expr);
+		else if (auto* l6_expr = llvm::dyn_cast<L6Expr>(node))
+			visit_binary_expr(*l6_expr);
+		else if (auto* l7_expr = llvm::dyn_cast<L7Expr>(node))
+			visit_binary_expr(*l7_expr);
+		else if (auto* land_expr = llvm::dyn_cast<LAndExpr>(node))
+			visit_binary_expr(*land_expr);
+		else if (auto* lor_expr = llvm::dyn_cast<LOrExpr>(node))
+			visit_binary_expr(*lor_expr);
+		return true;
+	}
+
+private:
+	/// @note accept不是const成员, 访问过程不修改节点
+	void enter(const BaseAST& node)
+	{ const_cast<BaseAST&>(node).accept(*this); }
+
+	void visit_primary_expr(const PrimaryExpr& node)
+	{
+		if (node.has_expr())
+			enter(node.get_expr());
+		else if (node.has_ident())
+			enter(node.get_ident());
+		else if (node.has_number())
+			enter(node.get_number());
+	}
+
+	void visit_unary_expr(const UnaryExpr& node)
+	{
+		if (node.has_unary_expr())
+		{
+			enter(node.get_unary_op());
+			enter(node.get_unary_expr());
+		}
+		else
+		{
+			enter(node.get_primary_expr());
+		}
+	}
+
+	template<typename BinaryExpr>
+	void visit_binary_expr(const BinaryExpr& node)
+	{
+		if (node.has_higher_expr())
+		{
+			enter(node.get_higher_expr());
+			return;
+		}
+		auto [self_expr, op, higher_expr] = node.get_combined_expr();
+		enter(self_expr.get());
+		enter(op.get());
+		enter(higher_expr.get());
+	}
+
+	std::uint64_t m_count = 0;
+};
+
+/// @brief 每个规模只解析一次
+auto get_expr(std::int64_t leaves) -> const Expr&
+{
+	static std::map<std::int64_t, std::unique_ptr<test::ParsedSource>> sources;
+	auto& source = sources[leaves];
+	if (source == nullptr)
+	{
+		source = std::make_unique<test::ParsedSource>(
+			bench::make_expression_source(static_cast<std::size_t>(leaves)));
+	}
+	const auto& func_def = *source->ast().get_func_defs().front();
+	return (*func_def.get_block().begin())->get_expr();
+}
+
+template<typename Counter>
+void bm_count_nodes(benchmark::State& state)
+{
+	const auto& expr = get_expr(state.range(0));
+	Counter counter;
+	std::uint64_t nodes = 0;
+	for (auto _ : state)
+	{
+		nodes = counter.count(expr);
+		benchmark::DoNotOptimize(nodes);
+	}
+	// 三种访问者的节点数应当相同
+	state.counters["nodes"] = static_cast<double>(nodes);
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(nodes));
+}
+
+BENCHMARK(bm_count_nodes<NodeCounter<false>>)->Name("visitor/crtp_visit_node")
+	->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(bm_count_nodes<NodeCounter<true>>)->Name("visitor/crtp_dispatch")
+	->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(bm_count_nodes<LegacyNodeCounter>)->Name("visitor/virtual_dyn_cast")
+	->Arg(1 << 10)->Arg(1 << 14);
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ast_serializer.hpp"
+#include "diagnostic_engine.hpp"
+#include "driver.hpp"
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tinyc::test
+{
+
+/// @brief ASTWriter的输出包含每个节点的种类, 内容与位置, 相同即语法树相同
+inline auto serialize(const CompUnit& ast, const llvm::MemoryBuffer& buffer) -> std::string
+{
+	std::string bytes;
+	llvm::raw_string_ostream os { bytes };
+	ASTWriter writer { os };
+	writer.write(ast, buffer);
+	os.flush();
+	return bytes;
+}
+
+/**
+ * @brief 解析内存中的源码, 诊断信息留在diag_engine中
+ * @note 语法树中的位置引用src_mgr与driver, 不可复制或移动
+ * @note 单元测试与benchmark共用, 不依赖gtest; 无法创建driver时error非空
+ */
+struct ParsedSource
+{
+	explicit ParsedSource(std::string_view source,
+						  Driver::ParserKind parser = Driver::ParserKind::bison,
+						  std::size_t error_limit = 0)
+	{
+		diag_engine.set_error_limit(error_limit);
+		DriverFactory driver_factory { src_mgr };
+		auto driver_or_error = driver_factory.produce_driver(
+			llvm::MemoryBuffer::getMemBufferCopy(source, "test.c"));
+		if (!driver_or_error)
+		{
+			error = std::move(driver_or_error.error());
+			return;
+		}
+		driver = std::move(*driver_or_error);
+		driver->set_diag_engine(&diag_engine);
+		driver->set_parser_kind(parser);
+		parsed = driver->parse();
+	}
+
+	ParsedSource(const ParsedSource&) = delete;
+	auto operator=(const ParsedSource&) -> ParsedSource& = delete;
+
+	auto ast() const -> const CompUnit&
+	{ return driver->get_ast(); }
+
+	/// @brief 取出目前为止的诊断信息, 已按位置排序
+	auto take_diagnostics() -> std::vector<llvm::SMDiagnostic>
+	{ return diag_engine.take_diagnostics(); }
+
+	llvm::SourceMgr src_mgr;
+	/// @note 需要早于src_mgr析构
+	DiagnosticEngine diag_engine { src_mgr };
+	std::unique_ptr<Driver> driver;
+	bool parsed = false;
+	std::string error;
+};
+
+}	//namespace tinyc::test
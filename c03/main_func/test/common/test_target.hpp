@@ -0,0 +1,37 @@
+#pragma once
+
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/TargetParser/Host.h>
+#include <memory>
+#include <string>
+
+namespace tinyc::test
+{
+
+/**
+ * @brief 为宿主机创建TargetMachine, 第一次调用时初始化本机目标
+ * @note 失败时返回nullptr
+ */
+inline auto create_host_target_machine() -> std::unique_ptr<llvm::TargetMachine>
+{
+	static const bool initialized = [] {
+		llvm::InitializeNativeTarget();
+		llvm::InitializeNativeTargetAsmPrinter();
+		return true;
+	}();
+	static_cast<void>(initialized);
+
+	auto triple = llvm::sys::getDefaultTargetTriple();
+	std::string error_str;
+	auto target = llvm::TargetRegistry::lookupTarget(triple, error_str);
+	if (target == nullptr)
+		return nullptr;
+
+	return std::unique_ptr<llvm::TargetMachine> { target->createTargetMachine(
+		triple, "", "", llvm::TargetOptions {}, {}) };
+}
+
+}	//namespace tinyc::test
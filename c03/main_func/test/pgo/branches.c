@@ -0,0 +1,3 @@
+int main() {
+	return (1 < 2) && !(3 >= 4) || 0 && (5 == 6) || -(7 - 9) * 3;
+}
@@ -0,0 +1,73 @@
+#[[
+#	-fprofile-generate, 运行, llvm-profdata merge, 再以-O2 -fprofile-use编译,
+#	与不带profile的-O2结果比较
+#	tinyc只有无参数的函数与单条表达式, 没有循环与调用, 两者的耗时只作为记录输出
+#]]
+
+function(run)
+	execute_process(COMMAND ${ARGN}
+		WORKING_DIRECTORY ${WORK_DIR}
+		RESULT_VARIABLE result
+		OUTPUT_VARIABLE output
+		ERROR_VARIABLE output
+	)
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "${ARGN} failed (${result}):\n${output}")
+	endif()
+endfunction()
+
+# 可执行文件的返回值即main的返回值
+function(run_exe exe out_var)
+	execute_process(COMMAND ${WORK_DIR}/${exe}
+		WORKING_DIRECTORY ${WORK_DIR}
+		RESULT_VARIABLE result
+	)
+	set(${out_var} ${result} PARENT_SCOPE)
+endfunction()
+
+# 连续运行count次, 返回总耗时, 单位us
+function(time_exe exe count out_var)
+	string(TIMESTAMP start "%s%f")
+	foreach (i RANGE 1 ${count})
+		execute_process(COMMAND ${WORK_DIR}/${exe} WORKING_DIRECTORY ${WORK_DIR})
+	endforeach()
+	string(TIMESTAMP end "%s%f")
+	math(EXPR elapsed "${end} - ${start}")
+	set(${out_var} ${elapsed} PARENT_SCOPE)
+endfunction()
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# 插桩, 运行后写出pgo.profraw
+run(${TINYC} ${SOURCE} -O2 -fprofile-generate=${WORK_DIR}/pgo.profraw -o gen)
+run(${CLANG} -fprofile-instr-generate gen.o -o gen)
+run_exe(gen gen_ret)
+if (NOT EXISTS ${WORK_DIR}/pgo.profraw)
+	message(FATAL_ERROR "instrumented run did not write pgo.profraw")
+endif()
+run(${LLVM_PROFDATA} merge -o pgo.profdata pgo.profraw)
+
+run(${TINYC} ${SOURCE} -O2 -o plain)
+run(${CLANG} plain.o -o plain)
+run(${TINYC} ${SOURCE} -O2 -fprofile-use=${WORK_DIR}/pgo.profdata -o pgo)
+run(${CLANG} pgo.o -o pgo)
+
+# profile被读入时函数带有入口计数
+run(${TINYC} ${SOURCE} -O2 -fprofile-use=${WORK_DIR}/pgo.profdata --emit=llvm -o pgo)
+file(READ ${WORK_DIR}/pgo.ll ir)
+if (NOT ir MATCHES "function_entry_count")
+	message(FATAL_ERROR "-fprofile-use did not attach the profile:\n${ir}")
+endif()
+
+run_exe(plain plain_ret)
+run_exe(pgo pgo_ret)
+if (NOT gen_ret EQUAL plain_ret OR NOT pgo_ret EQUAL plain_ret)
+	message(FATAL_ERROR
+		"results differ: instrumented ${gen_ret}, -O2 ${plain_ret}, -fprofile-use ${pgo_ret}")
+endif()
+
+set(runs 50)
+time_exe(plain ${runs} plain_us)
+time_exe(pgo ${runs} pgo_us)
+message(STATUS "${runs} runs: -O2 ${plain_us} us, -O2 -fprofile-use ${pgo_us} us")
@@ -0,0 +1,101 @@
+#include "ast_serializer.hpp"
+#include "test_source.hpp"
+#include <gtest/gtest.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <string_view>
+
+namespace tinyc
+{
+namespace
+{
+
+constexpr std::string_view source =
+	"int main()\n"
+	"{\n"
+	"\treturn 1 + 2 * -(3 - 4) / 5 % 6;\n"
+	"}\n"
+	"\n"
+	"void f(int a, int b) { return (1 < 2) == (3 >= 4) && !0 || a != +b; }\n";
+
+/// @brief 在每个函数定义上报告一条警告, 返回渲染后的文本
+auto report_on_func_defs(const CompUnit& ast, DiagnosticEngine& diag_engine) -> std::string
+{
+	for (const auto& func_def : ast)
+		func_def->report(Location::dk_warning, "at func def");
+
+	std::string text;
+	llvm::raw_string_ostream os { text };
+	diag_engine.flush(os);
+	return os.str();
+}
+
+TEST(ASTSerializer, RoundTripKeepsNodesAndLocations)
+{
+	test::ParsedSource parsed { source };
+	ASSERT_TRUE(parsed.parsed);
+	auto bytes = test::serialize(parsed.ast(), parsed.driver->get_source_buffer());
+
+	llvm::SmallString<128> path;
+	ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("tinyc-ast", "tcas", path));
+	llvm::FileRemover remover { path };
+	{
+		std::error_code ec;
+		llvm::raw_fd_ostream os { path, ec };
+		ASSERT_FALSE(ec) << ec.message();
+		os << bytes;
+	}
+
+	llvm::SourceMgr src_mgr;
+	DiagnosticEngine diag_engine { src_mgr };
+	ASTLoader loader { src_mgr };
+	auto ast_or_error = loader.load(path.str().str());
+	ASSERT_TRUE(ast_or_error.has_value()) << ast_or_error.error();
+	const auto& loaded = **ast_or_error;
+
+	// 源码随文件保存, 再次写出时字节完全相同
+	ASSERT_EQ(src_mgr.getNumBuffers(), 1u);
+	EXPECT_EQ(test::serialize(loaded, *src_mgr.getMemoryBuffer(1)), bytes);
+
+	ASSERT_EQ(loaded.get_func_defs().size(), parsed.ast().get_func_defs().size());
+	for (std::size_t i = 0; i < loaded.get_func_defs().size(); ++i)
+	{
+		const auto& expect = *parsed.ast().get_func_defs()[i];
+		const auto& actual = *loaded.get_func_defs()[i];
+		EXPECT_EQ(actual.get_ident().get_value(), expect.get_ident().get_value());
+		EXPECT_EQ(actual.get_location().get_line_and_column(),
+				  expect.get_location().get_line_and_column());
+	}
+
+	// 载入的语法树报告的诊断与原始语法树的位置, 源码行与范围相同
+	auto expect = report_on_func_defs(parsed.ast(), parsed.diag_engine);
+	auto actual = report_on_func_defs(loaded, diag_engine);
+	EXPECT_NE(expect.find("test.c:6:1: warning: at func def"), std::string::npos) << expect;
+	EXPECT_EQ(actual, expect);
+}
+
+TEST(ASTSerializer, RejectsTruncatedFile)
+{
+	test::ParsedSource parsed { source };
+	ASSERT_TRUE(parsed.parsed);
+	auto bytes = test::serialize(parsed.ast(), parsed.driver->get_source_buffer());
+
+	llvm::SmallString<128> path;
+	ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("tinyc-ast", "tcas", path));
+	llvm::FileRemover remover { path };
+	{
+		std::error_code ec;
+		llvm::raw_fd_ostream os { path, ec };
+		ASSERT_FALSE(ec) << ec.message();
+		os << std::string_view { bytes }.substr(0, bytes.size() / 2);
+	}
+
+	llvm::SourceMgr src_mgr;
+	ASTLoader loader { src_mgr };
+	EXPECT_FALSE(loader.load(path.str().str()).has_value());
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,149 @@
+#include "bytecode.hpp"
+#include "bytecode_compiler.hpp"
+#include "bytecode_vm.hpp"
+#include "test_source.hpp"
+#include <gtest/gtest.h>
+#include <llvm/Support/raw_ostream.h>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace tinyc
+{
+namespace
+{
+
+constexpr std::string_view source =
+	"int main() { return 1 + 2 * (3 - 4) / 5 % 6; }\n"
+	"int logic() { return (1 < 2) && !(3 >= 4) || 0; }\n"
+	"int deep() { return 1 + (2 + (3 + (4 + (5 + 6)))); }\n";
+
+class BytecodeTest: public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		ASSERT_TRUE(parsed.parsed);
+		BytecodeCompiler compiler;
+		auto module_or_error = compiler.compile(parsed.ast(), "test.c");
+		ASSERT_TRUE(module_or_error) << module_or_error.error();
+		module = std::move(*module_or_error);
+	}
+
+	auto serialize(const BytecodeModule& bytecode) const -> std::string
+	{
+		std::string bytes;
+		llvm::raw_string_ostream os { bytes };
+		bytecode.write(os);
+		return os.str();
+	}
+
+	/// @brief 修改第index个函数后写出再载入
+	auto read_modified(std::size_t index,
+					   const std::function<void(BytecodeFunction&)>& modify) const
+		-> std::expected<BytecodeModule, std::string>
+	{
+		BytecodeModule modified { module.get_source_name() };
+		for (std::size_t i = 0; i < module.get_functions().size(); ++i)
+		{
+			auto function = module.get_functions()[i];
+			if (i == index)
+				modify(function);
+			modified.add_function(std::move(function));
+		}
+		return BytecodeModule::read(serialize(modified));
+	}
+
+	test::ParsedSource parsed { source };
+	BytecodeModule module;
+};
+
+TEST_F(BytecodeTest, CompiledFunctionsVerifyAndRoundTrip)
+{
+	ASSERT_EQ(module.get_functions().size(), 3u);
+	for (const auto& function : module.get_functions())
+		EXPECT_TRUE(BytecodeModule::verify(function)) << function.name;
+	// 右结合的嵌套加法需要同时保留所有左操作数
+	EXPECT_EQ(module.find_function("deep")->max_stack, 6u);
+
+	auto bytes = serialize(module);
+	auto loaded = BytecodeModule::read(bytes);
+	ASSERT_TRUE(loaded) << loaded.error();
+	EXPECT_EQ(serialize(*loaded), bytes);
+
+	BytecodeVM vm;
+	auto ret = vm.run(*loaded, "deep");
+	ASSERT_TRUE(ret) << ret.error();
+	EXPECT_EQ(*ret, 21);
+}
+
+TEST_F(BytecodeTest, RejectsMismatchedMaxStack)
+{
+	for (std::uint32_t max_stack : { 5u, 7u, std::numeric_limits<std::uint32_t>::max() })
+	{
+		auto loaded = read_modified(2, [max_stack](BytecodeFunction& function) {
+			function.max_stack = max_stack;
+		});
+		EXPECT_FALSE(loaded) << "max_stack " << max_stack;
+	}
+	auto loaded = read_modified(2, [](BytecodeFunction& function) {
+		function.max_stack = 0x7fff'ffff;
+	});
+	ASSERT_FALSE(loaded);
+	EXPECT_NE(loaded.error().find("does not match"), std::string::npos) << loaded.error();
+}
+
+TEST_F(BytecodeTest, RejectsMalformedCode)
+{
+	// 非法操作码
+	EXPECT_FALSE(read_modified(0, [](BytecodeFunction& function) {
+		function.code.front() = 0xff;
+	}));
+	// 最后一条指令不是ret
+	EXPECT_FALSE(read_modified(0, [](BytecodeFunction& function) {
+		function.code.pop_back();
+	}));
+	// 截断的立即数
+	EXPECT_FALSE(read_modified(0, [](BytecodeFunction& function) {
+		function.code.resize(3);
+	}));
+	// 缺少操作数
+	EXPECT_FALSE(read_modified(0, [](BytecodeFunction& function) {
+		function.code = { static_cast<std::uint8_t>(Opcode::add),
+						  static_cast<std::uint8_t>(Opcode::ret) };
+	}));
+	// 向后跳转
+	EXPECT_FALSE(read_modified(0, [](BytecodeFunction& function) {
+		function.max_stack = 1;
+		function.code = { static_cast<std::uint8_t>(Opcode::push), 0, 0, 0, 0,
+						  static_cast<std::uint8_t>(Opcode::jump_if_zero_or_pop), 0, 0, 0, 0,
+						  static_cast<std::uint8_t>(Opcode::ret) };
+	}));
+	// 跳转到下一条push的立即数中间
+	auto loaded = read_modified(0, [](BytecodeFunction& function) {
+		function.max_stack = 1;
+		function.code = { static_cast<std::uint8_t>(Opcode::push), 0, 0, 0, 0,
+						  static_cast<std::uint8_t>(Opcode::jump_if_zero_or_pop), 11, 0, 0, 0,
+						  static_cast<std::uint8_t>(Opcode::push), 0, 0, 0, 0,
+						  static_cast<std::uint8_t>(Opcode::ret) };
+	});
+	ASSERT_FALSE(loaded);
+	EXPECT_NE(loaded.error().find("not an instruction"), std::string::npos) << loaded.error();
+}
+
+TEST_F(BytecodeTest, RejectsMalformedFile)
+{
+	auto bytes = serialize(module);
+	EXPECT_FALSE(BytecodeModule::read("XXXX"));
+	EXPECT_FALSE(BytecodeModule::read(std::string_view { bytes }.substr(0, bytes.size() - 1)));
+	EXPECT_FALSE(BytecodeModule::read(bytes + "x"));
+
+	auto wrong_version = bytes;
+	wrong_version[sizeof(BytecodeFormat::magic)] =
+		static_cast<char>(BytecodeFormat::version + 1);
+	EXPECT_FALSE(BytecodeModule::read(wrong_version));
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,59 @@
+#include "c_type_manager.hpp"
+#include <gtest/gtest.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/LLVMContext.h>
+
+namespace tinyc
+{
+namespace
+{
+
+const llvm::DataLayout layout_64 { "e-m:e-p:64:64-i64:64-n8:16:32:64-S128" };
+const llvm::DataLayout layout_32 { "e-m:e-p:32:32-i64:64-n8:16:32-S128" };
+
+TEST(CTypeManager, SharesInstanceWhileHeld)
+{
+	llvm::LLVMContext context;
+	auto first = CTypeManager::get(context, layout_64);
+	auto second = CTypeManager::get(context, layout_64);
+	EXPECT_EQ(first, second);
+	EXPECT_EQ(&first->get_context(), &context);
+	EXPECT_EQ(first->get_data_layout(), layout_64);
+}
+
+TEST(CTypeManager, SeparatesContextsAndDataLayouts)
+{
+	llvm::LLVMContext context;
+	llvm::LLVMContext other_context;
+	auto type_mgr = CTypeManager::get(context, layout_64);
+	auto other_layout = CTypeManager::get(context, layout_32);
+	auto other_context_mgr = CTypeManager::get(other_context, layout_64);
+
+	EXPECT_NE(type_mgr, other_layout);
+	EXPECT_NE(type_mgr, other_context_mgr);
+	EXPECT_EQ(&other_context_mgr->get_context(), &other_context);
+	EXPECT_EQ(&other_context_mgr->get_signed_int()->getContext(), &other_context);
+}
+
+TEST(CTypeManager, MapsTypesByDataLayout)
+{
+	llvm::LLVMContext context;
+	auto type_mgr = CTypeManager::get(context, layout_64);
+	auto type_mgr_32 = CTypeManager::get(context, layout_32);
+
+	EXPECT_TRUE(type_mgr->get_void()->isVoidTy());
+	EXPECT_TRUE(type_mgr->get_bool()->isIntegerTy(8));
+	EXPECT_TRUE(type_mgr->get_signed_short()->isIntegerTy(16));
+	EXPECT_TRUE(type_mgr->get_unsigned_int()->isIntegerTy(32));
+	EXPECT_TRUE(type_mgr->get_signed_long_long()->isIntegerTy(64));
+	EXPECT_TRUE(type_mgr->get_float()->isFloatTy());
+	EXPECT_TRUE(type_mgr->get_double()->isDoubleTy());
+	// long的位宽跟随指针
+	EXPECT_TRUE(type_mgr->get_signed_long()->isIntegerTy(64));
+	EXPECT_TRUE(type_mgr_32->get_unsigned_long()->isIntegerTy(32));
+	// 同一context中的类型是唯一的
+	EXPECT_EQ(type_mgr->get_signed_int(), type_mgr_32->get_signed_int());
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,16 @@
+int zero() { return 0; }
+
+void nothing() { return 0; }
+
+unsigned add(int a, int b)
+{
+	return a + b;
+}
+
+signed mixed(unsigned a, signed b, int c)
+{
+	return (a + b) * c;
+	return a;
+}
+
+unsigned u() { return 65535; }
@@ -0,0 +1,12 @@
+int
+main
+(
+)
+{
+	return
+		(((1)))
+		+ 2
+		;
+}
+int compact(){return 1+2*3;}int next(int a,int b){return a*b;}
+	int tabs	(	int	x	)	{	return	x	;	}
@@ -0,0 +1,20 @@
+// 每一级运算符与结合性
+int main()
+{
+	return 1 + 2 * 3 - 4 / 2 % 3;
+}
+
+int compare()
+{
+	return 1 < 2 == 3 >= 4 != 5 > 6 <= 7;
+}
+
+int logic()
+{
+	return 1 && 0 || !0 && 2 || 3;
+}
+
+int left_assoc()
+{
+	return 10 - 3 - 2 + 8 / 4 / 2;
+}
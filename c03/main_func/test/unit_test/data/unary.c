@@ -0,0 +1,10 @@
+/* 一元运算符可以连续出现 */
+int main()
+{
+	return - - 1 + !!2 - +-+3 * -(4);
+}
+
+int nested()
+{
+	return !(1 < -2) && -(-(-(5)));
+}
@@ -0,0 +1,125 @@
+#include "diagnostic_engine.hpp"
+#include "line_index.hpp"
+#include "llvm_location.hpp"
+#include <gtest/gtest.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <format>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tinyc
+{
+namespace
+{
+
+/// @brief 每行一个字符, 第i行的位置即缓冲区偏移2*i
+struct LineSource
+{
+	explicit LineSource(std::size_t lines)
+	{
+		std::string text;
+		for (std::size_t i = 0; i < lines; ++i)
+			text += "x\n";
+		auto id = src_mgr.AddNewSourceBuffer(
+			llvm::MemoryBuffer::getMemBufferCopy(text, "lines.c"), llvm::SMLoc {});
+		buffer = src_mgr.getMemoryBuffer(id)->getBuffer();
+		line_index = LineIndex { buffer };
+	}
+
+	/// @param line 从0开始
+	void report(std::size_t line, Location::DiagKind kind, std::string_view msg) const
+	{
+		LLVMLocation location;
+		location.set_begin(buffer.data() + 2 * line);
+		location.set_end(buffer.data() + 2 * line + 1);
+		location.set_src_mgr(&src_mgr);
+		location.set_line_index(&line_index);
+		location.report(kind, msg);
+	}
+
+	llvm::SourceMgr src_mgr;
+	llvm::StringRef buffer;
+	LineIndex line_index;
+};
+
+TEST(DiagnosticEngine, SortsByLocation)
+{
+	LineSource source { 8 };
+	DiagnosticEngine diag_engine { source.src_mgr };
+	for (std::size_t line : { 5u, 1u, 7u, 0u, 3u })
+		source.report(line, Location::dk_error, std::format("line {}", line + 1));
+	// 同一位置保持报告顺序
+	source.report(3, Location::dk_note, "note after line 4");
+
+	auto diagnostics = diag_engine.take_diagnostics();
+	std::vector<std::string> messages;
+	for (const auto& diag : diagnostics)
+		messages.push_back(diag.getMessage().str());
+	EXPECT_EQ(messages, (std::vector<std::string> {
+		"line 1", "line 2", "line 4", "note after line 4", "line 6", "line 8" }));
+	EXPECT_TRUE(diag_engine.take_diagnostics().empty());
+}
+
+TEST(DiagnosticEngine, SortsReportsFromSeveralThreads)
+{
+	constexpr std::size_t thread_count = 4;
+	constexpr std::size_t lines_per_thread = 50;
+	LineSource source { thread_count * lines_per_thread };
+	DiagnosticEngine diag_engine { source.src_mgr };
+	{
+		std::vector<std::jthread> threads;
+		// 线程i报告第i, i+4, i+8...行, 交错到达
+		for (std::size_t i = 0; i < thread_count; ++i)
+		{
+			threads.emplace_back([&, i] {
+				for (std::size_t j = 0; j < lines_per_thread; ++j)
+				{
+					auto line = j * thread_count + i;
+					source.report(line, Location::dk_warning, std::format("{}", line + 1));
+				}
+			});
+		}
+	}
+
+	EXPECT_EQ(diag_engine.get_count(llvm::SourceMgr::DK_Warning),
+			  thread_count * lines_per_thread);
+	auto diagnostics = diag_engine.take_diagnostics();
+	ASSERT_EQ(diagnostics.size(), thread_count * lines_per_thread);
+	for (std::size_t i = 0; i < diagnostics.size(); ++i)
+	{
+		EXPECT_EQ(diagnostics[i].getLineNo(), static_cast<int>(i + 1));
+		EXPECT_EQ(diagnostics[i].getMessage(), std::format("{}", i + 1));
+	}
+}
+
+TEST(DiagnosticEngine, StopsAtErrorLimit)
+{
+	LineSource source { 8 };
+	DiagnosticEngine diag_engine { source.src_mgr };
+	diag_engine.set_error_limit(2);
+
+	source.report(0, Location::dk_warning, "warning before the limit");
+	source.report(1, Location::dk_error, "first");
+	EXPECT_FALSE(diag_engine.error_limit_reached());
+	source.report(2, Location::dk_error, "second");
+	EXPECT_TRUE(diag_engine.error_limit_reached());
+	source.report(3, Location::dk_error, "third");
+	source.report(4, Location::dk_warning, "warning after the limit");
+
+	// 计数包括被丢弃的消息
+	EXPECT_EQ(diag_engine.get_count(llvm::SourceMgr::DK_Error), 3u);
+	EXPECT_EQ(diag_engine.get_count(llvm::SourceMgr::DK_Warning), 2u);
+
+	auto diagnostics = diag_engine.take_diagnostics();
+	ASSERT_EQ(diagnostics.size(), 4u);
+	EXPECT_EQ(diagnostics[0].getMessage(), "warning before the limit");
+	EXPECT_EQ(diagnostics[1].getMessage(), "first");
+	EXPECT_EQ(diagnostics[2].getMessage(), "second");
+	EXPECT_EQ(diagnostics[3].getMessage(),
+			  "too many errors emitted, stopping now (2 suppressed) [-ferror-limit=2]");
+}
+
+}	//namespace
+}	//namespace tinyc
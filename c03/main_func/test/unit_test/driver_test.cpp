@@ -0,0 +1,80 @@
+#include "test_source.hpp"
+#include <gtest/gtest.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <format>
+#include <latch>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tinyc
+{
+namespace
+{
+
+TEST(Driver, UnparsedDriverReleasesLexer)
+{
+	llvm::SourceMgr src_mgr;
+	DriverFactory driver_factory { src_mgr };
+	{
+		auto driver_or_error = driver_factory.produce_driver(
+			llvm::MemoryBuffer::getMemBufferCopy("int f() { return 1; }", "unused.c"));
+		ASSERT_TRUE(driver_or_error);
+	}
+	// 上一个driver没有parse, 析构时销毁自己的扫描器
+	test::ParsedSource source { "int main() { return 2; }" };
+	EXPECT_TRUE(source.parsed);
+}
+
+TEST(Driver, ParsesFromSeveralThreadsConcurrently)
+{
+	constexpr int thread_count = 4;
+	auto make_source = [](int i) {
+		std::string source;
+		for (int j = 0; j < 200; ++j)
+			source += std::format("int f{}() {{ return {} * ({} + {}) || !{}; }}\n",
+								  j, i, j, i, j);
+		return source;
+	};
+
+	// 每个线程先construct两个driver, 所有线程都构造完成后才开始解析
+	std::latch constructed { thread_count };
+	std::vector<std::string> results(thread_count * 2);
+	{
+		std::vector<std::jthread> threads;
+		for (int i = 0; i < thread_count; ++i)
+		{
+			threads.emplace_back([&, i] {
+				llvm::SourceMgr src_mgr;
+				DriverFactory driver_factory { src_mgr };
+				auto first = driver_factory.produce_driver(
+					llvm::MemoryBuffer::getMemBufferCopy(make_source(i), "test.c"));
+				auto second = driver_factory.produce_driver(llvm::MemoryBuffer::getMemBufferCopy(
+					make_source(i + thread_count), "test.c"));
+				constructed.arrive_and_wait();
+				if (!first || !second)
+					return;
+
+				// 交替解析同一线程上的两个driver也互不影响
+				if ((*second)->parse())
+					results[i + thread_count] =
+						test::serialize((*second)->get_ast(), (*second)->get_source_buffer());
+				if ((*first)->parse())
+					results[i] =
+						test::serialize((*first)->get_ast(), (*first)->get_source_buffer());
+			});
+		}
+	}
+
+	for (int i = 0; i < thread_count * 2; ++i)
+	{
+		test::ParsedSource expected { make_source(i) };
+		ASSERT_TRUE(expected.parsed);
+		auto serialized = test::serialize(expected.ast(), expected.driver->get_source_buffer());
+		EXPECT_EQ(results[i], serialized) << "source " << i;
+	}
+}
+
+}	//namespace
+}	//namespace tinyc
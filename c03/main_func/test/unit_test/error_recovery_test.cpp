@@ -0,0 +1,69 @@
+#include "test_source.hpp"
+#include <gtest/gtest.h>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tinyc
+{
+namespace
+{
+
+/// @brief 语句, 参数与括号中各有错误, 之后的函数仍然完整
+constexpr std::string_view source =
+	"int a() {\n"
+	"\treturn 1 +;\n"
+	"\treturn 2;\n"
+	"}\n"
+	"int b(int x, 3, int y) {\n"
+	"\treturn 3;\n"
+	"}\n"
+	"int c() {\n"
+	"\treturn 4 * * 5;\n"
+	"\treturn (6;\n"
+	"}\n"
+	"int d() { return 7; }\n";
+
+class ErrorRecovery: public testing::TestWithParam<Driver::ParserKind>
+{};
+
+TEST_P(ErrorRecovery, ReportsEveryError)
+{
+	test::ParsedSource parsed { source, GetParam() };
+	EXPECT_FALSE(parsed.parsed);
+	EXPECT_EQ(parsed.driver->get_syntax_error_count(), 4u);
+
+	std::vector<std::pair<int, int>> positions;
+	for (const auto& diag : parsed.take_diagnostics())
+	{
+		EXPECT_EQ(diag.getKind(), llvm::SourceMgr::DK_Error);
+		positions.emplace_back(diag.getLineNo(), diag.getColumnNo() + 1);
+	}
+	EXPECT_EQ(positions, (std::vector<std::pair<int, int>> {
+		{ 2, 12 }, { 5, 14 }, { 9, 13 }, { 10, 11 } }));
+
+	// 恢复后所有函数都留在语法树中, 出错的语句被丢弃
+	const auto& func_defs = parsed.ast().get_func_defs();
+	ASSERT_EQ(func_defs.size(), 4u);
+	EXPECT_EQ(func_defs[0]->get_block().get_exprs().size(), 1u);
+	EXPECT_EQ(func_defs[3]->get_ident().get_value(), "d");
+}
+
+TEST_P(ErrorRecovery, StopsAtErrorLimit)
+{
+	test::ParsedSource parsed { source, GetParam(), 2 };
+	EXPECT_FALSE(parsed.parsed);
+
+	// 达到限制后词法分析器直接返回文件结束, 之后的错误不会再被报告
+	auto diagnostics = parsed.take_diagnostics();
+	ASSERT_EQ(diagnostics.size(), 2u);
+	EXPECT_EQ(diagnostics[0].getLineNo(), 2);
+	EXPECT_EQ(diagnostics[1].getLineNo(), 5);
+	EXPECT_EQ(parsed.diag_engine.get_count(llvm::SourceMgr::DK_Error), 2u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Parsers, ErrorRecovery,
+	testing::Values(Driver::ParserKind::bison, Driver::ParserKind::recursive_descent));
+
+}	//namespace
+}	//namespace tinyc
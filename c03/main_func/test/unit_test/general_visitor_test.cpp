@@ -0,0 +1,56 @@
+#include "general_visitor.hpp"
+#include "test_source.hpp"
+#include "test_target.hpp"
+#include <gtest/gtest.h>
+#include <llvm/IR/LLVMContext.h>
+
+namespace tinyc
+{
+namespace
+{
+
+TEST(GeneralVisitor, RejectsRedefinedFunction)
+{
+	test::ParsedSource source {
+		"int f() { return 1; }\n"
+		"int f() { return 2; }\n"
+	};
+	ASSERT_TRUE(source.parsed);
+	auto tm = test::create_host_target_machine();
+	ASSERT_NE(tm, nullptr);
+
+	llvm::LLVMContext context;
+	GeneralVisitor visitor { context, true, source.src_mgr, "", tm.get(),
+							 CTypeManager::get(context, tm->createDataLayout()) };
+	EXPECT_FALSE(visitor.visit(&source.ast()));
+
+	auto diagnostics = source.take_diagnostics();
+	ASSERT_EQ(diagnostics.size(), 1u);
+	EXPECT_EQ(diagnostics[0].getKind(), llvm::SourceMgr::DK_Error);
+	EXPECT_EQ(diagnostics[0].getLineNo(), 2);
+	EXPECT_EQ(diagnostics[0].getMessage(), "redefinition of function f");
+	// 第二个定义不会以f.1的名字进入模块
+	EXPECT_EQ(visitor.get_module().size(), 1u);
+}
+
+TEST(GeneralVisitor, SilencedVisitorStillFails)
+{
+	test::ParsedSource source {
+		"int f() { return 1; return 2; }\n"
+		"int f() { return 3; }\n"
+	};
+	ASSERT_TRUE(source.parsed);
+	auto tm = test::create_host_target_machine();
+	ASSERT_NE(tm, nullptr);
+
+	llvm::LLVMContext context;
+	GeneralVisitor visitor { context, true, source.src_mgr, "", tm.get(),
+							 CTypeManager::get(context, tm->createDataLayout()) };
+	visitor.set_report_diagnostics(false);
+	EXPECT_FALSE(visitor.visit(&source.ast()));
+	// 不可达代码的警告与重定义错误都不报告
+	EXPECT_TRUE(source.take_diagnostics().empty());
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,154 @@
+#include "incremental_compiler.hpp"
+#include "test_source.hpp"
+#include "test_target.hpp"
+#include <gtest/gtest.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/CodeGen/CommandFlags.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <string>
+
+namespace tinyc
+{
+namespace
+{
+
+/// @brief IncrementalCompiler通过llvm::codegen读取输出格式
+const llvm::codegen::RegisterCodeGenFlags codegen_flags;
+
+TEST(IncrementalCompiler, RemovesOutputsOfDeletedFunctions)
+{
+	llvm::SmallString<128> dir;
+	ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("tinyc-incremental", dir));
+	llvm::SmallString<128> cache_dir { dir };
+	llvm::sys::path::append(cache_dir, "cache");
+	llvm::SmallString<128> output { dir };
+	llvm::sys::path::append(output, "out");
+	std::string output_file { output.str() };
+
+	auto tm = test::create_host_target_machine();
+	ASSERT_NE(tm, nullptr);
+	auto extension = GeneralVisitor::get_output_extension(llvm::codegen::getFileType());
+	auto output_path = [&](std::size_t index) {
+		return std::format("{}.{}{}", output_file, index, extension);
+	};
+
+	llvm::LLVMContext context;
+	{
+		test::ParsedSource source {
+			"int f() { return 1; }\n"
+			"int g() { return 2; }\n"
+			"int h() { return 3; }\n"
+		};
+		ASSERT_TRUE(source.parsed);
+		IncrementalCompiler compiler { context, false, source.src_mgr, output_file,
+									   tm.get(), cache_dir.str() };
+		ASSERT_TRUE(compiler.compile(source.ast()));
+		EXPECT_EQ(compiler.get_compiled_count(), 3u);
+		EXPECT_TRUE(llvm::sys::fs::exists(output_path(2)));
+	}
+	{
+		test::ParsedSource source { "int f() { return 1; }\n" };
+		ASSERT_TRUE(source.parsed);
+		IncrementalCompiler compiler { context, false, source.src_mgr, output_file,
+									   tm.get(), cache_dir.str() };
+		ASSERT_TRUE(compiler.compile(source.ast()));
+		EXPECT_EQ(compiler.get_reused_count(), 1u);
+		EXPECT_TRUE(llvm::sys::fs::exists(output_path(0)));
+		EXPECT_FALSE(llvm::sys::fs::exists(output_path(1)));
+		EXPECT_FALSE(llvm::sys::fs::exists(output_path(2)));
+	}
+
+	EXPECT_FALSE(llvm::sys::fs::remove_directories(dir));
+}
+
+TEST(IncrementalCompiler, RejectsRedefinition)
+{
+	llvm::SmallString<128> dir;
+	ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("tinyc-incremental", dir));
+	llvm::SmallString<128> cache_dir { dir };
+	llvm::sys::path::append(cache_dir, "cache");
+	llvm::SmallString<128> output { dir };
+	llvm::sys::path::append(output, "out");
+	std::string output_file { output.str() };
+
+	auto tm = test::create_host_target_machine();
+	ASSERT_NE(tm, nullptr);
+
+	// 相同的函数体有相同的缓存键, 也必须报告
+	test::ParsedSource source {
+		"int f() { return 1; }\n"
+		"int f() { return 1; }\n"
+	};
+	ASSERT_TRUE(source.parsed);
+	llvm::LLVMContext context;
+	IncrementalCompiler compiler { context, false, source.src_mgr, output_file,
+								   tm.get(), cache_dir.str() };
+	EXPECT_FALSE(compiler.compile(source.ast()));
+	EXPECT_EQ(compiler.get_compiled_count(), 0u);
+
+	auto diagnostics = source.take_diagnostics();
+	ASSERT_EQ(diagnostics.size(), 1u);
+	EXPECT_EQ(diagnostics[0].getLineNo(), 2);
+	EXPECT_EQ(diagnostics[0].getMessage(), "redefinition of function f");
+
+	EXPECT_FALSE(llvm::sys::fs::remove_directories(dir));
+}
+
+TEST(IncrementalCompiler, RecompilesOnlyTheEditedFunction)
+{
+	constexpr std::size_t func_count = 1000;
+	constexpr std::size_t edited = func_count / 2;
+
+	llvm::SmallString<128> dir;
+	ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("tinyc-incremental", dir));
+	llvm::SmallString<128> cache_dir { dir };
+	llvm::sys::path::append(cache_dir, "cache");
+	llvm::SmallString<128> output { dir };
+	llvm::sys::path::append(output, "out");
+	std::string output_file { output.str() };
+
+	auto tm = test::create_host_target_machine();
+	ASSERT_NE(tm, nullptr);
+
+	auto make_source = [](int edited_value) {
+		std::string source;
+		for (std::size_t i = 0; i < func_count; ++i)
+		{
+			auto value = i == edited ? edited_value : static_cast<int>(i);
+			source += std::format("int f{}() {{ return {} * 2 + 1; }}\n", i, value);
+		}
+		return source;
+	};
+	/// @return 编译耗时
+	auto compile = [&](const std::string& text, std::size_t expected_reused) {
+		test::ParsedSource source { text };
+		EXPECT_TRUE(source.parsed);
+		llvm::LLVMContext context;
+		IncrementalCompiler compiler { context, false, source.src_mgr, output_file,
+									   tm.get(), cache_dir.str() };
+		auto start = std::chrono::steady_clock::now();
+		EXPECT_TRUE(compiler.compile(source.ast()));
+		std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - start;
+		EXPECT_EQ(compiler.get_reused_count(), expected_reused);
+		EXPECT_EQ(compiler.get_compiled_count(), func_count - expected_reused);
+		return elapsed.count();
+	};
+
+	auto cold_ms = compile(make_source(static_cast<int>(edited)), 0);
+	auto warm_ms = compile(make_source(-1), func_count - 1);
+	std::cout << std::format("{} functions: cold {:.1f} ms, one edited {:.1f} ms\n",
+							 func_count, cold_ms, warm_ms);
+	// 复制999个缓存文件远快于重新生成999个模块
+	EXPECT_LT(warm_ms, cold_ms);
+
+	EXPECT_FALSE(llvm::sys::fs::remove_directories(dir));
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,124 @@
+#include "interpreter.hpp"
+#include "test_source.hpp"
+#include "test_target.hpp"
+#include "tinyc.hpp"
+#include <gtest/gtest.h>
+#include <llvm/IR/LLVMContext.h>
+#include <format>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tinyc
+{
+namespace
+{
+
+/// @brief 叶子在小整数与会引起回绕的边界值之间随机选择
+auto make_expression(std::mt19937& rng, std::size_t leaves) -> std::string
+{
+	constexpr std::string_view ops[] {
+		"+", "-", "*", "/", "%", "<", ">", "<=", ">=", "==", "!=", "&&", "||",
+	};
+	constexpr std::string_view unary_ops[] { "-", "+", "!" };
+	constexpr std::string_view big_values[] { "2147483647", "65536", "46341" };
+
+	std::string expr;
+	if (leaves <= 1)
+	{
+		expr = rng() % 8 == 0 ? std::string { big_values[rng() % std::size(big_values)] }
+			: std::to_string(rng() % 10);
+	}
+	else
+	{
+		auto left = 1 + rng() % (leaves - 1);
+		expr = std::format("({} {} {})", make_expression(rng, left),
+						   ops[rng() % std::size(ops)], make_expression(rng, leaves - left));
+	}
+	if (rng() % 5 == 0)
+		expr = std::format("{}{}", unary_ops[rng() % std::size(unary_ops)], expr);
+	return expr;
+}
+
+/// @brief 解释器与JIT分别执行source中的每个函数, 返回比较过的函数个数
+auto expect_same_results(std::string_view source, const std::vector<std::string>& names)
+	-> std::size_t
+{
+	auto tm = test::create_host_target_machine();
+	EXPECT_NE(tm, nullptr);
+	if (tm == nullptr)
+		return 0;
+
+	llvm::LLVMContext context;
+	Compiler compiler { context, *tm };
+	CompileOptions options;
+	options.output_kinds.clear();
+	options.keep_module = true;
+	auto result = compiler.compile(source, options);
+	EXPECT_TRUE(result.success);
+	if (!result.success)
+		return 0;
+	auto jit_or_error = Compiler::create_jit(*result.module, names.front());
+	EXPECT_TRUE(jit_or_error) << jit_or_error.error();
+	if (!jit_or_error)
+		return 0;
+
+	test::ParsedSource parsed { source };
+	EXPECT_TRUE(parsed.parsed);
+	std::size_t compared = 0;
+	for (const auto& name : names)
+	{
+		Interpreter interpreter;
+		auto expected = interpreter.run(parsed.ast(), name);
+		// 除零与INT_MIN / -1在生成的代码中是未定义行为, 不作比较
+		if (!expected)
+			continue;
+		auto actual = (*jit_or_error)->run(name);
+		EXPECT_TRUE(actual) << name << ": " << actual.error();
+		if (actual)
+			EXPECT_EQ(*actual, *expected) << name;
+		++compared;
+	}
+	parsed.take_diagnostics();
+	return compared;
+}
+
+TEST(InterpreterJit, HandWrittenCases)
+{
+	constexpr std::string_view source =
+		"int not_() { return !5 + !0 * 10; }\n"
+		"int compare() { return (3 < 4) + (4 <= 4) * 2 + (5 > 6) * 4 + (1 == 1) * 8; }\n"
+		"int short_and() { return 0 && 1 / 0; }\n"
+		"int short_or() { return 2 || 1 % 0; }\n"
+		"int logic_value() { return (7 && 9) + (0 || 3) * 10; }\n"
+		"int wrap() { return 2147483647 + 1; }\n"
+		"int negative_div() { return -7 / 2 * 10 + -7 % 2; }\n"
+		"int unary_chain() { return - - 3 + -+-4 + !!-2; }\n";
+	std::vector<std::string> names {
+		"not_", "compare", "short_and", "short_or", "logic_value", "wrap",
+		"negative_div", "unary_chain",
+	};
+	EXPECT_EQ(expect_same_results(source, names), names.size());
+}
+
+TEST(InterpreterJit, RandomExpressions)
+{
+	std::mt19937 rng { 20241019 };
+	constexpr std::size_t function_count = 300;
+	std::string source;
+	std::vector<std::string> names;
+	for (std::size_t i = 0; i < function_count; ++i)
+	{
+		names.push_back(std::format("f{}", i));
+		source += std::format("int {}() {{ return {}; }}\n", names.back(),
+							  make_expression(rng, 2 + rng() % 12));
+	}
+
+	auto compared = expect_same_results(source, names);
+	// 大部分函数没有未定义行为, 确保比较确实发生
+	EXPECT_GT(compared, function_count / 2);
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,60 @@
+#include "test_target.hpp"
+#include "tinyc.hpp"
+#include <gtest/gtest.h>
+#include <llvm/IR/LLVMContext.h>
+
+namespace tinyc
+{
+namespace
+{
+
+auto compile_module(llvm::LLVMContext& context, llvm::TargetMachine& tm,
+					std::string_view source) -> std::unique_ptr<llvm::Module>
+{
+	Compiler compiler { context, tm };
+	CompileOptions options;
+	options.output_kinds.clear();
+	options.keep_module = true;
+	auto result = compiler.compile(source, options);
+	EXPECT_TRUE(result.success);
+	return std::move(result.module);
+}
+
+TEST(JitRunner, CheckEntryRejectsOtherSignatures)
+{
+	auto tm = test::create_host_target_machine();
+	ASSERT_NE(tm, nullptr);
+	llvm::LLVMContext context;
+	auto module = compile_module(context, *tm,
+		"int main() { return 7; }\n"
+		"void v() { return 1; }\n"
+		"int p(int a) { return 2; }\n");
+	ASSERT_NE(module, nullptr);
+
+	EXPECT_TRUE(JitRunner::check_entry(*module, "main"));
+	EXPECT_FALSE(JitRunner::check_entry(*module, "v"));
+	EXPECT_FALSE(JitRunner::check_entry(*module, "p"));
+	EXPECT_FALSE(JitRunner::check_entry(*module, "missing"));
+}
+
+TEST(JitRunner, CreateJitChecksEntryBeforeRunning)
+{
+	auto tm = test::create_host_target_machine();
+	ASSERT_NE(tm, nullptr);
+	llvm::LLVMContext context;
+	auto module = compile_module(context, *tm,
+		"int main() { return 7; }\n"
+		"int p(int a) { return 2; }\n");
+	ASSERT_NE(module, nullptr);
+
+	EXPECT_FALSE(Compiler::create_jit(*module, "p"));
+
+	auto jit_or_error = Compiler::create_jit(*module, "main");
+	ASSERT_TRUE(jit_or_error) << jit_or_error.error();
+	auto ret_or_error = (*jit_or_error)->run("main");
+	ASSERT_TRUE(ret_or_error) << ret_or_error.error();
+	EXPECT_EQ(*ret_or_error, 7);
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,111 @@
+#include "line_index.hpp"
+#include "llvm_location.hpp"
+#include <gtest/gtest.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tinyc
+{
+namespace
+{
+
+/// @brief 逐字节数出的行列号, 作为LineIndex的参照
+auto naive_line_and_column(const std::string& text, std::size_t offset)
+	-> std::pair<unsigned, unsigned>
+{
+	unsigned line = 1;
+	unsigned column = 1;
+	for (std::size_t i = 0; i < offset; ++i)
+	{
+		if (text[i] == '\n')
+		{
+			++line;
+			column = 1;
+		}
+		else
+		{
+			++column;
+		}
+	}
+	return { line, column };
+}
+
+/// @brief 覆盖SSE2路径的16字节块与末尾的剩余部分, 包括空行与连续换行
+auto make_text(std::size_t size) -> std::string
+{
+	std::mt19937 rng { 20241019 };
+	std::uniform_int_distribution<int> dist { 0, 9 };
+	std::string text;
+	text.reserve(size);
+	for (std::size_t i = 0; i < size; ++i)
+		text.push_back(dist(rng) < 2 ? '\n' : static_cast<char>('a' + dist(rng)));
+	return text;
+}
+
+TEST(LineIndex, MatchesNaiveCount)
+{
+	for (std::size_t size : { 0u, 1u, 15u, 16u, 17u, 1000u })
+	{
+		auto text = make_text(size);
+		LineIndex line_index { text };
+		for (std::size_t offset = 0; offset <= text.size(); ++offset)
+		{
+			ASSERT_EQ(line_index.get_line_and_column(text.data() + offset),
+					  naive_line_and_column(text, offset))
+				<< "size " << size << ", offset " << offset;
+		}
+	}
+}
+
+TEST(LineIndex, LineTextStopsAtNewline)
+{
+	std::string text = "int main()\r\n{\n\treturn 0;\n}";
+	LineIndex line_index { text };
+	ASSERT_EQ(line_index.get_line_count(), 4u);
+	EXPECT_EQ(line_index.get_line_text(0), "int main()");
+	EXPECT_EQ(line_index.get_line_text(1), "{");
+	EXPECT_EQ(line_index.get_line_text(2), "\treturn 0;");
+	EXPECT_EQ(line_index.get_line_text(3), "}");
+	EXPECT_EQ(line_index.get_line_text(4), "");
+}
+
+TEST(LineIndex, ReportMatchesSourceMgr)
+{
+	llvm::SourceMgr src_mgr;
+	auto id = src_mgr.AddNewSourceBuffer(llvm::MemoryBuffer::getMemBufferCopy(
+		"int main()\n{\n\treturn 1 +\n\t\t2;\n}\n", "test.c"), llvm::SMLoc {});
+	auto text = src_mgr.getMemoryBuffer(id)->getBuffer();
+	LineIndex line_index { text };
+
+	std::vector<llvm::SMDiagnostic> diagnostics;
+	src_mgr.setDiagHandler([](const llvm::SMDiagnostic& diag, void* context) {
+		static_cast<std::vector<llvm::SMDiagnostic>*>(context)->push_back(diag);
+	}, &diagnostics);
+
+	// 范围跨行时只标出第一行中的部分
+	LLVMLocation location;
+	location.set_begin(text.data() + text.find("1 +"));
+	location.set_end(text.data() + text.find("2;") + 1);
+	location.set_src_mgr(&src_mgr);
+	location.set_line_index(&line_index);
+	location.report(Location::dk_error, "message");
+
+	auto expected = src_mgr.GetMessage(location.begin, llvm::SourceMgr::DK_Error,
+									   "message", location.get_range());
+	ASSERT_EQ(diagnostics.size(), 1u);
+	auto render = [](const llvm::SMDiagnostic& diag) {
+		std::string text;
+		llvm::raw_string_ostream os { text };
+		diag.print(nullptr, os, false);
+		return os.str();
+	};
+	EXPECT_EQ(render(diagnostics[0]), render(expected));
+}
+
+}	//namespace
+}	//namespace tinyc
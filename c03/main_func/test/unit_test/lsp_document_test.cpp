@@ -0,0 +1,120 @@
+#include "lsp_document.hpp"
+#include <gtest/gtest.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <string_view>
+
+namespace tinyc
+{
+namespace
+{
+
+constexpr std::string_view initial_text =
+	"int a() { return 1; }\n"
+	"\n"
+	"// comment between functions\n"
+	"int b(int x)\n"
+	"{\n"
+	"\treturn x + 2;\n"
+	"}\n"
+	"int c() { return 3 * ; }\n"
+	"/* trailing */ int d() { return 4; }\n";
+
+auto to_string(const llvm::json::Array& array) -> std::string
+{
+	std::string text;
+	llvm::raw_string_ostream os { text };
+	os << llvm::json::Value { llvm::json::Array { array } };
+	return os.str();
+}
+
+auto position_of(std::string_view text, std::size_t offset) -> LspDocument::Position
+{
+	LspDocument::Position position { 0, 0 };
+	for (std::size_t i = 0; i < offset; ++i)
+	{
+		if (text[i] == '\n')
+		{
+			++position.line;
+			position.character = 0;
+		}
+		else
+		{
+			++position.character;
+		}
+	}
+	return position;
+}
+
+class LspDocumentTest: public testing::Test
+{
+protected:
+	/// @brief 将文档中第一次出现的before替换为after, 返回重新解析的段数
+	auto replace(std::string_view before, std::string_view after) -> std::size_t
+	{
+		auto offset = document.get_text().find(before);
+		EXPECT_NE(offset, std::string::npos) << before;
+		LspDocument::Range range {
+			position_of(document.get_text(), offset),
+			position_of(document.get_text(), offset + before.size()),
+		};
+		document.apply_change(range, after);
+		return document.update();
+	}
+
+	/// @brief 增量更新后的结果与从头解析当前文本相同
+	void expect_same_as_full_parse()
+	{
+		LspDocument full { "test.c", document.get_text(), {} };
+		full.update();
+		EXPECT_EQ(document.get_chunk_count(), full.get_chunk_count());
+		EXPECT_EQ(to_string(document.get_diagnostics()), to_string(full.get_diagnostics()))
+			<< document.get_text();
+	}
+
+	LspDocument document { "test.c", std::string { initial_text }, {} };
+};
+
+TEST_F(LspDocumentTest, IncrementalMatchesFullReparse)
+{
+	// 四个函数各一段, 末尾只含换行的段不需要解析
+	EXPECT_EQ(document.update(), 4u);
+	EXPECT_EQ(document.get_diagnostics().size(), 1u);
+	expect_same_as_full_parse();
+
+	// 只修改一个函数时只重新解析它所在的段
+	EXPECT_EQ(replace("return 3 * ;", "return 3 * 5;"), 1u);
+	EXPECT_TRUE(document.get_diagnostics().empty());
+	expect_same_as_full_parse();
+
+	EXPECT_EQ(replace("x + 2", "x +\n\t\t+"), 1u);
+	EXPECT_EQ(document.get_diagnostics().size(), 1u);
+	expect_same_as_full_parse();
+
+	// 之后的段平移, 诊断位置随之移动
+	replace("int a() { return 1; }\n", "int a()\n{\n\treturn 1;\n}\nint e() { return ; }\n");
+	EXPECT_EQ(document.get_diagnostics().size(), 2u);
+	expect_same_as_full_parse();
+
+	// 删除"}"使两个函数合并为一段
+	replace("return 1;\n}", "return 1;\n");
+	expect_same_as_full_parse();
+
+	replace("/* trailing */", "");
+	expect_same_as_full_parse();
+
+	document.apply_change(std::nullopt, "int only() { return 0; }\nint");
+	document.update();
+	expect_same_as_full_parse();
+
+	// 在末尾追加, 没有闭合的最后一段需要重新扫描
+	document.apply_change(LspDocument::Range {
+		position_of(document.get_text(), document.get_text().size()),
+		position_of(document.get_text(), document.get_text().size()) }, " f() { return 6; }");
+	document.update();
+	EXPECT_TRUE(document.get_diagnostics().empty());
+	expect_same_as_full_parse();
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,60 @@
+#include "test_source.hpp"
+#include <gtest/gtest.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <string>
+#include <vector>
+
+namespace tinyc
+{
+namespace
+{
+
+/// @brief 语料目录中的所有.c文件, 按文件名排序
+auto corpus_files() -> std::vector<std::string>
+{
+	std::vector<std::string> files;
+	std::error_code ec;
+	for (llvm::sys::fs::directory_iterator it { TINYC_TEST_DATA_DIR, ec }, end;
+		 it != end && !ec; it.increment(ec))
+	{
+		if (llvm::sys::path::extension(it->path()) == ".c")
+			files.push_back(it->path());
+	}
+	EXPECT_FALSE(ec) << TINYC_TEST_DATA_DIR << ": " << ec.message();
+	llvm::sort(files);
+	return files;
+}
+
+TEST(ParserDifferential, CorpusProducesIdenticalAST)
+{
+	auto files = corpus_files();
+	ASSERT_FALSE(files.empty()) << "no corpus in " << TINYC_TEST_DATA_DIR;
+
+	for (const auto& file : files)
+	{
+		SCOPED_TRACE(file);
+		auto buffer_or_error = llvm::MemoryBuffer::getFile(file);
+		ASSERT_TRUE(buffer_or_error) << buffer_or_error.getError().message();
+		auto source = (*buffer_or_error)->getBuffer();
+
+		test::ParsedSource bison { source, Driver::ParserKind::bison };
+		test::ParsedSource rd { source, Driver::ParserKind::recursive_descent };
+		ASSERT_TRUE(bison.parsed);
+		ASSERT_TRUE(rd.parsed);
+		EXPECT_TRUE(bison.take_diagnostics().empty());
+		EXPECT_TRUE(rd.take_diagnostics().empty());
+
+		auto bison_bytes = test::serialize(bison.ast(), bison.driver->get_source_buffer());
+		auto rd_bytes = test::serialize(rd.ast(), rd.driver->get_source_buffer());
+		EXPECT_FALSE(bison.ast().get_func_defs().empty());
+		EXPECT_TRUE(bison_bytes == rd_bytes)
+			<< "serialized ASTs differ (" << bison_bytes.size() << " and "
+			<< rd_bytes.size() << " bytes)";
+	}
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,43 @@
+#include "remark_summary.hpp"
+#include <gtest/gtest.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/Support/raw_ostream.h>
+#include <format>
+#include <string>
+
+namespace tinyc
+{
+namespace
+{
+
+TEST(RemarkSummary, CountsRemarksAndPassesWarningsOn)
+{
+	llvm::LLVMContext context;
+	llvm::Module module { "test", context };
+	auto func = llvm::Function::Create(
+		llvm::FunctionType::get(llvm::Type::getInt32Ty(context), false),
+		llvm::GlobalValue::ExternalLinkage, "f", module);
+
+	RemarkSummary summary;
+	EXPECT_TRUE(summary.handleDiagnostics(
+		llvm::OptimizationRemark { "inline", "Inlined", func }));
+	EXPECT_TRUE(summary.handleDiagnostics(
+		llvm::OptimizationRemarkMissed { "inline", "NoDefinition", func }));
+	// 优化失败是警告, 需要照常输出
+	EXPECT_FALSE(summary.handleDiagnostics(llvm::DiagnosticInfoOptimizationFailure {
+		*func, llvm::DiagnosticLocation {}, "loop not vectorized" }));
+
+	std::string text;
+	llvm::raw_string_ostream os { text };
+	summary.print(os);
+	EXPECT_NE(os.str().find(std::format("{:<32} {:>8} {:>8} {:>8}\n", "f", 1, 1, 0)),
+			  std::string::npos) << text;
+	EXPECT_EQ(os.str().find("transform-warning"), std::string::npos) << text;
+}
+
+}	//namespace
+}	//namespace tinyc
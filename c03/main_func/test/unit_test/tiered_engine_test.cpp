@@ -0,0 +1,140 @@
+#include "test_source.hpp"
+#include "test_target.hpp"
+#include "tiered_engine.hpp"
+#include <gtest/gtest.h>
+#include <llvm/Support/raw_ostream.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace tinyc
+{
+namespace
+{
+
+constexpr std::string_view source =
+	"int hot() { return (7 && 9) + !0 * 10 - (3 < 4) * -5 + 2147483647 + 1; }\n"
+	"int cold() { return 1 + 2 * 3; }\n";
+
+class TieredEngineTest: public testing::Test
+{
+protected:
+	auto create(std::uint64_t threshold) -> std::unique_ptr<TieredEngine>
+	{ return create(parsed, threshold); }
+
+	auto create(const test::ParsedSource& source, std::uint64_t threshold)
+		-> std::unique_ptr<TieredEngine>
+	{
+		EXPECT_TRUE(source.parsed);
+		TieredEngine::Options options;
+		options.tier_up_threshold = threshold;
+		auto engine_or_error = TieredEngine::create(source.ast(), source.src_mgr,
+			[] { return test::create_host_target_machine(); }, std::move(options));
+		EXPECT_TRUE(engine_or_error) << engine_or_error.error();
+		return engine_or_error ? std::move(*engine_or_error) : nullptr;
+	}
+
+	auto stats(const TieredEngine& engine) const -> std::string
+	{
+		std::string text;
+		llvm::raw_string_ostream os { text };
+		engine.print_stats(os);
+		return os.str();
+	}
+
+	test::ParsedSource parsed { source };
+};
+
+TEST_F(TieredEngineTest, TiersUpAfterThreshold)
+{
+	auto engine = create(3);
+	ASSERT_NE(engine, nullptr);
+
+	std::vector<int> bytecode_results;
+	for (int i = 0; i < 3; ++i)
+	{
+		auto ret = engine->call("hot");
+		ASSERT_TRUE(ret) << ret.error();
+		bytecode_results.push_back(*ret);
+	}
+	EXPECT_EQ(engine->call("cold"), 7);
+	engine->wait_for_compilation();
+
+	// 升层后调用不再经过字节码层, 计数停在阈值上
+	for (int i = 0; i < 5; ++i)
+		EXPECT_EQ(engine->call("hot"), bytecode_results.front());
+	EXPECT_EQ(bytecode_results, std::vector<int>(3, bytecode_results.front()));
+	EXPECT_EQ(stats(*engine),
+			  "hot: 3 bytecode calls, native\n"
+			  "cold: 1 bytecode calls, bytecode\n");
+}
+
+TEST_F(TieredEngineTest, ZeroThresholdNeverTiersUp)
+{
+	auto engine = create(0);
+	ASSERT_NE(engine, nullptr);
+	for (int i = 0; i < 10; ++i)
+		EXPECT_EQ(engine->call("cold"), 7);
+	engine->wait_for_compilation();
+	EXPECT_EQ(stats(*engine),
+			  "hot: 0 bytecode calls, bytecode\n"
+			  "cold: 10 bytecode calls, bytecode\n");
+	EXPECT_FALSE(engine->call("missing"));
+}
+
+TEST_F(TieredEngineTest, CallsFromThreadsDuringCompilation)
+{
+	auto engine = create(1);
+	ASSERT_NE(engine, nullptr);
+	auto expected = engine->call("hot");
+	ASSERT_TRUE(expected) << expected.error();
+
+	// 编译进行中与完成后的调用混在一起, 结果都应相同
+	{
+		std::vector<std::jthread> threads;
+		for (int t = 0; t < 4; ++t)
+		{
+			threads.emplace_back([&] {
+				for (int i = 0; i < 2000; ++i)
+					EXPECT_EQ(engine->call("hot"), *expected);
+			});
+		}
+	}
+	engine->wait_for_compilation();
+	EXPECT_EQ(engine->call("hot"), *expected);
+	EXPECT_NE(stats(*engine).find(", native\n"), std::string::npos);
+}
+
+TEST_F(TieredEngineTest, FailingFunctionStaysOnBytecode)
+{
+	// 本机代码中这些运算是未定义行为, 升层后不再报错
+	test::ParsedSource failing {
+		"int divide() { return 1 / 0; }\n"
+		"int overflow() { return (-2147483647 - 1) / -1; }\n"
+	};
+	// 阈值为1时编译与第一次出错同时进行
+	for (std::uint64_t threshold : { 1u, 3u })
+	{
+		auto engine = create(failing, threshold);
+		ASSERT_NE(engine, nullptr);
+		for (int i = 0; i < 10; ++i)
+		{
+			auto divide = engine->call("divide");
+			ASSERT_FALSE(divide) << "threshold " << threshold << ", call " << i;
+			EXPECT_NE(divide.error().find("division by zero"), std::string::npos)
+				<< divide.error();
+			EXPECT_FALSE(engine->call("overflow")) << "threshold " << threshold;
+		}
+		engine->wait_for_compilation();
+		EXPECT_FALSE(engine->call("divide"));
+		EXPECT_FALSE(engine->call("overflow"));
+		EXPECT_EQ(stats(*engine),
+				  "divide: 11 bytecode calls, pinned\n"
+				  "overflow: 11 bytecode calls, pinned\n") << "threshold " << threshold;
+	}
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -0,0 +1,80 @@
+#include "test_target.hpp"
+#include "watcher.hpp"
+#include <gtest/gtest.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <sys/inotify.h>
+#include <string>
+#include <string_view>
+
+namespace tinyc
+{
+namespace
+{
+
+/// @brief 与编辑器保存相同, 写完后关闭文件产生IN_CLOSE_WRITE
+void write_file(const std::string& path, std::string_view text)
+{
+	std::error_code ec;
+	llvm::raw_fd_ostream os { path, ec, llvm::sys::fs::OF_None };
+	ASSERT_FALSE(ec) << ec.message();
+	os << text;
+}
+
+auto read_file(const std::string& path) -> std::string
+{
+	auto buffer = llvm::MemoryBuffer::getFile(path);
+	return buffer ? (*buffer)->getBuffer().str() : std::string {};
+}
+
+TEST(Watcher, RecompilesOnlyChangedContent)
+{
+	llvm::SmallString<128> dir;
+	ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("tinyc-watch", dir));
+	llvm::SmallString<128> source { dir };
+	llvm::sys::path::append(source, "a.c");
+	llvm::SmallString<128> object { dir };
+	llvm::sys::path::append(object, "a.o");
+	std::string source_path { source.str() };
+	std::string object_path { object.str() };
+
+	auto tm = test::create_host_target_machine();
+	ASSERT_NE(tm, nullptr);
+
+	write_file(source_path, "int main() { return 1; }\n");
+	Watcher watcher { *tm, {} };
+	ASSERT_TRUE(watcher.add_path(source_path));
+	watcher.compile_all();
+	EXPECT_EQ(watcher.get_compile_count(), 1u);
+	auto first_object = read_file(object_path);
+	EXPECT_FALSE(first_object.empty());
+
+	// 内容相同, 只有事件, 不重新编译
+	write_file(source_path, "int main() { return 1; }\n");
+	ASSERT_TRUE(watcher.read_events());
+	EXPECT_EQ(watcher.get_compile_count(), 1u);
+
+	write_file(source_path, "int main() { return 2; }\n");
+	ASSERT_TRUE(watcher.read_events());
+	EXPECT_EQ(watcher.get_compile_count(), 2u);
+	auto second_object = read_file(object_path);
+	EXPECT_FALSE(second_object.empty());
+	EXPECT_NE(second_object, first_object);
+
+	// 队列溢出时事件已丢失, 所有文件都要重新检查
+	write_file(source_path, "int main() { return 3; }\n");
+	inotify_event overflow {};
+	overflow.wd = -1;
+	overflow.mask = IN_Q_OVERFLOW;
+	watcher.handle_events({ reinterpret_cast<const char*>(&overflow), sizeof(overflow) });
+	EXPECT_EQ(watcher.get_compile_count(), 3u);
+	EXPECT_NE(read_file(object_path), second_object);
+
+	EXPECT_FALSE(llvm::sys::fs::remove_directories(dir));
+}
+
+}	//namespace
+}	//namespace tinyc
@@ -1,8 +1,9 @@
 #pragma once
 #include <llvm/Support/SMLoc.h>
 #include <llvm/Support/SourceMgr.h>
+#include <array>
+#include <atomic>
 #include <ostream>
-#include <unordered_map>
 #include "ast.hpp"
 
 #define YYLLOC_DEFAULT(Cur, Rhs, N)                                            \
@@ -71,8 +72,9 @@ public:
 	auto search_counter(Location::DiagKind kind) -> std::size_t;
 
 private:
+	/// @brief 以DiagKind为下标, 多个线程同时report时无需加锁
 	static inline
-	std::unordered_map<Location::DiagKind, std::size_t> trace_counter;
+	std::array<std::atomic<std::size_t>, Location::dk_note + 1> trace_counter {};
 	
 	static
 	void count(Location::DiagKind kind);
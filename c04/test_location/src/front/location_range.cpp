@@ -82,12 +82,12 @@ auto operator<< (std::ostream& os, const LocationRange& loc) -> std::ostream&
 
 auto LocationRange::search_counter(Location::DiagKind kind) -> std::size_t
 {
-	return LocationRange::trace_counter[kind];
+	return trace_counter[kind].load(std::memory_order_relaxed);
 }
 
 void LocationRange::count(Location::DiagKind kind)
 {
-	++trace_counter[kind];
+	trace_counter[kind].fetch_add(1, std::memory_order_relaxed);
 }
 
 constexpr